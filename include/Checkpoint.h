@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+	Checkpoint.h describes the file the simulator saves its complete
+	state to (Simulator::saveCheckpoint), so a lesson can start from a
+	prepared state instead of simulating hours to get there.
+
+	The file is a CheckpointHeader followed by a body written with a
+	cereal binary archive: the settings as JSON, the state of the
+	simulator, rods and periodical modes, and the samples. The header
+	holds the size and a checksum of the body, so a damaged file is
+	rejected before anything is restored.
+
+	Without the history only the last CHECKPOINT_TAIL_STEPS steps are
+	kept, enough for the period average and a pulse in progress. The
+	restored run then starts with them. With the history the whole
+	data buffer is restored as it was.
+*/
+
+constexpr auto CHECKPOINT_VERSION = 3;
+constexpr auto CHECKPOINT_EXTENSION = ".rrc";
+// Steps kept in checkpoints without the history, a pulse lasts 5 seconds
+constexpr size_t CHECKPOINT_TAIL_STEPS = 6000;
+
+enum CheckpointFlags : uint32_t {
+	CheckpointHistory = 1	// the whole data buffer is included
+};
+
+struct CheckpointHeader {
+	char magic[4];			// "RRCP"
+	uint32_t version;
+	uint32_t flags;			// CheckpointFlags
+	uint32_t reserved;
+	uint64_t dataPoints;	// length of the data buffer, must match the simulator
+	double timeStep;		// DT_STEP of the simulator that saved it
+	uint64_t bodySize;
+	uint64_t checksum;		// checkpointChecksum of the body
+};
+static_assert(sizeof(CheckpointHeader) == 48, "Checkpoint header must be 48 bytes");
+
+// FNV-1a, 64 bit
+inline uint64_t checkpointChecksum(const char* data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
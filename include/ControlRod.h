@@ -213,6 +213,7 @@ public:
 	void setRodWorth(float worth) { rod_worth = worth; }
 	const float &getRodWorth() { return rod_worth; }
 	void setParameter(size_t index, float value, bool recalculateSteps = true) { parameters[index] = value; if (recalculateSteps) recalculateStepData(); }
+	float getParameter(size_t index) { return parameters[index]; }
 	float getPCMat(float position) {
 		position = std::min(position, (float)rod_steps);
 		position = std::max(position, 0.f);
@@ -399,4 +400,15 @@ public:
 		return simulationMode;
 	}
 
+	/* Saves or restores the rod with its movement, SCRAM and fire timers, used by checkpoints.
+	The step data is not part of it, call recalculateStepData() if the steps or the curve changed. */
+	template <class Archive>
+	void serialize(Archive& archive) {
+		archive(enabled, rod_exact_position, rod_actual_position, manual_command, rod_exact_command,
+			rod_steps, rod_worth, rod_speed, fireing, parameters,
+			scramTime, timeSinceScram, positionAtScram, scramDuration,
+			name, rodCommand, mode, simulationMode, simulationStartPosition, fireTimer, holdPcm,
+			*sqw, *sinMode, *saw);
+	}
+
 };
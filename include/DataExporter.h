@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <ctime>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/*
+	DataExporter.h writes snapshots of the simulation data
+	to log files on a background thread, so the simulation
+	never waits for the disk
+*/
+
+class DataExporter {
+public:
+	// One line of the data log
+	struct Row {
+		double time;
+		double power;
+		float reactivity;
+		float rodReactivity;
+		float temperature;
+		float xenon;
+		float iodine;
+	};
+
+	// A snapshot of the data, taken when the export was requested
+	struct Job {
+		std::string fileName;
+		time_t created = 0;
+		std::vector<Row> rows;
+		// Written as a binary run log (see RunLog.h) instead of text
+		bool binary = false;
+		std::string settings;	// JSON, stored in the binary log
+		double timeStep = 0.;	// time between two rows (s), 0 if they are not evenly spaced
+	};
+
+	DataExporter() {}
+	// Finishes writing all the queued jobs
+	~DataExporter();
+
+	// Queues the job, the writer thread is started on first use
+	void submit(Job &&job);
+
+	// Waits until the queued jobs and the one being written are in their files
+	void finish();
+
+	// True while jobs are queued or being written
+	bool busy() const { return mBusy; }
+	// Progress of the file being written (0-1)
+	float progress() const { return mProgress; }
+	// Number of jobs waiting, including the one being written
+	size_t pending() const;
+
+	// Writes the time as h:m:s:ms into the buffer, returns the length of the text
+	static int formatTime(char* buffer, size_t size, double t);
+
+private:
+	void run();
+	bool write(const Job &job);
+	bool writeBinary(const Job &job);
+
+	std::deque<Job> mJobs;
+	mutable std::mutex mMutex;
+	std::condition_variable mCondition;
+	// Notified when the writer runs out of jobs
+	std::condition_variable mIdle;
+	std::thread mThread;
+	bool mStop = false;
+	std::atomic<bool> mBusy{ false };
+	std::atomic<float> mProgress{ 0.f };
+	std::atomic<size_t> mWriting{ 0 };
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include <deque>
+
+/*
+	Downsampling.h selects which samples of a long series to keep
+	when it is exported with fewer points, so that peaks and fast
+	transients survive. The functions read the samples of all the
+	channels through one accessor, in a single pass, and append the
+	kept indices of every channel in increasing order.
+*/
+
+// One sample of C channels that share the x values
+template<size_t C>
+struct DownsamplePoint {
+	double x;
+	double y[C];
+};
+
+/* Largest-Triangle-Three-Buckets (S. Steinarsson, 2013) of C channels at once. The first and
+the last sample are kept, the rest is split into target - 2 buckets. From each bucket the sample
+that forms the largest triangle with the previously kept sample and the average of the next
+bucket is kept, for each channel on its own. sample(i, point) is called once per sample in
+increasing order, only two buckets are kept in memory, so a long history is read in one pass. */
+template<size_t C, typename S>
+void downsampleLTTB(size_t n, size_t target, const S &sample, std::vector<std::vector<size_t>> &out) {
+	out.resize(C);
+	if (target >= n || target < 3) {
+		for (size_t i = 0; i < n; i++) {
+			if (target >= n || i == 0 || i == n - 1) {
+				for (size_t c = 0; c < C; c++) out[c].push_back(i);
+			}
+		}
+		return;
+	}
+	const double every = (double)(n - 2) / (target - 2);
+	// The samples from windowStart on that were read and are still needed
+	std::deque<DownsamplePoint<C>> window;
+	size_t windowStart = 0;
+	DownsamplePoint<C> point;
+	sample(0, point);
+	window.push_back(point);
+	DownsamplePoint<C> picked[C];
+	for (size_t c = 0; c < C; c++) {
+		out[c].push_back(0);
+		picked[c] = point;
+	}
+	for (size_t bucket = 0; bucket < target - 2; bucket++) {
+		size_t start = (size_t)(bucket * every) + 1;
+		size_t end = std::min((size_t)((bucket + 1) * every) + 1, n - 1);
+		size_t nextStart = (size_t)((bucket + 1) * every) + 1;
+		size_t nextEnd = std::min((size_t)((bucket + 2) * every) + 1, n);
+		for (; windowStart < start && !window.empty(); windowStart++) window.pop_front();
+		while (windowStart + window.size() < nextEnd) {
+			sample(windowStart + window.size(), point);
+			window.push_back(point);
+		}
+
+		// Average of the next bucket, the last bucket uses the last sample
+		double avgX = 0., avgY[C] = { 0. };
+		for (size_t i = nextStart; i < nextEnd; i++) {
+			const DownsamplePoint<C> &next = window[i - windowStart];
+			avgX += next.x;
+			for (size_t c = 0; c < C; c++) avgY[c] += next.y[c];
+		}
+		avgX /= (nextEnd - nextStart);
+		for (size_t c = 0; c < C; c++) avgY[c] /= (nextEnd - nextStart);
+
+		for (size_t c = 0; c < C; c++) {
+			const double ax = picked[c].x, ay = picked[c].y[c];
+			double maxArea = -1.;
+			size_t pick = start;
+			for (size_t i = start; i < end; i++) {
+				const DownsamplePoint<C> &candidate = window[i - windowStart];
+				double area = std::abs((ax - avgX) * (candidate.y[c] - ay) - (ax - candidate.x) * (avgY[c] - ay));
+				if (area > maxArea) {
+					maxArea = area;
+					pick = i;
+				}
+			}
+			out[c].push_back(pick);
+			picked[c] = window[pick - windowStart];
+		}
+	}
+	for (size_t c = 0; c < C; c++) out[c].push_back(n - 1);
+}
+
+/* Splits the samples into target / 2 buckets and keeps the minimum and the maximum of each,
+for each of the C channels. sample(i, point) is called once per sample in increasing order. */
+template<size_t C, typename S>
+void downsampleMinMax(size_t n, size_t target, const S &sample, std::vector<std::vector<size_t>> &out) {
+	out.resize(C);
+	if (target >= n || target < 2) {
+		for (size_t i = 0; i < n; i++) {
+			if (target >= n || i == 0 || i == n - 1) {
+				for (size_t c = 0; c < C; c++) out[c].push_back(i);
+			}
+		}
+		return;
+	}
+	const size_t buckets = target / 2;
+	const double every = (double)n / buckets;
+	DownsamplePoint<C> point;
+	for (size_t bucket = 0; bucket < buckets; bucket++) {
+		size_t start = (size_t)(bucket * every);
+		size_t end = std::min((size_t)((bucket + 1) * every), n);
+		if (start >= end) continue;
+		sample(start, point);
+		size_t minIdx[C], maxIdx[C];
+		double minY[C], maxY[C];
+		for (size_t c = 0; c < C; c++) {
+			minIdx[c] = maxIdx[c] = start;
+			minY[c] = maxY[c] = point.y[c];
+		}
+		for (size_t i = start + 1; i < end; i++) {
+			sample(i, point);
+			for (size_t c = 0; c < C; c++) {
+				double value = point.y[c];
+				if (value < minY[c]) {
+					minY[c] = value;
+					minIdx[c] = i;
+				}
+				else if (value > maxY[c]) {
+					maxY[c] = value;
+					maxIdx[c] = i;
+				}
+			}
+		}
+		for (size_t c = 0; c < C; c++) {
+			out[c].push_back(std::min(minIdx[c], maxIdx[c]));
+			if (minIdx[c] != maxIdx[c]) out[c].push_back(std::max(minIdx[c], maxIdx[c]));
+		}
+	}
+}
+
+// Merges sorted index lists into one sorted list without duplicates
+inline std::vector<size_t> mergeIndices(const std::vector<std::vector<size_t>> &lists) {
+	std::vector<size_t> ret;
+	for (const std::vector<size_t> &list : lists) {
+		std::vector<size_t> merged;
+		merged.reserve(ret.size() + list.size());
+		std::set_union(ret.begin(), ret.end(), list.begin(), list.end(), std::back_inserter(merged));
+		ret.swap(merged);
+	}
+	return ret;
+}
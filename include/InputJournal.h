@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/*
+	InputJournal.h records a session as the inputs that changed the
+	simulation, so it can be repeated bit for bit without the GUI
+	(see Simulator::replayJournal). Bug reports can come with a small
+	journal file, and regressions can be found by replaying journals.
+
+	The integration itself is deterministic, so only two things are
+	recorded: how many steps every frame calculated (the period and the
+	scripts are evaluated once per frame) and what changed the state from
+	outside the integration. Instead of hooking every button, the
+	Simulator takes a snapshot of its state (Simulator::journalSnapshot)
+	around every place where inputs arrive: between frames (the GUI and
+	the control box), remote control requests and script commands. The
+	bytes that differ are journaled with the step they were applied at.
+
+	The file has a CheckpointHeader with the magic "RRJL", followed by
+	the records. Start records hold the state the following records
+	apply to: the journal starts with one and gets another one whenever
+	the history is replaced (reset, restored checkpoint). Check records
+	hold a checksum of the state every JOURNAL_CHECK_STEPS steps, so a
+	replay that diverges is caught close to where it happened.
+
+	Rewinding (Simulator::rewind) reads the journal back from a keyframe
+	to calculate the steps up to the time it goes back to, the records
+	after that time are dropped.
+
+	A long session doesn't fill the memory: past JOURNAL_TRIM_SIZE the
+	records before a recent keyframe are replaced by a start record of
+	that keyframe (Simulator::trimJournal), so the journal keeps the
+	latest part of the session and rewinding keeps working.
+*/
+
+constexpr auto JOURNAL_VERSION = 3;
+constexpr auto JOURNAL_EXTENSION = ".rrj";
+// The oldest records are dropped when the journal grows past this, a session of several hours takes a few MB
+constexpr size_t JOURNAL_TRIM_SIZE = 192 << 20;
+// The recording stops if a single frame takes the journal past this
+constexpr size_t JOURNAL_MAX_SIZE = 256 << 20;
+// One simulated minute
+constexpr size_t JOURNAL_CHECK_STEPS = 60000;
+
+enum class JournalRecord : std::uint8_t {
+	Start = 1,		// the state as it was, see Simulator::journalStart
+	Frame = 2,		// steps of a frame
+	Input = 3,		// changes between frames (operator, control box, remote requests)
+	StepInput = 4,	// changes at a step inside a frame (scheduled remote requests, script commands)
+	FrameInput = 5,	// changes at the end of a frame (script commands, until they ran inside frames)
+	Check = 6		// checksum of the state at the end of a frame
+};
+
+class InputJournal {
+public:
+	struct Entry {
+		JournalRecord type = JournalRecord::Frame;
+		uint64_t step = 0;		// steps of a Frame, the step it happened at otherwise
+		uint64_t checksum = 0;	// of the state before an input, of the state for Check
+		std::string label;		// what made the input
+		std::string data;		// the state of a Start, the changed bytes of an input
+	};
+
+	// Recording, a new recording starts empty
+	void setRecording(bool recording);
+	bool isRecording() const { return mRecording; }
+	size_t size() const { return mData.size(); }
+
+	void start(const std::string &state);
+	void frame(size_t steps);
+	// Journals what changed from before to after, nothing if they are the same
+	void input(JournalRecord type, uint64_t step, const std::string &label, const std::string &before, const std::string &after);
+	void check(uint64_t step, uint64_t checksum);
+	// Appends an entry as it was read
+	void record(const Entry &entry);
+	// Drops the records from size on, used when the simulation is rewound
+	void truncate(size_t size);
+	/* Replaces the records before position with a start record of state, the records from
+	position on follow it. Returns the size of the new start record. */
+	size_t rebase(const std::string &state, size_t position);
+
+	// dataPoints and timeStep of the simulator are checked when the journal is read
+	bool save(const std::string &fileName, uint64_t dataPoints, double timeStep) const;
+
+	// Reading
+	bool load(const std::string &fileName, uint64_t dataPoints, double timeStep);
+	// Returns false at the end of the journal
+	bool next(Entry &entry);
+	// Reads the entry at position and moves it to the next one, returns false if there is none
+	bool read(size_t &position, Entry &entry) const;
+	// Type of the entry next() returns, 0 at the end
+	int peek() const { return mRead < mData.size() ? (unsigned char)mData[mRead] : 0; }
+	// Set when next() found a record it could not read
+	bool isDamaged() const { return mDamaged; }
+
+	// The changes from before to after, as journaled for an input
+	static std::string diff(const std::string &before, const std::string &after);
+	// Applies the changes of an input to a state, returns false if they don't fit
+	static bool apply(std::string &state, const std::string &changes);
+
+private:
+	void append(JournalRecord type);
+	void appendNumber(uint64_t value);
+	void appendText(const std::string &text);
+	static bool readNumber(const std::string &data, size_t &position, uint64_t &value);
+	static bool readText(const std::string &data, size_t &position, std::string &text);
+
+	bool mRecording = false;
+	bool mDamaged = false;
+	std::string mData;
+	size_t mRead = 0;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#endif
+
+/*
+	LocalSocket.h has the few socket calls shared by the local
+	servers (telemetry, remote control). They listen on the loopback
+	interface only and use non-blocking sockets, so they can be
+	polled from the simulation thread. Include it in source files
+	only, it pulls in the platform socket headers.
+*/
+
+namespace LocalSocket {
+	constexpr intptr_t INVALID = -1;
+
+	// A closed client must not kill the simulator with SIGPIPE: Linux has a send flag for it, macOS a
+	// socket option (set in accept), elsewhere the signal is ignored once a server listens
+#if defined(MSG_NOSIGNAL)
+	const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+	const int SEND_FLAGS = 0;
+#endif
+
+	inline void close(intptr_t socket) {
+#if defined(_WIN32)
+		closesocket((SOCKET)socket);
+#else
+		::close((int)socket);
+#endif
+	}
+
+	inline bool setNonBlocking(intptr_t socket) {
+#if defined(_WIN32)
+		u_long mode = 1;
+		return ioctlsocket((SOCKET)socket, FIONBIO, &mode) == 0;
+#else
+		int flags = fcntl((int)socket, F_GETFL, 0);
+		return flags >= 0 && fcntl((int)socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+	}
+
+	inline bool wouldBlock() {
+#if defined(_WIN32)
+		return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+	}
+
+	// Every successful listen() has to be paired with a release()
+	inline void release() {
+#if defined(_WIN32)
+		WSACleanup();
+#endif
+	}
+
+	// Returns a non-blocking socket listening on 127.0.0.1, INVALID on failure
+	inline intptr_t listen(int port) {
+#if defined(_WIN32)
+		WSADATA wsaData;
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return INVALID;
+#endif
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE)
+		signal(SIGPIPE, SIG_IGN);
+#endif
+		intptr_t listener = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (listener == INVALID) {
+			release();
+			return INVALID;
+		}
+		int reuse = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons((uint16_t)port);
+		if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(listener, 8) != 0 || !setNonBlocking(listener)) {
+			close(listener);
+			release();
+			return INVALID;
+		}
+		return listener;
+	}
+
+	// Returns a non-blocking client socket, INVALID if nobody is waiting
+	inline intptr_t accept(intptr_t listener) {
+		while (true) {
+			intptr_t socket = (intptr_t)::accept(listener, nullptr, nullptr);
+			if (socket == INVALID) return INVALID;
+			if (setNonBlocking(socket)) {
+				int noDelay = 1;
+				setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+#if defined(SO_NOSIGPIPE)
+				int noSignal = 1;
+				setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&noSignal, sizeof(noSignal));
+#endif
+				return socket;
+			}
+			close(socket);
+		}
+	}
+
+	// Returns the bytes sent, 0 if the socket is full and -1 if the connection is gone
+	inline int send(intptr_t socket, const char* data, size_t size) {
+		int sent = (int)::send(socket, data, (int)size, SEND_FLAGS);
+		if (sent >= 0) return sent;
+		return wouldBlock() ? 0 : -1;
+	}
+
+	// Returns the bytes received, 0 if there is nothing to read and -1 if the connection is gone
+	inline int receive(intptr_t socket, char* buffer, size_t size) {
+		int received = (int)recv(socket, buffer, (int)size, 0);
+		if (received > 0) return received;
+		if (received < 0 && wouldBlock()) return 0;
+		return -1;
+	}
+}
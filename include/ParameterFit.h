@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <ParameterSweep.h>
+
+/*
+	ParameterFit.h estimates parameters of the simulator from a measured
+	reactor log: the temperature reactivity curve, the Bezier curves of the
+	rods and the active cooling power. The rods of every candidate follow
+	the positions of the log and its power and fuel temperature are scored
+	against the measured ones:
+
+		MeasuredLog log;
+		if (!log.open("morning.txt")) std::cerr << log.error() << std::endl;
+		std::vector<FitBound> bounds = {
+			{ FitParameter::AlphaK, 0, 0, 0., 2. },
+			{ FitParameter::RodCurve, 1, 0, 0., 1. },
+			{ FitParameter::RodCurve, 1, 1, 0., 1. }
+		};
+		FitResult fit = fitParameters(settings, log, bounds);
+		applyFit(settings, bounds, fit);
+
+	The log is a text table, whitespace separated, with a header line that
+	names its columns: "time" (s) and "power" (W) are required, "temperature"
+	(fuel, C) and the rod positions "safety", "regulating" and "shim" (steps)
+	are used if they are there. Lines starting with # are skipped.
+
+	The start of the log is prepared once: the base settings are brought to
+	a stable state at the first power, the rods are moved to the first logged
+	positions and the state is kept in memory as a checkpoint. Every candidate
+	restores it and only then gets its parameters, as the checkpoint holds
+	the model parameters as well. The reactor was critical at the start of
+	the log, so the core excess reactivity of each candidate is set to keep
+	its start critical, a different rod curve or temperature coefficient
+	would otherwise start a transient the log doesn't have.
+
+	The optimiser is differential evolution within the bounds, a generation
+	of candidates is run at once on all cores (see runParallel).
+*/
+
+enum class FitParameter : std::uint8_t {
+	Alpha0,
+	AlphaAtT1,
+	AlphaT1,
+	AlphaK,
+	RodCurve,			// the Bezier control point of a rod, 0 or 1
+	CoolingPower		// W, used if the water cooling is on
+};
+
+struct FitBound {
+	FitParameter parameter;
+	size_t rod;			// of RodCurve
+	size_t point;		// of RodCurve
+	double lower, upper;
+};
+
+struct FitOptions {
+	size_t population = 0;			// candidates of a generation, 0 for ten per parameter
+	size_t generations = 60;
+	double differentialWeight = 0.6;
+	double crossover = 0.9;
+	// The fit ends early when the scores of the population are within this of the best one
+	double tolerance = 1e-6;
+	double temperatureScale = 5.;	// C, a difference this large scores as a factor e in power
+	bool balanceStart = true;		// sets the excess reactivity so that every candidate starts critical
+	uint64_t seed = 1;
+	unsigned threads = 0;			// 0 for all cores
+};
+
+struct FitResult {
+	std::vector<double> values;		// of the bounds, in their order
+	double score = 0.;				// mean square of the residuals
+	double excessReactivity = 0.;	// pcm, of the best candidate if the start was balanced
+	size_t generations = 0;
+	size_t evaluations = 0;
+	std::string error;				// the fit failed if it isn't empty
+};
+
+// A measured log with its columns, see above for the format
+class MeasuredLog {
+public:
+	enum Column { Time, Power, Temperature, SafetyRod, RegulatingRod, ShimRod, ColumnCount };
+
+	bool open(const std::string &fileName);
+	const std::string &error() const { return mError; }
+	size_t size() const { return mColumns[Time].size(); }
+	bool has(Column column) const { return !mColumns[column].empty(); }
+	const std::vector<double> &column(Column column) const { return mColumns[column]; }
+	// The rod position (steps) at the time, linear between the rows
+	double rodPosition(size_t rod, double time) const;
+
+private:
+	std::string mError;
+	std::vector<double> mColumns[ColumnCount];
+};
+
+// Throws std::out_of_range if the rod or the point doesn't exist
+void applyFitParameter(Settings &settings, const FitBound &bound, double value);
+void applyFitParameter(Simulator &simulator, const FitBound &bound, double value);
+// Writes the fitted values to the settings
+void applyFit(Settings &settings, const std::vector<FitBound> &bounds, const std::vector<double> &values);
+// Writes the fitted values and the excess reactivity the best candidate ran with, the settings then reproduce the fitted run
+void applyFit(Settings &settings, const std::vector<FitBound> &bounds, const FitResult &fit);
+// Such as "rod 1 curve 0", the rods count from 1 as in the sweeps
+std::string fitParameterName(const FitBound &bound);
+
+// Writes the checkpoint of the start of the log (see above) to start, returns false if the log can't be used
+bool prepareFitStart(const Settings &base, const MeasuredLog &log, std::string &start, std::string &error);
+/* Runs one candidate from the start checkpoint through the log and returns its score, infinity if
+the run failed or values doesn't have a value per bound. excessReactivity is set to the excess reactivity the candidate ran with. */
+double scoreFitCandidate(const Settings &base, const MeasuredLog &log, const std::string &start, const std::vector<FitBound> &bounds,
+	const std::vector<double> &values, const FitOptions &options, double *excessReactivity = nullptr);
+
+// Prepares the start and runs the optimiser, the progress is reported on cout
+FitResult fitParameters(const Settings &base, const MeasuredLog &log, const std::vector<FitBound> &bounds,
+	const FitOptions &options = FitOptions());
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include <Simulator.h>
+
+/*
+	ParameterSweep.h runs the same script on many variations of the settings,
+	one independent Simulator per variation on all cores, and collects a row
+	of results for each:
+
+		std::vector<SweepVariation> variations = sweepGrid({
+			{ { SweepParameter::RodWorth, 1, 3000. }, { SweepParameter::RodWorth, 1, 3500. } },
+			{ { SweepParameter::AlphaK, 0, 0.5 }, { SweepParameter::AlphaK, 0, 1. } }
+		});
+		saveSweep("sweep.txt", runSweep(Settings(), variations, script, 600.));
+
+	The runs don't record journals and report their progress on cout. The
+	simulators only touch the part of the data history they fill, a run of
+	an hour takes about 300 MB.
+*/
+
+enum class SweepParameter : std::uint8_t {
+	RodWorth,					// pcm, index is the rod
+	Beta,						// index is the delayed group
+	Lambda,						// 1/s, index is the delayed group
+	Alpha0,
+	AlphaAtT1,
+	AlphaT1,
+	AlphaK,
+	PromptNeutronLifetime,		// s
+	ExcessReactivity			// pcm
+};
+
+struct SweepChange {
+	SweepParameter parameter;
+	size_t index;
+	double value;
+};
+
+// The changes to the base settings of one run
+typedef std::vector<SweepChange> SweepVariation;
+
+struct SweepResult {
+	SweepVariation variation;
+	double peakPower = 0.;			// W
+	double maxFuelTemperature = 0.;	// C
+	double scramTime = -1.;			// s, negative without a SCRAM
+	double finalPower = 0.;			// W
+	double finalXenon = 0.;			// g/m3
+	std::string error;				// the run failed if it isn't empty
+};
+
+// Throws std::out_of_range if the index is not a rod or a delayed group
+void applySweepChange(Settings &settings, const SweepChange &change);
+// Such as "beta 2", for the columns of the table, rods and delayed groups count from 1
+std::string sweepChangeName(const SweepChange &change);
+// Every combination of one change from each axis
+std::vector<SweepVariation> sweepGrid(const std::vector<std::vector<SweepChange>> &axes);
+
+/* Runs the script (its timed commands and program) for duration simulated seconds on every
+variation of base. The results are in the order of the variations. threads is the number of
+runs at once, 0 for all cores. */
+std::vector<SweepResult> runSweep(const Settings &base, const std::vector<SweepVariation> &variations,
+	const Script &script, double duration, unsigned threads = 0);
+// Called after every frame of a run
+typedef std::function<void(Simulator&)> SweepObserver;
+SweepResult runSweepVariation(const Settings &base, const SweepVariation &variation, const Script &script, double duration,
+	const SweepObserver &observer = nullptr);
+// Calls run with every index below count on threads threads (0 for all cores), a free thread takes the next index
+void runParallel(size_t count, unsigned threads, const std::function<void(size_t)> &run);
+
+// Writes the results as a tab separated table with a header line, returns false if the file can't be written
+bool saveSweep(const std::string &fileName, const std::vector<SweepResult> &results);
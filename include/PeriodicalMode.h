@@ -72,6 +72,12 @@ public:
 
 	const float &getPeriod() { return period; }
 
+	// Saves or restores the waveform and its progress, used by checkpoints
+	template <class Archive>
+	void serialize(Archive& archive) {
+		archive(period, amplitude, time, isPaused, newPeriod, tracker);
+	}
+
 	bool isNewPeriod() { return newPeriod; }
 
 	bool getPaused() { return isPaused; }
@@ -130,6 +136,12 @@ public:
 	float xIndex[4] = { 0.f, 0.5f,0.5f,1.f };
 	SquareWave(float period_, float amplitude_) : PeriodicalMode(period_, amplitude_) { sim_mode = SimulationModes::SquareWaveMode; }
 
+	template <class Archive>
+	void serialize(Archive& archive) {
+		PeriodicalMode::serialize(archive);
+		archive(rodSpeed, xIndex);
+	}
+
 	float getCurrentOffset(float t) override {
 		if(t < 0) t = getPeriodTime();
 		if (rodSpeed) {
@@ -196,6 +208,12 @@ public:
 	SineMode mode = SineMode::Normal;
 	Sine(float period_, float amplitude_) : PeriodicalMode(period_, amplitude_) { sim_mode = SimulationModes::SineMode; }
 
+	template <class Archive>
+	void serialize(Archive& archive) {
+		PeriodicalMode::serialize(archive);
+		archive(mode);
+	}
+
 	float getCurrentOffset(float t) override {
 		if(t < 0) t = getPeriodTime();
 		double sinVal = 2. * M_PI * t;
@@ -234,6 +252,12 @@ public:
 	float xIndex[6] = { 0.f, 0.25f, 0.5f, 0.5f, 0.75f, 1.f };
 	SawTooth(float period_, float amplitude_) : PeriodicalMode(period_, amplitude_) { sim_mode = SimulationModes::SawToothMode; }
 
+	template <class Archive>
+	void serialize(Archive& archive) {
+		PeriodicalMode::serialize(archive);
+		archive(xIndex);
+	}
+
 	float getCurrentOffset(float t) override {
 		if(t < 0) t = getPeriodTime();
 		if (t < xIndex[0]) {
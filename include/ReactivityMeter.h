@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+
+/*
+	ReactivityMeter.h reconstructs the reactivity from the power alone,
+	as a digital reactivity meter does, by inverse point kinetics:
+
+		rho = beta + L / n dn/dt - sum of L lambda_i C_i / n
+
+	The precursors are not convolved over the whole history, every group
+	is a recursive filter of the power. With the power linear between two
+	samples the filter is exact, so each sample costs a few operations
+	per group and the samples don't have to be evenly spaced. There is no
+	neutron source term, like on a real meter the reading is wrong deep
+	below critical where the source holds the power up.
+*/
+
+class ReactivityMeter {
+public:
+	// The kinetics the meter assumes, the delayed groups that are switched off don't count
+	void setKinetics(double promptLifetime, const double* betas, const double* lambdas, const bool* enabled) {
+		mLifetime = promptLifetime;
+		mBeta = 0.;
+		for (int i = 0; i < 6; i++) {
+			mBetas[i] = enabled[i] ? betas[i] : 0.;
+			mLambdas[i] = lambdas[i];
+			mBeta += mBetas[i];
+		}
+		mFilterStep = -1.;
+	}
+
+	// Starts in equilibrium at the power, in any unit proportional to the neutrons
+	void reset(double power) {
+		mLast = power;
+		for (int i = 0; i < 6; i++) mDelayed[i] = mBetas[i] * power;
+	}
+
+	// Adds the power dt seconds after the previous one, returns the reactivity in pcm
+	double add(double power, double dt) {
+		if (!(dt > 0.) || !(mLast > 0.) || !(power > 0.)) {
+			if (power > 0.) reset(power);
+			return 0.;
+		}
+		if (dt != mFilterStep) {
+			mFilterStep = dt;
+			for (int i = 0; i < 6; i++) {
+				mDecay[i] = std::exp(-mLambdas[i] * dt);
+				mRamp[i] = mLambdas[i] > 0. ? (1. - mDecay[i]) / (mLambdas[i] * dt) : 1.; // the limit without decay
+			}
+		}
+		// delayed_i is L lambda_i C_i, its equation is d/dt = lambda_i (beta_i n - delayed_i)
+		double source = 0.;
+		for (int i = 0; i < 6; i++) {
+			mDelayed[i] = mDelayed[i] * mDecay[i] + mBetas[i] * (power - mLast * mDecay[i] - (power - mLast) * mRamp[i]);
+			source += mDelayed[i];
+		}
+		const double reactivity = mBeta + mLifetime * (power - mLast) / (dt * power) - source / power;
+		mLast = power;
+		return reactivity * 1e5;
+	}
+
+	// Reads a whole series, reactivity gets count values
+	void process(const double* time, const double* power, size_t count, float* reactivity) {
+		if (!count) return;
+		reset(power[0]);
+		reactivity[0] = 0.f;
+		for (size_t i = 1; i < count; i++) reactivity[i] = (float)add(power[i], time[i] - time[i - 1]);
+	}
+
+	template <class Archive>
+	void serialize(Archive& archive) {
+		archive(mDelayed, mLast);
+	}
+
+private:
+	double mLifetime = 0.;
+	double mBetas[6] = { 0. };
+	double mLambdas[6] = { 0. };
+	double mBeta = 0.;
+	// The state of the filters
+	double mDelayed[6] = { 0. };
+	double mLast = 0.;
+	// Factors of the filters for steps of mFilterStep seconds
+	double mFilterStep = -1.;
+	double mDecay[6] = { 0. };
+	double mRamp[6] = { 0. };
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <RunLogView.h>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+/*
+	ReferenceRun.h holds a reference trajectory (an exported run
+	or a measured reactor log) that is drawn over the live data,
+	and the deviation of the live run from it, which is updated
+	as the run goes on.
+*/
+
+class ReferenceRun {
+public:
+	// Running RMS and largest absolute difference of one quantity
+	struct Deviation {
+		double sumSquares = 0.;
+		double max = 0.;
+		size_t samples = 0;
+
+		void add(double difference) {
+			sumSquares += difference * difference;
+			max = std::max(max, std::abs(difference));
+			samples++;
+		}
+		double rms() const { return samples ? std::sqrt(sumSquares / samples) : 0.; }
+	};
+
+	// Opens the reference, its start is aligned to the live time
+	bool open(const std::string &fileName, double liveTime) {
+		if (!mLog.open(fileName)) return false;
+		alignTo(liveTime);
+		return true;
+	}
+	void close() { mLog.close(); resetDeviation(); }
+	bool isOpen() const { return mLog.isOpen(); }
+	const RunLogView &log() const { return mLog; }
+	const std::string &error() const { return mLog.error(); }
+
+	// The reference time is the live time minus the offset
+	double offset() const { return mOffset; }
+	double referenceTime(double liveTime) const { return liveTime - mOffset; }
+	// Makes the reference start at the live time and restarts the comparison
+	void alignTo(double liveTime) {
+		mOffset = liveTime - mLog.startTime();
+		resetDeviation();
+		mLastTime = liveTime;
+	}
+
+	/* Compares a live sample to the reference interpolated at the same time. Samples must
+	come in increasing time, so the whole run is compared in a single pass over the reference. */
+	void addSample(double liveTime, double power, double reactivity, double temperature) {
+		mLastTime = liveTime;
+		const double t = referenceTime(liveTime);
+		const size_t rows = mLog.size();
+		if (!rows || t < mLog.startTime() || t > mLog.endTime()) return;
+		const double* time = mLog.time();
+		while (mCursor + 1 < rows && time[mCursor + 1] <= t) mCursor++;
+		const size_t next = std::min(mCursor + 1, rows - 1);
+		const double w = (time[next] > time[mCursor]) ? (t - time[mCursor]) / (time[next] - time[mCursor]) : 0.;
+		auto at = [w](double a, double b) { return a + (b - a) * w; };
+
+		const double referencePower = at(mLog.power()[mCursor], mLog.power()[next]);
+		if (referencePower > 0.) mPower.add(100. * (power - referencePower) / referencePower);
+		mReactivity.add(reactivity - at(mLog.reactivity()[mCursor], mLog.reactivity()[next]));
+		mTemperature.add(temperature - at(mLog.temperature()[mCursor], mLog.temperature()[next]));
+	}
+
+	void resetDeviation() {
+		mPower = Deviation();
+		mReactivity = Deviation();
+		mTemperature = Deviation();
+		mCursor = 0;
+		mLastTime = -1.;
+	}
+	// Live time of the last compared sample, -1 before the first
+	double lastTime() const { return mLastTime; }
+
+	const Deviation &powerDeviation() const { return mPower; }				// %
+	const Deviation &reactivityDeviation() const { return mReactivity; }	// pcm
+	const Deviation &temperatureDeviation() const { return mTemperature; }	// C
+
+private:
+	RunLogView mLog;
+	double mOffset = 0.;
+	size_t mCursor = 0;
+	double mLastTime = -1.;
+	Deviation mPower, mReactivity, mTemperature;
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+
+/*
+	RemoteControl.h lets external programs (exam checkers, test
+	harnesses) operate the simulator over a local TCP socket.
+	Clients send JSON-RPC 2.0 requests, one per line, and receive
+	one response line per request that has an id. Like the
+	telemetry, everything runs on the simulation thread with
+	non-blocking sockets.
+
+	The server only reads requests and writes responses, the
+	methods are run by the Simulator (see Simulator::runRemoteRequest).
+	Every method accepts an optional "step" (simulation step) or
+	"time" (simulation seconds) parameter, the request is then held
+	back and run exactly at that step of the integration loop.
+
+	Methods, "rod" is a rod name or number and defaults to the regulating rod:
+		getState							time, power, reactivity, temperatures, rods ...
+		commandMove {rod, position}			position in steps
+		commandToTop {rod}
+		scram, resetScram
+		setOperationMode {rod, mode}		Manual, Simulation, Automatic or Pulse
+		pushStableState {power}				in W
+		setSpeedFactor {value}
+		command {command, value}			a script command, e.g. setAlpha0, except exitSimulator,
+											the file commands and starting or stopping the servers
+	The other methods answer with the step and time they ran at.
+*/
+
+// Bytes waiting for a client before it is dropped
+constexpr size_t REMOTE_CONTROL_MAX_BACKLOG = 4 << 20;
+// Longest accepted request line
+constexpr size_t REMOTE_CONTROL_MAX_REQUEST = 64 << 10;
+
+// JSON-RPC 2.0 error codes
+enum RemoteError {
+	ParseError = -32700,
+	InvalidRequest = -32600,
+	MethodNotFound = -32601,
+	InvalidParams = -32602
+};
+
+// A parsed JSON value, just enough for the requests
+class JsonValue {
+public:
+	enum Type : std::uint8_t {
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Type type = Null;
+	bool boolean = false;
+	double number = 0.;
+	std::string string;
+	std::vector<JsonValue> items;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	// Returns false if the text is not a single JSON value
+	static bool parse(const std::string &text, JsonValue &value);
+	// Writes the value back as JSON text
+	std::string dump() const;
+
+	// Member of an object, nullptr if there is none
+	const JsonValue* find(const std::string &name) const;
+	bool isNumber() const { return type == Number; }
+	bool isString() const { return type == String; }
+};
+
+// Builds the text of a JSON object member by member
+class JsonWriter {
+public:
+	JsonWriter& add(const char* name, double value);
+	JsonWriter& add(const char* name, int value) { return add(name, (double)value); }
+	JsonWriter& add(const char* name, size_t value) { return add(name, (double)value); }
+	JsonWriter& add(const char* name, bool value) { return raw(name, value ? "true" : "false"); }
+	JsonWriter& add(const char* name, const char* value) { return raw(name, quote(value)); }
+	JsonWriter& add(const char* name, const std::string &value) { return raw(name, quote(value)); }
+	// Adds already formatted JSON, e.g. another object or an array
+	JsonWriter& raw(const char* name, const std::string &json);
+	std::string str() const { return "{" + mText + "}"; }
+
+	static std::string quote(const std::string &value);
+	static std::string number(double value);
+
+private:
+	std::string mText;
+};
+
+struct RemoteRequest {
+	uint64_t client = 0;	// who gets the response
+	std::string id;			// JSON text of the id, empty for notifications
+	std::string method;
+	JsonValue params;
+};
+
+class RemoteControlServer {
+public:
+	RemoteControlServer() {}
+	~RemoteControlServer() { stop(); }
+	RemoteControlServer(const RemoteControlServer&) = delete;
+	RemoteControlServer& operator=(const RemoteControlServer&) = delete;
+
+	// Listens on the loopback interface, returns false if the port can't be used
+	bool start(int port);
+	void stop();
+	bool isRunning() const { return mListener != INVALID; }
+	int port() const { return mPort; }
+	size_t clients() const { return mClients.size(); }
+
+	/* Accepts clients, sends what is queued and appends the requests that arrived.
+	Requests that are not valid JSON-RPC are answered here and not returned. */
+	void poll(std::vector<RemoteRequest> &requests);
+	// Sends what is queued without reading new requests
+	void flush();
+
+	// Responses are dropped if the request was a notification or the client left
+	void respond(const RemoteRequest &request, const std::string &resultJson);
+	void respondError(const RemoteRequest &request, int code, const std::string &message);
+
+private:
+	static constexpr intptr_t INVALID = -1;
+
+	struct Client {
+		intptr_t socket = INVALID;
+		uint64_t id = 0;
+		std::string in;
+		std::string out;
+		size_t sent = 0;
+	};
+
+	void request(Client &client, const std::string &line, std::vector<RemoteRequest> &requests);
+	void queue(uint64_t client, const std::string &id, const std::string &member);
+	// Return false if the client has to be dropped
+	bool receive(Client &client, std::vector<RemoteRequest> &requests);
+	bool send(Client &client);
+	void drop(size_t index, const char* reason);
+
+	intptr_t mListener = INVALID;
+	int mPort = 0;
+	uint64_t mNextClient = 1;
+	std::vector<Client> mClients;
+};
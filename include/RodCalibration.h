@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <ParameterSweep.h>
+
+/*
+	RodCalibration.h repeats the positive period calibration of the control
+	rods headless: the rod is withdrawn in increments, each from a critical
+	reactor, the asymptotic period is measured from the power history and
+	converted to reactivity with the inhour equation. The increments add up
+	to the integral worth curve, which is compared to the curve of the rod
+	model (ControlRod::stepDataArray()).
+
+	Every increment is its own run from a stable state at low power, the
+	runs of all the rods go at once on all cores (see runParallel). The
+	reactor is made critical with the rod at the start of the increment by
+	the core excess reactivity, as the compensating rods would in the real
+	experiment. The temperature and fission poison feedback and the neutron
+	source are switched off by default, at the powers of the experiment
+	their effect is below the accuracy of the method. The period SCRAM is
+	off too, the largest increments can be shorter than its limit.
+*/
+
+struct RodCalibrationOptions {
+	size_t increments = 20;			// withdrawals from the bottom to the top
+	double power = 1.;				// W, before every withdrawal
+	double powerRatio = 1000.;		// an increment ends when the power rose this much
+	double maxTime = 300.;			// s, or after this long
+	bool feedback = false;			// keeps the temperature, poison and source effects of the settings
+	unsigned threads = 0;			// 0 for all cores
+};
+
+struct RodCalibrationPoint {
+	size_t position = 0;			// steps, the end of the increment
+	double period = 0.;				// s, negative if it couldn't be measured
+	double reactivity = 0.;			// pcm, of the increment from the period, 0 if it wasn't measured
+	double integral = 0.;			// pcm, measured up to the position
+	double modelIntegral = 0.;		// pcm, of the rod model at the position
+};
+
+struct RodCalibration {
+	size_t rod = 0;
+	std::string name;
+	std::vector<RodCalibrationPoint> points;
+	size_t failed = 0;				// increments whose period couldn't be measured
+	double rmsDifference = 0.;		// pcm, between the measured and the model integral, without the failed increments
+	double maxDifference = 0.;		// pcm
+};
+
+// The reactivity (pcm) of a stable period (s) of the point kinetics of the simulator
+double inhourReactivity(const Simulator &simulator, double period);
+
+// Calibrates the rods, the results are in the order of rods
+std::vector<RodCalibration> calibrateRods(const Settings &base, const std::vector<size_t> &rods,
+	const RodCalibrationOptions &options = RodCalibrationOptions());
+// Writes a tab separated table per rod, returns false if the file can't be written
+bool saveRodCalibration(const std::string &fileName, const std::vector<RodCalibration> &calibrations);
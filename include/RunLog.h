@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/*
+	RunLog.h describes the binary run log (.rrl) and a reader
+	that maps it into memory. The file is made of:
+		- RunLogHeader
+		- the simulator settings as JSON (Settings::saveArchive)
+		- a RunLogChannel entry for every channel
+		- one contiguous column per channel, aligned to RUN_LOG_ALIGNMENT
+	All values are stored in the native byte order of the writer, which is
+	little-endian on every platform the simulator runs on (x86 and ARM).
+*/
+
+constexpr auto RUN_LOG_VERSION = 1;
+constexpr auto RUN_LOG_ALIGNMENT = 64;
+constexpr auto RUN_LOG_EXTENSION = ".rrl";
+
+enum class RunLogType : uint32_t {
+	Float64 = 0,
+	Float32 = 1
+};
+
+struct RunLogHeader {
+	char magic[8];				// "RRSLOG" followed by two zero bytes
+	uint32_t version;
+	uint32_t channelCount;
+	uint64_t rowCount;			// number of values in every column
+	uint64_t settingsOffset;	// JSON with the settings of the run
+	uint64_t settingsSize;
+	uint64_t channelsOffset;	// table of RunLogChannel entries
+	int64_t created;			// time_t of the export
+	double timeStep;			// time between two rows (s), 0 if they are not evenly spaced
+};
+static_assert(sizeof(RunLogHeader) == 64, "Run log header must be 64 bytes");
+
+struct RunLogChannel {
+	char name[24];
+	char unit[16];
+	uint32_t type;				// RunLogType
+	uint32_t reserved;
+	uint64_t offset;			// of the column from the start of the file
+	uint64_t reserved2;
+};
+static_assert(sizeof(RunLogChannel) == 64, "Run log channel entry must be 64 bytes");
+
+// Memory-mapped, read-only access to a run log. Columns point directly into the mapping.
+class RunLogReader {
+public:
+	RunLogReader() {}
+	~RunLogReader() { close(); }
+	RunLogReader(const RunLogReader&) = delete;
+	RunLogReader& operator=(const RunLogReader&) = delete;
+
+	// Maps the file, returns false (see error()) if it is not a valid run log
+	bool open(const std::string &fileName);
+	void close();
+	bool isOpen() const { return mData != nullptr; }
+	const std::string &error() const { return mError; }
+
+	size_t rowCount() const { return isOpen() ? (size_t)header().rowCount : 0; }
+	size_t channelCount() const { return isOpen() ? (size_t)header().channelCount : 0; }
+	double timeStep() const { return header().timeStep; }
+	const RunLogHeader &header() const { return *(const RunLogHeader*)mData; }
+	const RunLogChannel &channel(size_t index) const { return ((const RunLogChannel*)(mData + header().channelsOffset))[index]; }
+	// Index of the channel with the name, -1 if there is none
+	int findChannel(const std::string &name) const;
+	std::string settings() const { return std::string(mData + header().settingsOffset, (size_t)header().settingsSize); }
+
+	// Pointer to the column, nullptr if the channel is of a different type
+	const double* float64(size_t index) const { return channel(index).type == (uint32_t)RunLogType::Float64 ? (const double*)(mData + channel(index).offset) : nullptr; }
+	const float* float32(size_t index) const { return channel(index).type == (uint32_t)RunLogType::Float32 ? (const float*)(mData + channel(index).offset) : nullptr; }
+	// Value of any channel converted to double
+	double value(size_t index, size_t row) const {
+		return channel(index).type == (uint32_t)RunLogType::Float64 ? float64(index)[row] : (double)float32(index)[row];
+	}
+
+private:
+	bool fail(const std::string &message);
+
+	const char* mData = nullptr;
+	size_t mSize = 0;
+	std::string mError;
+#if defined(_WIN32)
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
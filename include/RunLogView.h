@@ -0,0 +1,92 @@
+#pragma once
+
+#include <RunLog.h>
+#include <ReactivityMeter.h>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/*
+	RunLogView.h gives the GUI read-only access to an exported
+	run, so it can be browsed like the live data. Binary run logs
+	are used straight from the mapping, text logs (.dat) are parsed
+	once into columns owned by the view.
+*/
+
+// Number of rows summarised by one entry of the power table
+constexpr size_t RUN_LOG_VIEW_BLOCK = 1024;
+
+class RunLogView {
+public:
+	// The largest pulse found in the run
+	struct Pulse {
+		size_t startIndex = 0;
+		double timeAtMax = 0.;
+		double peakPower = 0.;
+		double FWHM = 0.;
+		double releasedEnergy = 0.;
+		double maxFuelTemp = 0.;
+	};
+
+	RunLogView() {}
+	RunLogView(const RunLogView&) = delete;
+	RunLogView& operator=(const RunLogView&) = delete;
+
+	// Opens a binary run log or a text data log, returns false (see error()) on failure
+	bool open(const std::string &fileName);
+	void close();
+	bool isOpen() const { return mRows > 0; }
+	const std::string &error() const { return mError; }
+	const std::string &fileName() const { return mFileName; }
+
+	size_t size() const { return mRows; }
+	// Columns of the run, valid until the view is closed
+	const double* time() const { return mTime; }
+	const double* power() const { return mPower; }
+	const float* reactivity() const { return mReactivity; }
+	const float* rodReactivity() const { return mRodReactivity; }
+	const float* temperature() const { return mTemperature; }
+	// Reactivity reconstructed from the power, null until computeMeterReactivity
+	const float* meterReactivity() const { return mMeterReactivity.empty() ? nullptr : mMeterReactivity.data(); }
+	// Runs the power of the run through the meter, which has the kinetics to assume
+	void computeMeterReactivity(ReactivityMeter meter);
+
+	double startTime() const { return mRows ? mTime[0] : 0.; }
+	double endTime() const { return mRows ? mTime[mRows - 1] : 0.; }
+	// First row at or after the time
+	size_t indexFromTime(double time) const;
+
+	/* Decimal orders of the smallest positive and of the largest power between the rows,
+	as the simulator's power extremes. Returns false if there is no positive power. */
+	bool powerOrders(size_t from, size_t to, int &low, int &high, bool &hasZero) const;
+
+	// Finds the largest pulse, false if the run has none
+	bool findPulse(Pulse &pulse) const;
+
+private:
+	struct PowerBlock {
+		double minPositive;
+		double max;
+		bool nonPositive;
+	};
+
+	bool openBinary(const std::string &fileName);
+	bool openText(const std::string &fileName);
+	void buildPowerTable();
+	bool fail(const std::string &message);
+
+	RunLogReader mReader;
+	std::string mFileName;
+	std::string mError;
+	size_t mRows = 0;
+	const double* mTime = nullptr;
+	const double* mPower = nullptr;
+	const float* mReactivity = nullptr;
+	const float* mRodReactivity = nullptr;
+	const float* mTemperature = nullptr;
+	// Columns of text logs and converted columns of binary logs
+	std::vector<double> mOwnedTime, mOwnedPower;
+	std::vector<float> mOwnedReactivity, mOwnedRodReactivity, mOwnedTemperature;
+	std::vector<float> mMeterReactivity;
+	std::vector<PowerBlock> mPowerTable;
+};
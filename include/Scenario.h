@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+/*
+	Scenario.h runs longer experiments as plain C++ procedures that wait
+	for the simulation, each on its own coroutine (ext/coro):
+
+		void approach(Scenario &scenario) {
+			Simulator &reactor = scenario.simulator;
+			reactor.regulatingRod()->commandMove((size_t)200);
+			scenario.sleep(60.);							simulated seconds
+			scenario.await([&] { return reactor.getCurrentPower() > 1e3; });
+			reactor.beginPulse();
+			scenario.awaitPulse();							reactor.getLastPulse() has the results
+		}
+
+	The simulator resumes a scenario before the step it waited for, so
+	any number of them interleave in the single simulation thread. Between
+	steps the scheduler only compares the step with the earliest wake-up
+	and checks the conditions of the awaiting scenarios.
+
+	A scenario that is stopped while it waits is unwound with the
+	ScenarioStopped exception, don't catch it with catch (...) in a body.
+*/
+
+// Stack of a scenario coroutine, in bytes
+constexpr size_t SCENARIO_STACK_SIZE = 256 << 10;
+
+class Simulator;
+class Scenario;
+
+typedef std::function<void(Scenario&)> ScenarioBody;
+
+// Thrown from the waits of a scenario that is stopped
+struct ScenarioStopped {};
+
+class Scenario {
+public:
+	Scenario(const std::string &name, Simulator &simulator, ScenarioBody body);
+	~Scenario();
+	Scenario(const Scenario&) = delete;
+	Scenario& operator=(const Scenario&) = delete;
+
+	// The waits may only be called from the body of this scenario
+	void sleep(double seconds);
+	void await(std::function<bool()> condition);
+	// Until the next pulse is over
+	void awaitPulse();
+
+	// Runs the body until it waits again, only the simulator calls it between steps
+	void resume();
+
+	const std::string &getName() const { return name; }
+	bool isFinished() const { return finished; }
+
+	Simulator &simulator;
+
+private:
+	friend class ScenarioScheduler;
+	struct Context;
+
+	bool due(size_t step) const { return condition ? condition() : wakeStep <= step; }
+	void yield();
+	static void run(void* argument);
+
+	std::unique_ptr<Context> context;
+	std::string name;
+	ScenarioBody body;
+	size_t wakeStep = 0;
+	std::function<bool()> condition;
+	bool started = false, running = false, finished = false, stopping = false;
+};
+
+class ScenarioScheduler {
+public:
+	void start(const std::string &name, Simulator &simulator, ScenarioBody body);
+	// Unwinds all scenarios
+	void clear();
+	// Moves the wake-ups when the step count jumps, after a checkpoint was loaded
+	void shift(int64_t steps);
+
+	bool empty() const { return scenarios.empty(); }
+	size_t size() const { return scenarios.size(); }
+	// Checked before every step, true if a scenario may want to run
+	bool due(size_t step) const { return step >= nextWake || awaiting; }
+	// The next scenario to resume at this step, nullptr when all of them wait
+	Scenario* next(size_t step);
+
+private:
+	std::vector<std::unique_ptr<Scenario>> scenarios;
+	size_t nextWake = SIZE_MAX;
+	size_t awaiting = 0;
+};
+
+// The scenarios that can be started by name, with the runScenario script command
+ScenarioBody findScenario(const std::string &name);
+std::vector<std::string> scenarioNames();
@@ -28,20 +28,57 @@ enum commands {
 	setRegulatingSteps,
 	setCvCoeffC,
 	setCvCoeffPropA,
-	setCvCoeffPropB
+	setCvCoeffPropB,
+	setDataLogPoints,
+	setDataLogMode,
+	startTelemetry,
+	stopTelemetry,
+	startRemoteControl,
+	stopRemoteControl,
+	saveCheckpoint,
+	loadCheckpoint,
+	saveJournal,
+	runScenario,
+	// Returned by hashit for names that are not commands, keep it last
+	unknownCommand
 };
 
 
 
+// What the value of a command must be, checked when the script is read
+enum class Operand {
+	None,		// not used, may be left out
+	Number,
+	Positive,
+	NonNegative,
+	Count,		// whole number from 1 up
+	Steps,		// rod position, a whole number of steps
+	Move,		// whole number of steps, negative moves down
+	Port,		// 0 for the default port
+	Choice,		// one of the names of the command, number is its index
+	Text		// file name
+};
+
 struct Command {
 	double timed;
 	std::string strCommand;
 	commands command;
-	std::string value;
+	std::string value;		// as written, for file names and messages
+	double number = 0.;		// the converted value of numeric and choice operands
 };
 
 commands hashit(std::string const& strCommand);
+Operand commandOperand(commands command);
+/* Checks the value for the command and stores the converted operand in command, so
+running it needs no parsing. Returns false with the reason in error. */
+bool compileCommand(const std::string &name, const std::string &value, Command &command, std::string &error);
+// Numeric operands that are computed while the script runs are checked with this
+bool operandValid(Operand operand, double number);
+const char* operandDescription(Operand operand);
+// The whole text has to be the number
+bool parseCommandNumber(const std::string &text, double &value);
 bool compareByTime(const Command& a, const Command& b);
+// Fails the stream if the command can't be compiled
 std::istream& operator>>(std::istream& is, Command& p);
 std::ostream& operator<<(std::ostream& os, const Command& p);
 
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <ScriptCommand.h>
+
+/*
+	ScriptProgram.h adds waiting for conditions, loops and variables to
+	scripts, so training scenarios can react to what the students do.
+	Lines that start with a time are timed commands as before, they run
+	at that time after the script was loaded. The other lines make the
+	program of the script, it starts when the script is loaded:
+
+		setRegulatingRod 300			a command without a time runs when the program gets to it
+		setRegulatingRod x + 50			numeric values can be expressions
+		wait 10s						simulated time
+		wait until power > 100kW		checked before every step of the integration
+		x = regulatingRod + 10			variables are created by the first assignment
+		if period < 10s ... else ... end
+		while scram == 0 ... end
+		repeat 5 ... end
+
+	Expressions have + - * / ( ), comparisons (< <= > >= == !=) and
+	and, or, not. Numbers can have a unit: W kW MW GW, ms s min h, pcm.
+	The simulation is read with the names of ScriptSignal: time and
+	scriptTime (s), power (W), period (s), reactivity (pcm), temperature
+	and waterTemperature (C), waterLevel (m, from the normal level),
+	regulatingRod, shimRod and safetyRod (steps) and scram (the SCRAM
+	signals, 0 without one).
+
+	Expressions are compiled to postfix ScriptOps, so a condition that
+	is checked every step costs a few operations on a small stack.
+*/
+
+// Deepest stack an expression may need
+constexpr size_t SCRIPT_STACK_SIZE = 32;
+// Statements a program may run in one step without waiting, a loop without a wait yields then
+constexpr size_t SCRIPT_STEP_BUDGET = 10000;
+
+enum class ScriptSignal : std::uint8_t {
+	Time,
+	ScriptTime,
+	Power,
+	Period,
+	Reactivity,
+	Temperature,
+	WaterTemperature,
+	WaterLevel,
+	RegulatingRod,
+	ShimRod,
+	SafetyRod,
+	Scram,
+	Count
+};
+
+struct ScriptOp {
+	enum Code : std::uint8_t {
+		Constant,
+		Variable,
+		Signal,
+		Negate,
+		Not,
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		Equal,
+		NotEqual,
+		And,
+		Or
+	};
+	Code code;
+	std::uint32_t index;	// of the variable or the ScriptSignal
+	double value;			// of a constant
+};
+
+// Postfix, evaluated left to right on a stack
+typedef std::vector<ScriptOp> ScriptExpression;
+
+struct ScriptStatement {
+	enum Kind : std::uint8_t {
+		Run,			// command, with the value evaluated from expression if there is one
+		Assign,			// variable = expression
+		Wait,			// expression seconds
+		WaitUntil,		// expression is true
+		JumpUnless,		// to target if expression is false
+		Jump			// to target
+	};
+	Kind kind = Run;
+	Command command;
+	ScriptExpression expression;
+	size_t variable = 0;
+	size_t target = 0;
+	size_t line = 0;		// in the script, for errors while running
+};
+
+struct ScriptProgram {
+	std::vector<ScriptStatement> statements;
+	std::vector<std::string> variableNames;
+
+	// Running
+	std::vector<double> variables;
+	size_t next = 0;			// statement
+	double startTime = 0.;		// when the script was loaded
+	double waitTime = -1.;		// the end of a Wait, negative if not waiting for a time
+
+	bool empty() const { return statements.empty(); }
+	bool finished() const { return next >= statements.size(); }
+};
+
+// A compiled script file
+struct Script {
+	std::vector<Command> timed;
+	ScriptProgram program;
+};
+
+/* Reads a script, see above. Empty lines and lines starting with # are skipped.
+Returns false with the line number and the reason of the first error in error,
+script is left as it was then. */
+bool compileScript(std::istream &is, Script &script, std::string &error);
+
+// Signals is called with a ScriptSignal and returns its value
+template <class Signals>
+double evaluateScript(const ScriptExpression &expression, const double* variables, Signals signal)
+{
+	double stack[SCRIPT_STACK_SIZE];
+	size_t top = 0;
+	for (const ScriptOp &op : expression) {
+		switch (op.code) {
+		case ScriptOp::Constant: stack[top++] = op.value; break;
+		case ScriptOp::Variable: stack[top++] = variables[op.index]; break;
+		case ScriptOp::Signal: stack[top++] = signal((ScriptSignal)op.index); break;
+		case ScriptOp::Negate: stack[top - 1] = -stack[top - 1]; break;
+		case ScriptOp::Not: stack[top - 1] = stack[top - 1] == 0.; break;
+		default: {
+			const double b = stack[--top];
+			double &a = stack[top - 1];
+			switch (op.code) {
+			case ScriptOp::Add: a += b; break;
+			case ScriptOp::Subtract: a -= b; break;
+			case ScriptOp::Multiply: a *= b; break;
+			case ScriptOp::Divide: a /= b; break;
+			case ScriptOp::Less: a = a < b; break;
+			case ScriptOp::LessEqual: a = a <= b; break;
+			case ScriptOp::Greater: a = a > b; break;
+			case ScriptOp::GreaterEqual: a = a >= b; break;
+			case ScriptOp::Equal: a = a == b; break;
+			case ScriptOp::NotEqual: a = a != b; break;
+			case ScriptOp::And: a = a != 0. && b != 0.; break;
+			case ScriptOp::Or: a = a != 0. || b != 0.; break;
+			default: break;
+			}
+		}
+		}
+	}
+	return top ? stack[top - 1] : 0.;
+}
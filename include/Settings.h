@@ -119,6 +119,16 @@ constexpr auto PULSE_START_DEFAULT = 0.;
 constexpr auto PULSE_END_AFTER_DEFAULT = 0.4;
 
 constexpr auto DEFAULT_DATA_DIVISION = 100;
+constexpr auto DEFAULT_EXPORT_POINTS = 6000;		// used by the shape-preserving exports
+
+// Frame pacing (frames per second)
+constexpr auto FRAME_RATE_DEFAULT = 60.;
+constexpr auto IDLE_FRAME_RATE_DEFAULT = 4.;	// used while the simulation is paused
+
+// Telemetry for external displays, on the loopback interface
+constexpr auto TELEMETRY_PORT_DEFAULT = 47800;
+// JSON-RPC remote control, on the loopback interface
+constexpr auto REMOTE_CONTROL_PORT_DEFAULT = 47801;
 
 // IMPORTANT
 const auto SETTINGS_NUMBER = 94;
@@ -294,6 +304,10 @@ public:
 
 	void saveArchive(std::string fileName) {
 		std::ofstream os(fileName);
+		saveArchive(os);
+	}
+
+	void saveArchive(std::ostream& os) {
 		cereal::JSONOutputArchive archive(os);
 
 		archive(rodSettings,
@@ -350,6 +364,10 @@ public:
 
 	void restoreArchive(std::string fileName) {
 		std::ifstream is(fileName);
+		restoreArchive(is);
+	}
+
+	void restoreArchive(std::istream& is) {
 		cereal::JSONInputArchive iarchive(is);
 
 		iarchive(rodSettings,
@@ -13,9 +13,21 @@
 #include <nanogui/DataDisplay.h>
 #include <Settings.h>
 #include <ScriptCommand.h>
+#include <ScriptProgram.h>
+#include <Scenario.h>
+#include <DataExporter.h>
+#include <RunLog.h>
+#include <Telemetry.h>
+#include <RemoteControl.h>
+#include <InputJournal.h>
+#include <ReactivityMeter.h>
 
 // Delta time
 constexpr auto DT_STEP = 0.001;
+// Steps between the keyframes the simulation can be rewound from, 10 simulated seconds
+constexpr size_t REWIND_KEYFRAME_STEPS = 10000;
+// Steps of a frame in the headless runs, like the GUI at 60 frames per second in real time
+constexpr size_t RUN_FRAME_STEPS = 16;
 
 constexpr auto AVOGADRO_NUM = 6.0221409e+23;
 constexpr auto XENON_MOLAR_MASS = 134.907;
@@ -159,6 +171,11 @@ public:
 		PowerExtreme() {
 			isZero = true;
 		}
+
+		template <class Archive>
+		void serialize(Archive& archive) {
+			archive(order, when, isZero);
+		}
 	};
 
 	struct PulseData {
@@ -187,10 +204,44 @@ public:
 		FH = 1
 	};
 
+	/* Takes a snapshot of the data and writes it in the background. Names ending with
+	RUN_LOG_EXTENSION are written as a binary run log, the rest as text to fileName.dat */
 	void dataToFile(std::string fileName);
+	DataExporter exporter;
 
 	void rodsToFile(std::string fileName);
 
+	// Streams the data to external subscribers, see Telemetry.h
+	TelemetryServer telemetry;
+	// Lets external programs operate the simulator, see RemoteControl.h
+	RemoteControlServer remote;
+
+	/* Saves the complete state to a checkpoint (see Checkpoint.h), with the whole
+	data history if history is set. Returns false if the file can't be written. */
+	bool saveCheckpoint(const std::string &fileName, bool history = false);
+	/* Restores a checkpoint, the settings stored in it are restored to settings if given.
+	Returns false and leaves the simulation as it was if the file can't be used. */
+	bool loadCheckpoint(const std::string &fileName, Settings* settings = nullptr);
+	// The same, kept in memory: the contents of a checkpoint file
+	std::string checkpointData(bool history = false);
+	bool restoreCheckpointData(const std::string &data, Settings* settings = nullptr);
+
+	// Records the inputs of the session, see InputJournal.h
+	InputJournal journal;
+	bool saveJournal(const std::string &fileName) const;
+	/* Repeats a recorded session as fast as the CPU allows, the settings it was recorded
+	with are restored to settings if given. Returns false if the journal can't be used
+	or the replay did not end in the recorded state. */
+	bool replayJournal(const std::string &fileName, Settings* settings = nullptr);
+
+	/* Takes the simulation back to the given time of the data history and resumes from
+	there. The keyframe before it is restored and the rest is calculated again with the
+	journaled inputs, what happened after the time is dropped from the journal. Returns
+	false if the time can't be rewound to. */
+	bool rewind(double time);
+	// Earliest time rewind can go back to, negative if it can't
+	double getRewindLimit() const;
+
 	void setDemoMode();
 	void setHighPowerDemoMode();
 
@@ -217,6 +268,14 @@ public:
 	void setNeutronSourceInserted(const bool& value);
 	bool source_inserted = NEUTRON_SOURCE_INSERTED_DEFAULT;
 	int data_division = DEFAULT_DATA_DIVISION;
+	// How dataToFile thins the data: every data_division-th step, or exportPoints shape-preserving points
+	enum class ExportThinning : std::uint8_t {
+		Division = 0,
+		LTTB = 1,
+		MinMax = 2
+	};
+	ExportThinning exportThinning = ExportThinning::Division;
+	size_t exportPoints = DEFAULT_EXPORT_POINTS;
 	// Toggles the temperature effects (enabled/disabled)
 	const bool& getTemperatureEffectsEnabled() const;
 	void setTemperatureEffectsEnabled(const bool& value);
@@ -234,6 +293,8 @@ public:
 	const size_t getNextIndex() const {
 		return iterations_total % dataPoints;
 	}
+	// Number of integration steps since start, changes whenever new data is produced
+	const size_t getTotalIterations() const { return iterations_total; }
 	const size_t shiftIndex(size_t index, long shift) const {
 		if (shift + (long)index >= (long)dataPoints) {
 			return (shift + index) % dataPoints;
@@ -428,6 +489,12 @@ public:
 	const float *getRodReactivity() const;
 	float* rodReactivity_;
 
+	// Reactivity (in pcm) reconstructed from the power alone, see ReactivityMeter.h
+	float getCurrentMeterReactivity() const { return meterReactivity_[getCurrentIndex()]; }
+	const float *getMeterReactivity() const { return meterReactivity_; }
+	float* meterReactivity_;
+	ReactivityMeter reactivityMeter;
+
 	// Returns the current temperature(in kelvin) in the reactor.
 	float getCurrentTemperature() const;
 	// Returns the entire data array for temperature.
@@ -523,9 +590,14 @@ public:
 	void setScramCallback(const std::function<void(int)> &callback);
 	void setResetScramCallback(const std::function<void()> &callback);
 	void setSevereErrorCallback(const std::function<void(int)> &callback);
+	// Called after a checkpoint was restored
+	void setStateRestoredCallback(const std::function<void()> &callback);
 	
 	// Set the pulse callback
 	void setPulseCallback(const std::function<void(PulseData)> &callback);
+	// The results of the last pulse and the number of pulses that ended since the start
+	const PulseData &getLastPulse() const { return lastPulse; }
+	size_t getPulsesFinished() const { return pulsesFinished; }
 
 	// Sets or gets the automatic hold power
 	double powerHold;
@@ -552,7 +624,13 @@ public:
 	double getAlphaSlope() { return alphaK; }
 	void setAlphaSlope(double value) { alphaK = value; }
 
+	// Calculates the steps due since the last call, at the speed factor
 	void runLoop();
+	// Calculates one frame of the given number of steps without looking at the clock, for headless runs
+	void runFrame(size_t steps);
+	/* Calculates the simulated seconds in frames of frameSteps. The observer gets the steps of
+	every frame after it and stops the run by returning false. Returns the steps calculated. */
+	size_t run(double seconds, size_t frameSteps = RUN_FRAME_STEPS, const std::function<bool(size_t)> &observer = nullptr);
 
 	/*
 	Should recieve a pointer to a double array of size 7
@@ -569,6 +647,8 @@ public:
 	const size_t getDataLength() const { return dataPoints; }
 
 	void setProperties(Settings* nodes);
+	// Settings last applied with setProperties, stored in binary run logs
+	Settings* appliedSettings = nullptr;
 
 	void resetSimulator();
 
@@ -576,8 +656,17 @@ public:
 
 	void setAutoScram(bool value) { autoScramAfterPulse = value; }
 
+	// Runs the script commands that are due, called from mainLoop before every step
 	void doScriptCommands();
-	std::vector<Command> scriptCommands;
+	// Queues a script command for its time, commands with the same time run in the order they were added
+	void addScriptCommand(const Command &command);
+	// Starts the program of a script (see ScriptProgram.h), its times are counted from now
+	void addScriptProgram(ScriptProgram program);
+	size_t getScriptCommandsLeft() const { return scriptCommands.size() + scriptPrograms.size() + scenarios.size(); }
+	// Starts a scenario coroutine (see Scenario.h) before the next step
+	void startScenario(const std::string &name, ScenarioBody body);
+	// Runs a single script command right away
+	void runScriptCommand(const Command &command);
 
 private:
 	bool pulsing = false;
@@ -589,14 +678,34 @@ private:
 	double time_at_peak = 0;
 	double pulse_startP = 0;
 	bool autoScramAfterPulse = AUTOMATIC_PULSE_SCRAM_DEFAULT;
+	PulseData lastPulse;
+	size_t pulsesFinished = 0;
 	
 	double ns_activity_temp = NEUTRON_SOURCE_ACTIVITY_DEFAULT;
 	double doseRate = 0;
 
 	// Variables controlling execution of the script
 	double scriptStart = 0.;
-	
-	double scriptTimer = 0;
+
+	struct ScheduledCommand {
+		Command command;
+		uint64_t order;
+		// The heap keeps the greatest at the front, which is the earliest command here
+		bool operator<(const ScheduledCommand &other) const {
+			return command.timed > other.command.timed || (command.timed == other.command.timed && order > other.order);
+		}
+	};
+	// Commands waiting for their time as a heap (std::push_heap), the next one is at the front
+	std::vector<ScheduledCommand> scriptCommands;
+	uint64_t scriptOrder = 0;
+	// Running programs, they continue before every step until they wait
+	std::vector<ScriptProgram> scriptPrograms;
+	void runScriptPrograms();
+	bool runScriptProgram(ScriptProgram &program);
+	double scriptSignal(ScriptSignal signal, const ScriptProgram &program);
+	// Scenarios waiting for a step or a condition
+	ScenarioScheduler scenarios;
+	void resumeScenarios();
 
 	// Increment neutron source simtulation time
 	void advanceSourceTime(double dt) { if(source_mode != SimulationModes::None) getSourceModeClass(source_mode)->handleAddTime((float)dt); };
@@ -618,6 +727,8 @@ private:
 
 	// Recalculate effective beta and lambda after change of "groups enabled"
 	void recalculateLambdaBetaEffective();
+	// Gives the reactivity meter the current kinetics parameters
+	void updateReactivityMeter();
 
 	// Method for derivatives
 	void neutronChange(double* new_state, double* prev_state, double rho);
@@ -626,8 +737,32 @@ private:
 	size_t iterations_total = 0;
 	size_t frames_total = 0;
 
+	// Sends the steps calculated since the last call to the telemetry subscribers
+	void publishTelemetry();
+	size_t telemetryStep = 0;
+	std::vector<double> telemetryRows;
+
+	// Reads the remote control requests and runs the ones that are due
+	void pollRemoteControl();
+	// Runs the requests scheduled for the current step, called from mainLoop
+	void runScheduledRequests();
+	void runRemoteRequest(const RemoteRequest &request);
+	// The rod named or numbered by the "rod" parameter, the regulating rod if there is none
+	ControlRod* remoteRod(const JsonValue &params);
+	std::string remoteState();
+	struct ScheduledRequest {
+		size_t step;
+		RemoteRequest request;
+	};
+	// Requests for later steps, sorted by step
+	std::deque<ScheduledRequest> remoteSchedule;
+	std::vector<RemoteRequest> remoteRequests;
+
 	deque<PowerExtreme>* powerExtremes = nullptr;
 
+	// Samples added since the last frame or since the history was replaced, counted by mainLoop and pushStableState
+	size_t frameSamples = 0;
+	void takeFrameSamples();
 	void addPowerExtremes();
 
 	void checkPulsingStatus();
@@ -659,6 +794,62 @@ private:
 	std::function<void()> scramResetCallback;
 	std::function<void(PulseData)> pulseCallback;
 	std::function<void(int)> severeErrorCallback;
+	std::function<void()> stateRestoredCallback;
+
+	// Everything in a checkpoint except the samples and the values tied to step numbers
+	template <class Archive>
+	void serializeState(Archive &archive);
+	// The part of the state that determines the calculation, without the power extremes
+	template <class Archive>
+	void serializeModel(Archive &archive);
+	// Also recalculates the rod data if the rod steps or curves changed
+	template <class Archive>
+	void restoreModel(Archive &archive);
+	// count samples of all channels from the index first on, wrapping around the buffers
+	template <class Archive>
+	void serializeSamples(Archive &archive, size_t first, size_t count);
+	// Restores the contents of a checkpoint, fileName names it in the messages
+	bool restoreCheckpoint(const std::string &text, const std::string &fileName, Settings* settings);
+
+	// Everything the inputs can change: the model, the step numbers and the latest sample
+	std::string journalSnapshot();
+	void applySnapshot(const std::string &snapshot);
+	// Starts the journal again from the current state, after a reset or restore
+	void journalStart();
+	void restoreJournalStart(const std::string &state, Settings* settings);
+	// Inputs are journaled as the changes from the state taken by journalMark
+	void journalMark();
+	void journalInput(JournalRecord type, const std::string &label);
+	void journalFrameEnd();
+	std::string journalBase;
+	size_t journalBaseStep = 0;
+	size_t journalCheckStep = 0;
+	bool journalFrameOpen = false;
+	bool journalRestart = false;
+
+	// Inputs of a replayed journal that are applied in the middle and at the end of a frame
+	std::deque<InputJournal::Entry> replayStepInputs;
+	std::deque<InputJournal::Entry> replayFrameInputs;
+	void replayInput(const InputJournal::Entry &input, bool report = true);
+	void replayStepInputsDue();
+	void replayDiverged(uint64_t step, const std::string &where);
+	bool replayExact = true;
+	size_t replayInputs = 0;
+
+	// Journal snapshots every REWIND_KEYFRAME_STEPS, each one is stored as its changes from the one before
+	struct Keyframe {
+		size_t step = 0;
+		size_t journalSize = 0;	// the journal continues from here
+		std::string changes;
+	};
+	std::deque<Keyframe> keyframes;
+	// Whole states of the first and the last keyframe
+	std::string keyframeFirst;
+	std::string keyframeLast;
+	size_t keyframeStep = 0;
+	void addKeyframe();
+	// Drops the journal before a keyframe when it grows past JOURNAL_TRIM_SIZE
+	void trimJournal();
 
 	static std::string formatTime(double t) {
 		size_t time[4];
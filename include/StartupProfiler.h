@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <iomanip>
+
+/*
+	StartupProfiler.h records the duration of the startup
+	phases and prints them as a report once the first frame
+	is drawn
+*/
+
+class StartupProfiler {
+private:
+	typedef std::chrono::steady_clock clock;
+	struct Phase {
+		std::string name;
+		double end;			// ms since the profiler was created
+		double duration;	// ms
+	};
+	clock::time_point start;
+	std::vector<Phase> phases;
+	bool reported = false;
+public:
+	StartupProfiler() : start(clock::now()) {}
+
+	// Time since the profiler was created (ms)
+	double elapsed() const {
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	}
+
+	// Ends the current phase, which started at the previous mark
+	void mark(const std::string &name) {
+		double now = elapsed();
+		phases.push_back({ name, now, phases.size() ? now - phases.back().end : now });
+	}
+
+	bool done() const { return reported; }
+
+	void report(std::ostream &out) {
+		reported = true;
+		out << "=========== Startup report ===========" << std::endl;
+		out << std::fixed << std::setprecision(1);
+		for (const Phase &p : phases) {
+			out << std::setw(9) << p.duration << " ms  " << p.name << std::endl;
+		}
+		out << std::setw(9) << (phases.size() ? phases.back().end : 0.) << " ms  total" << std::endl;
+		out.unsetf(std::ios::floatfield);
+		out << std::setprecision(6);
+		out << "======================================" << std::endl;
+	}
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+	Telemetry.h publishes the simulation to external programs
+	(wall displays, logging boxes) over a local TCP socket.
+	Everything runs on the simulation thread with non-blocking
+	sockets; a subscriber that can't keep up is disconnected
+	instead of slowing the simulation down.
+
+	A subscriber may send text lines:
+		channels <name> <name> ...	sample channels to receive (all by default)
+		decimation <n>				receive every n-th step
+	It receives binary frames, the structs below copied as they are in memory,
+	so in the byte order of the simulator's host (little-endian on x86 and ARM).
+	Each frame is a TelemetryFrameHeader followed by the payload:
+		Hello	the channel names, separated by '\n'
+		Samples	TelemetrySamples, then count rows of one double per selected channel
+		State	TelemetryState
+		Scram	TelemetryScram
+*/
+
+constexpr auto TELEMETRY_VERSION = 1;
+// Bytes waiting for a subscriber before it is dropped
+constexpr size_t TELEMETRY_MAX_BACKLOG = 8 << 20;
+// Most rows sent in one samples frame
+constexpr size_t TELEMETRY_MAX_ROWS = 4096;
+
+enum class TelemetryFrame : uint16_t {
+	Hello = 0,
+	Samples = 1,
+	State = 2,
+	Scram = 3
+};
+
+struct TelemetryFrameHeader {
+	char magic[4];			// "RRST"
+	uint16_t version;
+	uint16_t type;			// TelemetryFrame
+	uint64_t sequence;		// counts the frames sent to the subscriber
+	uint32_t size;			// of the payload
+	uint32_t reserved;
+};
+static_assert(sizeof(TelemetryFrameHeader) == 24, "Telemetry frame header must be 24 bytes");
+
+struct TelemetrySamples {
+	uint64_t firstStep;		// simulation step of the first row
+	uint32_t decimation;	// steps between two rows
+	uint32_t channels;		// bit mask of the channels in every row
+	uint32_t count;			// number of rows
+	uint32_t reserved;
+};
+
+// Sent once per frame of the simulator
+struct TelemetryState {
+	double time;
+	double period;
+	double waterTemperature;
+	float rodPositions[3];	// raw fraction, 0 is fully inserted
+	uint32_t scramStatus;	// Simulator::ScramSignals
+};
+
+struct TelemetryScram {
+	double time;
+	uint32_t status;		// all active signals
+	uint32_t reason;		// the signal that caused this SCRAM
+};
+
+class TelemetryServer {
+public:
+	// Columns of the rows passed to publish()
+	enum Channel {
+		Time = 0,
+		Power,
+		Reactivity,
+		RodReactivity,
+		Temperature,
+		Xenon,
+		Iodine,
+		Delayed1,
+		Delayed2,
+		Delayed3,
+		Delayed4,
+		Delayed5,
+		Delayed6,
+		ChannelCount
+	};
+	static const char* channelName(int channel);
+
+	TelemetryServer() {}
+	~TelemetryServer() { stop(); }
+	TelemetryServer(const TelemetryServer&) = delete;
+	TelemetryServer& operator=(const TelemetryServer&) = delete;
+
+	// Listens on the loopback interface, returns false if the port can't be used
+	bool start(int port);
+	void stop();
+	bool isRunning() const { return mListener != INVALID; }
+	int port() const { return mPort; }
+	size_t subscribers() const { return mSubscribers.size(); }
+
+	// Queues count steps of ChannelCount values each, firstStep is the step of the first row
+	void publish(uint64_t firstStep, size_t count, const double* rows);
+	void publishState(const TelemetryState &state);
+	void publishScram(const TelemetryScram &scram);
+	// Accepts subscribers, reads their requests and sends what is queued
+	void poll();
+
+private:
+	static constexpr intptr_t INVALID = -1;
+
+	struct Subscriber {
+		intptr_t socket = INVALID;
+		std::vector<char> out;
+		size_t sent = 0;
+		std::string in;
+		uint32_t channels = (1u << ChannelCount) - 1;
+		uint32_t decimation = 1;
+		uint64_t sequence = 0;
+	};
+
+	void queue(Subscriber &subscriber, TelemetryFrame type, const void* payload, size_t size, const void* rows = nullptr, size_t rowsSize = 0);
+	void request(Subscriber &subscriber, const std::string &line);
+	// Returns false if the subscriber has to be dropped
+	bool flush(Subscriber &subscriber);
+	bool receive(Subscriber &subscriber);
+	void drop(size_t index, const char* reason);
+
+	intptr_t mListener = INVALID;
+	int mPort = 0;
+	std::vector<Subscriber> mSubscribers;
+	std::vector<double> mScratch;
+};
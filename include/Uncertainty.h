@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <random>
+#include <ParameterSweep.h>
+
+/*
+	Uncertainty.h propagates the uncertainty of the kinetics and thermal
+	parameters with Monte Carlo: every realisation samples the parameters
+	from their distributions, runs the script on its own Simulator (see
+	ParameterSweep.h) and adds its power and fuel temperature to envelopes,
+	the mean and quantiles at every interval of the run.
+
+	Realisation i draws from its own generator, seeded with the seed and i,
+	so the samples don't depend on which thread ran it. The quantiles are
+	P-square estimates (Jain and Chlamtac), five markers per quantile and
+	point, so the memory doesn't grow with the number of realisations. They
+	depend slightly on the order the realisations finished in.
+*/
+
+struct ParameterDistribution {
+	enum Kind : std::uint8_t {
+		Normal,			// a is the mean, b the standard deviation
+		LogNormal,		// a is the median, b the standard deviation of the logarithm
+		Uniform			// between a and b
+	};
+	SweepParameter parameter;
+	size_t index;		// the rod or the delayed group
+	Kind kind;
+	double a, b;
+};
+
+struct UncertaintyOptions {
+	size_t realisations = 1000;
+	double duration = 600.;			// simulated seconds of every realisation
+	double interval = 0.1;			// s between the points of the envelopes
+	std::vector<double> quantiles = { 0.05, 0.5, 0.95 };
+	uint64_t seed = 1;
+	unsigned threads = 0;			// 0 for all cores
+	size_t writeEvery = 100;		// realisations between the updates of the envelope file
+};
+
+// Streaming estimate of a single quantile
+class QuantileEstimator {
+public:
+	explicit QuantileEstimator(double quantile = 0.5) : p(quantile) {}
+	void add(double x);
+	double value() const;
+	size_t count() const { return n; }
+
+private:
+	double p;
+	size_t n = 0;
+	double heights[5];
+	double positions[5];
+	double desired[5];
+};
+
+class UncertaintyEnvelope {
+public:
+	enum Channel { Power, Temperature, ChannelCount };
+
+	UncertaintyEnvelope(size_t points, double interval, const std::vector<double> &quantiles);
+	// Adds a realisation, values has points values of every channel, the channels one after another
+	void add(const std::vector<float> &values);
+	size_t points() const { return mPoints; }
+	size_t realisations() const { return mRealisations; }
+	double mean(Channel channel, size_t point) const { return mMean[channel * mPoints + point]; }
+	double quantile(Channel channel, size_t point, size_t quantile) const { return mEstimators[(channel * mPoints + point) * mQuantiles.size() + quantile].value(); }
+	// A tab separated table with the time, then the mean and the quantiles of each channel
+	bool save(const std::string &fileName) const;
+
+private:
+	size_t mPoints;
+	double mInterval;
+	std::vector<double> mQuantiles;
+	size_t mRealisations = 0;
+	std::vector<double> mMean;
+	std::vector<QuantileEstimator> mEstimators;
+};
+
+// Draws a value of every parameter
+SweepVariation sampleVariation(const std::vector<ParameterDistribution> &distributions, std::mt19937_64 &random);
+
+/* Runs the realisations in parallel. If fileName isn't empty the envelopes are written to it every
+options.writeEvery realisations and at the end. Realisations that fail are left out. */
+UncertaintyEnvelope runUncertainty(const Settings &base, const std::vector<ParameterDistribution> &distributions,
+	const Script &script, const UncertaintyOptions &options, const std::string &fileName = "");
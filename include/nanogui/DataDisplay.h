@@ -2,6 +2,8 @@
 
 #include <nanogui/widget.h>
 #include <nanovg.h>
+#include <cmath>
+#include <cstdio>
 
 NAMESPACE_BEGIN(nanogui)
 
@@ -65,10 +67,10 @@ public:
 	void setPointerColor(const Color &pointer_color) { pointerColor = pointer_color; }
 
 	const DisplayMode &getDisplayMode() const { return numberMode; }
-	void setDisplayMode(const DisplayMode &mode) { numberMode = mode; }
+	void setDisplayMode(const DisplayMode &mode) { numberMode = mode; textValid = false; }
 
 	const std::string &getUnit() const { return unit; }
-	void setUnit(const std::string &unit_) { unit = unit_; }
+	void setUnit(const std::string &unit_) { unit = unit_; textValid = false; }
 
 	const std::string &getFontFace() const { return mFontFace; }
 	void setFontFace(const std::string &font) { mFontFace = font; }
@@ -98,7 +100,7 @@ public:
 		}
 		else
 		{
-			nvgText(ctx, xNow, yNow + yRange, formatNumber(currentData).c_str(), NULL);
+			nvgText(ctx, xNow, yNow + yRange, numberText(), NULL);
 		}
 
 		if (pointerShown) {
@@ -121,50 +123,86 @@ public:
 		unit = "";
 	}
 private:
-	std::string formatNumber(double value) {
-		std::string ret = "";
+	// The displayed text is only formatted again when the value at its display precision changes
+	char text[48] = "";
+	double textKey = 0.;
+	bool textValid = false;
+
+	double displayKey(double value) const {
+		switch (numberMode) {
+		case DisplayMode::Integer: return (double)(int)value;
+		case DisplayMode::FixedDecimalPlaces1: return std::round(value * 1e1);
+		case DisplayMode::FixedDecimalPlaces2: return std::round(value * 1e2);
+		case DisplayMode::FixedDecimalPlaces3: return std::round(value * 1e3);
+		case DisplayMode::FixedDecimalPlaces4: return std::round(value * 1e4);
+		case DisplayMode::Scientific: {
+			if (!(value > 0.)) return value;
+			int order;
+			double mantissa = scientificMantissa(value, order);
+			// The mantissa as displayed, 3 significant digits, below 1000 so the order can go above it
+			const double scale = mantissa >= 100. ? 1. : std::pow(10., 2 - (int)std::floor(std::log10(mantissa)));
+			return std::round(mantissa * scale) / scale + order * 1000.;
+		}
+		default: return value;
+		}
+	}
+
+	// Splits the value into an engineering order (a power of 1000) and the mantissa shown with it
+	static double scientificMantissa(double value, int &order) {
+		order = value != 0. ? (int)(floor(log10(value) / 3.f)) : 0;
+		return value / pow(10, order * 3);
+	}
+
+	const char* numberText() {
+		double key = displayKey((double)currentData);
+		if (!textValid || key != textKey) {
+			formatNumber((double)currentData, text, sizeof(text));
+			textKey = key;
+			textValid = true;
+		}
+		return text;
+	}
+
+	// Formats the value with its unit into the buffer, without allocating
+	void formatNumber(double value, char* buffer, size_t size) {
+		int len = 0;
 		switch (numberMode) {
 		case DisplayMode::Integer:
-			ret = std::to_string((int)value);
+			len = std::snprintf(buffer, size, "%d", (int)value);
 			break;
 		case DisplayMode::Double:
-			ret = std::to_string(value);
+			len = std::snprintf(buffer, size, "%f", value);
 			break;
 		case DisplayMode::FixedDecimalPlaces1:
-			ret = formatDecimals(value, 1);
+			len = formatDecimals(buffer, size, value, 1);
 			break;
 		case DisplayMode::FixedDecimalPlaces2:
-			ret = formatDecimals(value, 2);
+			len = formatDecimals(buffer, size, value, 2);
 			break;
 		case DisplayMode::FixedDecimalPlaces3:
-			ret = formatDecimals(value, 3);
+			len = formatDecimals(buffer, size, value, 3);
 			break;
 		case DisplayMode::FixedDecimalPlaces4:
-			ret = formatDecimals(value, 4);
+			len = formatDecimals(buffer, size, value, 4);
 			break;
 		case DisplayMode::Scientific:
 			int order;
-			if (value != 0.) {
-				order = (int)(floor(log10(value) / 3.f));
-			}
-			else {
-				order = 0;
-			}
-			double newValue = value / pow(10, order * 3);
+			double newValue = scientificMantissa(value, order);
 			if (newValue >= 999.5) {
 				newValue = 1.;
 				order++;
-				ret = "1";
+				len = std::snprintf(buffer, size, "1");
 			} else if (newValue >= 100.) {
-				ret = std::to_string((int)round(newValue));
+				len = std::snprintf(buffer, size, "%d", (int)round(newValue));
 			} else {
-				ret = formatDecimals(newValue, 2 - (int)floor(log10(newValue)));
+				len = formatDecimals(buffer, size, newValue, 2 - (int)floor(log10(newValue)));
 			}
-			ret += " " + ((order > -7 && order < 13 && order != 0) ? std::string(utf8(units[order + 6]).data()) : "") + unit;
-			return ret;
+			len = std::min(std::max(len, 0), (int)size - 1);
+			std::snprintf(buffer + len, size - len, " %s%s", (order > -7 && order < 13 && order != 0) ? utf8(units[order + 6]).data() : "", unit.c_str());
+			return;
 		}
-		ret += " " + unit;
-		return ret;
+		len = std::min(std::max(len, 0), (int)size - 1);
+		std::snprintf(buffer + len, size - len, " %s", unit.c_str());
 	}
 };
 
@@ -4,6 +4,10 @@
 #include <deque>
 #include <cmath>
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 
 using nanogui::Color;
 using std::deque;
@@ -91,7 +95,6 @@ protected:
 	float pixelDrawRatio = 1.f;
 	string plotUnits = "";
 	string horizontalUnits = "";
-	string formatted = "";
 	std::string name = "Untitled";
 	std::string nameHorizontal = "Untitled";
 	std::string mOverrideLimitLabels[4] = { "","","","" };
@@ -113,7 +116,7 @@ public:
 	const bool &getEnabled() const { return enabled; }
 	void setEnabled(bool value) { enabled = value; }
 	const bool &getRoundFloating() const { return roundFloating; }
-	void setRoundFloating(bool value) { roundFloating = value; }
+	void setRoundFloating(bool value) { roundFloating = value; invalidateAxisLabels(); }
 	const bool &getAxisShown() const { return axisShown; }
 	void setAxisShown(bool value) { axisShown = value; }
 	const bool &getYlog() const { return ylog; }
@@ -204,7 +207,7 @@ public:
 	void setLimitHorizontalMultiplier(double value) { horizontalMultiplier = value; }
 	const double &getLimitHorizontalMultiplier() { return horizontalMultiplier; }
 
-	void setNumberFormatMode(FormattingMode value) { numberFormat = value; }
+	void setNumberFormatMode(FormattingMode value) { numberFormat = value; invalidateAxisLabels(); }
 	const FormattingMode &getNumberFormatMode() const { return numberFormat; }
 	void setHorizontalNumberFormatMode(FormattingMode value) { horizontalNumberFormat = value; }
 	const FormattingMode &getHorizontalNumberFormatMode() const { return horizontalNumberFormat; }
@@ -228,55 +231,66 @@ public:
 	double * limits() { return mLimits; }
 	double * logLimits() { return mLogLimits; }
 
-	const string formatNumber(double number) {		
-		string suffix = "";
-		if (numberFormat == FormattingMode::Normal) {
-			formatted = format2(number);
+	// Formats the number into the buffer, without allocating
+	void formatNumber(double number, char* buffer, size_t size) {
+		int len = 0;
+		int low = 0;
+		if (numberFormat == FormattingMode::Exponential && number == 0) {
+			len = std::snprintf(buffer, size, "0");
 		}
-		else if (numberFormat == FormattingMode::Exponential) {
-			if (number == 0) {
-				formatted = "0";
-			}
-			else {
-				int low = (int)floor(log10(number));
-				formatted = format2(number / pow(10, low));
-
-				if (low > 0) {
-					suffix = "e+" + std::to_string(low);
-				}
-				else if (low < 0) {
-					suffix = "e" + std::to_string(low);
-				}
-			}
-
-		}
-		if (formatted.find(".") != string::npos) {
-			if (formatted.substr(formatted.length() - 2) == "00") {
-				formatted = formatted.substr(0, formatted.length() - 3);
+		else {
+			double mantissa = number;
+			if (numberFormat == FormattingMode::Exponential) {
+				low = (int)floor(log10(number));
+				mantissa = number / pow(10, low);
 			}
-			else if (formatted.substr(formatted.length() - 1) == "0") {
-				formatted = formatted.substr(0, formatted.length() - 1);
+			len = format2(mantissa, buffer, size);
+			if (strchr(buffer, '.')) { // remove trailing zeros
+				if (len >= 3 && buffer[len - 1] == '0' && buffer[len - 2] == '0') len -= 3;
+				else if (buffer[len - 1] == '0') len -= 1;
+				buffer[len] = '\0';
 			}
 		}
 		if (roundFloating) {
-			number = std::round(number);
-			formatted = std::to_string((int)number);
+			len = std::min(std::max(std::snprintf(buffer, size, "%d", (int)std::round(number)), 0), (int)size - 1);
 		}
-		formatted += suffix;
-		return formatted;
+		if (low > 0) std::snprintf(buffer + len, size - len, "e+%d", low);
+		else if (low < 0) std::snprintf(buffer + len, size - len, "e%d", low);
+	}
 
+	// Label of a tick on the vertical (0) or horizontal (1) axis, only formatted again when its value changes
+	const char* axisLabel(int axis, size_t tick, double number) {
+		std::vector<AxisLabel> &labels = mAxisLabels[axis];
+		if (tick >= labels.size()) labels.resize(tick + 1);
+		AxisLabel &label = labels[tick];
+		if (!label.valid || label.value != number) {
+			formatNumber(number, label.text, sizeof(label.text));
+			label.value = number;
+			label.valid = true;
+		}
+		return label.text;
+	}
+
+	void invalidateAxisLabels() {
+		for (int axis = 0; axis < 2; axis++) {
+			for (AxisLabel &label : mAxisLabels[axis]) label.valid = false;
+		}
 	}
 
 	virtual GraphType graphType() = 0;
 
 private:
-	static string format2(double value) {
+	struct AxisLabel {
+		double value = 0.;
+		bool valid = false;
+		char text[32];
+	};
+	std::vector<AxisLabel> mAxisLabels[2];
+
+	// Rounds to two decimals, returns the length of the text
+	static int format2(double value, char* buffer, size_t size) {
 		value = std::round(value * 100) / 100.;
-		std::stringstream ss;
-		ss << std::fixed;
-		ss.precision(2);
-		ss << value;
-		return ss.str();
+		return std::min(std::max(std::snprintf(buffer, size, "%.2f", value), 0), (int)size - 1);
 	}
 };
 
@@ -305,7 +319,7 @@ class Plot : public GraphElement {
 protected:
 	char type = 0;
 	size_t plotRange[2] = { 0,0 };
-	const size_t mArraySize;
+	size_t mArraySize;
 	DrawMode draw = DrawMode::Smart;
 	std::function<void(double*, const size_t)> mValueComputing;
 	bool mRewriting;
@@ -313,6 +327,8 @@ public:
 	Plot(const size_t arraySize, bool rewriting = false) : mArraySize(arraySize) { mRewriting = rewriting; };
 
 	const size_t arraySize() { return mArraySize; }
+	// Used when the plot is linked to data of a different length
+	void setArraySize(size_t arraySize) { mArraySize = arraySize; }
 
 	const DrawMode &getDrawMode() const { return draw; }
 	void setDrawMode(DrawMode value) { draw = value; }
@@ -336,17 +352,17 @@ public:
 	std::function<void(double*, const size_t)> valueComputing() { return mValueComputing; }
 
 protected:
-	double *xValues;
-	float *yValues_float;
-	double *yValues_dbl;
+	const double *xValues;
+	const float *yValues_float;
+	const double *yValues_dbl;
 	long start = -1L;
 public:
 
 	// Enter -1 to disable lin space x axis
 	void setXdataLin(long indexOffset) { if(indexOffset >= 0) start = indexOffset; }
-	void setXdata(double* x_axis) { xValues = x_axis; }
-	void setYdata(double* y_axis) { yValues_dbl = y_axis; type = 2; }
-	void setYdata(float* y_axis) { yValues_float = y_axis; type = 1; }
+	void setXdata(const double* x_axis) { xValues = x_axis; }
+	void setYdata(const double* y_axis) { yValues_dbl = y_axis; type = 2; }
+	void setYdata(const float* y_axis) { yValues_float = y_axis; type = 1; }
 
 	double getXat(size_t i, bool normalize = true) {
 		if (start >= 0L) {
@@ -288,7 +288,10 @@ extern NANOGUI_EXPORT std::vector<std::pair<int, std::string>>
 /// Helper function used by nvgImageIcon
 extern NANOGUI_EXPORT int __nanogui_get_image(NVGcontext *ctx, const std::string &name, uint8_t *data, uint32_t size);
 
+/// Writes x with up to decDigits decimals (all of them with forceDecimals), trailing zeros are cut. With 0 decDigits x is rounded to a whole number
 extern NANOGUI_EXPORT std::string formatDecimals(const double x, const int decDigits, const bool forceDecimals = false);
+/// Same as formatDecimals above, but writes into the buffer without allocating. Returns the length of the text
+extern NANOGUI_EXPORT int formatDecimals(char *buffer, size_t size, const double x, const int decDigits, const bool forceDecimals = false);
 
 extern NANOGUI_EXPORT double get_seconds_since_epoch();
 
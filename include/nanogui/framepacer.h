@@ -0,0 +1,92 @@
+#pragma once
+
+#include <nanogui/common.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+NAMESPACE_BEGIN(nanogui)
+
+/*
+Replaces the fixed refresh thread of mainloop(int). Redraws are requested at a target
+frame rate, measured from the start of the previous frame, so a slow frame is followed
+immediately by the next one instead of waiting another full interval. When the application
+reports that it is idle (and no input events arrived recently) the rate drops to the idle rate.
+*/
+class NANOGUI_EXPORT FramePacer {
+public:
+	// Number of frames kept for statistics
+	static const size_t historySize = 240;
+
+	struct Statistics {
+		float last = 0.f;		// last frame interval (s)
+		float average = 0.f;	// average frame interval (s)
+		float p50 = 0.f;		// median frame interval (s)
+		float p95 = 0.f;
+		float p99 = 0.f;
+		float work = 0.f;		// average time spent drawing a frame (s)
+	};
+
+	FramePacer(double targetRate = 60., double idleRate = 4.);
+	~FramePacer();
+
+	void setTargetRate(double fps);
+	double targetRate() const { return mTargetRate; }
+	void setIdleRate(double fps);
+	double idleRate() const { return mIdleRate; }
+
+	// Time after the last input event during which the target rate is kept (s)
+	void setActivityHold(double seconds) { mActivityHold = seconds; }
+	double activityHold() const { return mActivityHold; }
+
+	// Set by the application, e.g. when the simulation is paused and nothing is animating
+	void setIdle(bool idle);
+	bool idle() const { return mIdle; }
+	// The rate currently in use
+	double currentRate() const;
+
+	// Called by mainloop around each drawn frame
+	void frameStarted();
+	void frameFinished();
+
+	size_t frameCount() const { return mFrameCount; }
+	// Computes the statistics over the stored history, does not allocate
+	Statistics statistics() const;
+
+	// Starts and stops the thread that posts the refresh events
+	void start();
+	void stop();
+
+private:
+	void run();
+	double interval() const;
+
+	double mTargetRate;
+	double mIdleRate;
+	double mActivityHold = 1.;
+	bool mIdle = false;
+
+	double mFrameStart = 0.;
+	double mLastFrameStart = 0.;
+	double mNextDeadline = 0.;
+	double mLastActivity = 0.;
+
+	float mIntervals[historySize];
+	float mWork[historySize];
+	size_t mFrameCount = 0;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::thread mThread;
+	std::atomic<bool> mRunning;
+	bool mFrameDone = false;
+};
+
+/**
+ * \brief Enter the application main loop with an adaptive frame pacer
+ * instead of a fixed refresh interval (see \ref mainloop(int))
+ */
+extern NANOGUI_EXPORT void mainloop(FramePacer &pacer);
+
+NAMESPACE_END(nanogui)
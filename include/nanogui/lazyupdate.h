@@ -0,0 +1,71 @@
+#pragma once
+
+#include <nanogui/widget.h>
+#include <vector>
+#include <functional>
+
+NAMESPACE_BEGIN(nanogui)
+
+/*
+Per-frame update work that belongs to a widget. Each entry declares the values it depends on;
+the update only runs when the host widget is visible (e.g. its tab is open) and at least one of
+the dependencies changed since the entry was last updated. Hidden tabs therefore cost nothing
+and catch up on the first frame they are shown.
+*/
+class LazyUpdater {
+public:
+	typedef std::function<double()> Dependency;
+
+	// Registers update work for the host widget and returns its index
+	size_t add(const Widget* host, const std::vector<Dependency> &dependencies, const std::function<void()> &update) {
+		Entry e;
+		e.host = host;
+		e.dependencies = dependencies;
+		e.stamps.resize(dependencies.size());
+		e.update = update;
+		mEntries.push_back(e);
+		return mEntries.size() - 1;
+	}
+
+	// Runs all visible entries whose dependencies changed, returns the number of updates
+	size_t update() {
+		size_t updated = 0;
+		for (Entry &e : mEntries) {
+			if (!e.host->visibleRecursive()) continue;
+			bool changed = e.dirty;
+			for (size_t i = 0; i < e.dependencies.size(); i++) {
+				double stamp = e.dependencies[i]();
+				if (stamp != e.stamps[i]) {
+					e.stamps[i] = stamp;
+					changed = true;
+				}
+			}
+			if (changed) {
+				e.dirty = false;
+				e.update();
+				updated++;
+			}
+		}
+		return updated;
+	}
+
+	// Forces an update of the entry (or all entries) the next time it is visible
+	void invalidate(size_t index) { mEntries[index].dirty = true; }
+	void invalidate() {
+		for (Entry &e : mEntries) e.dirty = true;
+	}
+
+	size_t size() const { return mEntries.size(); }
+
+private:
+	struct Entry {
+		const Widget* host = nullptr;
+		std::vector<Dependency> dependencies;
+		std::vector<double> stamps;
+		std::function<void()> update;
+		bool dirty = true;
+	};
+	std::vector<Entry> mEntries;
+};
+
+NAMESPACE_END(nanogui)
@@ -12,6 +12,7 @@
 #pragma once
 
 #include <nanogui/common.h>
+#include <nanogui/framepacer.h>
 #include <nanogui/widget.h>
 #include <nanogui/screen.h>
 #include <nanogui/theme.h>
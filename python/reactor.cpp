@@ -0,0 +1,410 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <Simulator.h>
+#include <ParameterSweep.h>
+#include <Uncertainty.h>
+#include <ParameterFit.h>
+#include <RodCalibration.h>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <sstream>
+
+/*
+	reactor.cpp builds the reactor Python module, for driving many runs from
+	scripts and notebooks without the GUI:
+
+		import reactor
+		sim = reactor.Simulator()
+		sim.shim_rod.enabled = True
+		sim.shim_rod.move_to(600)
+		sim.run(120.)
+		time, = sim.history("time")
+		power = [part * sim.power_per_neutron for part in sim.history("neutrons")]
+
+	step and run calculate without the GIL, so simulators in different threads
+	run in parallel. A simulator must not be used from two threads at once.
+
+	history returns read-only NumPy views straight over the data buffers of
+	the simulator, oldest sample first. The buffers are rings of
+	getDataLength() samples, once they wrapped the history is two views. The
+	views keep the simulator alive, but they are only valid until the next
+	step: later samples overwrite the oldest ones.
+*/
+
+namespace py = pybind11;
+
+namespace {
+	template <class T>
+	py::array_t<T> readOnlyView(const T* data, size_t count, py::handle owner)
+	{
+		py::array_t<T> view({ count }, { sizeof(T) }, data, owner);
+		view.attr("setflags")(py::arg("write") = false);
+		return view;
+	}
+
+	template <class T>
+	py::tuple historyViews(const Simulator &simulator, const T* data, py::handle owner)
+	{
+		const size_t length = simulator.getDataLength();
+		const size_t oldest = simulator.getOldestIndex();
+		if (oldest == 0) return py::make_tuple(readOnlyView(data, std::min(simulator.getTotalIterations(), length), owner));
+		return py::make_tuple(readOnlyView(data + oldest, length - oldest, owner), readOnlyView(data, oldest, owner));
+	}
+
+	const char* channelNames[] = { "time", "neutrons", "precursors 1", "precursors 2", "precursors 3", "precursors 4",
+		"precursors 5", "precursors 6", "total neutrons", "reactivity", "inserted reactivity", "temperature", "meter reactivity" };
+
+	py::tuple history(Simulator &simulator, const std::string &channel, py::handle owner)
+	{
+		if (channel == "time") return historyViews(simulator, (const double*)simulator.time_, owner);
+		for (int i = 0; i < 8; i++) {
+			if (channel == channelNames[i + 1]) return historyViews(simulator, (const double*)simulator.state_vector_[i], owner);
+		}
+		if (channel == "reactivity") return historyViews(simulator, (const float*)simulator.reactivity_, owner);
+		if (channel == "inserted reactivity") return historyViews(simulator, (const float*)simulator.rodReactivity_, owner);
+		if (channel == "temperature") return historyViews(simulator, (const float*)simulator.temperature_, owner);
+		if (channel == "meter reactivity") return historyViews(simulator, (const float*)simulator.meterReactivity_, owner);
+		throw py::value_error("no channel \"" + channel + "\", see Simulator.channels");
+	}
+
+	py::dict pulseData(const Simulator::PulseData &pulse)
+	{
+		py::dict data;
+		data["peak_power"] = pulse.peakPower;
+		data["time_at_peak"] = pulse.timeAtMax;
+		data["fwhm"] = pulse.FWHM;
+		data["released_energy"] = pulse.releasedEnergy;
+		data["max_fuel_temperature"] = pulse.maxFuelTemp;
+		data["power_before_scram"] = pulse.powerBeforeSCRAM;
+		return data;
+	}
+
+	template <size_t N, class T>
+	std::vector<T> getGroups(const T (&values)[N]) { return std::vector<T>(values, values + N); }
+
+	template <size_t N, class T>
+	void setGroups(T (&values)[N], const std::vector<T> &groups)
+	{
+		if (groups.size() != N) throw py::value_error("needs " + std::to_string(N) + " values");
+		std::copy(groups.begin(), groups.end(), values);
+	}
+}
+
+PYBIND11_MODULE(reactor, m) {
+	m.doc() = "Research reactor point kinetics simulator";
+	m.attr("TIME_STEP") = DT_STEP;
+
+	py::class_<Settings>(m, "Settings", "Parameters of the reactor, applied with Simulator(settings) or Simulator.reset(settings)")
+		.def(py::init<>())
+		.def("save", [](Settings &settings, const std::string &fileName) { settings.saveArchive(fileName); })
+		.def("load", [](Settings &settings, const std::string &fileName) { settings.restoreArchive(fileName); })
+		.def_readwrite("neutron_source_inserted", &Settings::neutronSourceInserted)
+		.def_readwrite("neutron_source_activity", &Settings::neutronSourceActivity)
+		.def_readwrite("prompt_neutron_lifetime", &Settings::promptNeutronLifetime)
+		.def_readwrite("excess_reactivity", &Settings::excessReactivity)
+		.def_readwrite("temperature_effects", &Settings::temperatureEffects)
+		.def_readwrite("fission_poisons", &Settings::fissionPoisons)
+		.def_readwrite("core_volume", &Settings::coreVolume)
+		.def_readwrite("water_volume", &Settings::waterVolume)
+		.def_readwrite("water_cooling", &Settings::waterCooling)
+		.def_readwrite("water_cooling_power", &Settings::waterCoolingPower)
+		.def_readwrite("alpha0", &Settings::alpha0)
+		.def_readwrite("alpha_at_t1", &Settings::alphaAtT1)
+		.def_readwrite("alpha_t1", &Settings::alphaT1)
+		.def_readwrite("alpha_k", &Settings::alphaK)
+		.def_readwrite("automatic_pulse_scram", &Settings::automaticPulseScram)
+		.def_readwrite("period_limit", &Settings::periodLimit)
+		.def_readwrite("period_scram", &Settings::periodScram)
+		.def_readwrite("power_limit", &Settings::powerLimit)
+		.def_readwrite("power_scram", &Settings::powerScram)
+		.def_readwrite("temperature_limit", &Settings::tempLimit)
+		.def_readwrite("temperature_scram", &Settings::tempScram)
+		.def_readwrite("water_temperature_limit", &Settings::waterTempLimit)
+		.def_readwrite("water_temperature_scram", &Settings::waterTempScram)
+		.def_property("betas", [](Settings &settings) { return getGroups(settings.betas); },
+			[](Settings &settings, const std::vector<double> &values) { setGroups(settings.betas, values); })
+		.def_property("lambdas", [](Settings &settings) { return getGroups(settings.lambdas); },
+			[](Settings &settings, const std::vector<double> &values) { setGroups(settings.lambdas, values); })
+		.def_property("groups_enabled", [](Settings &settings) { return getGroups(settings.groupsEnabled); },
+			[](Settings &settings, const std::vector<bool> &values) {
+				if (values.size() != 6) throw py::value_error("needs 6 values");
+				std::copy(values.begin(), values.end(), settings.groupsEnabled);
+			})
+		.def_property("rod_worths", [](Settings &settings) {
+				std::vector<float> worths;
+				for (const auto &rod : settings.rodSettings) worths.push_back(rod.rodWorth);
+				return worths;
+			},
+			[](Settings &settings, const std::vector<float> &worths) {
+				if (worths.size() != NUMBER_OF_CONTROL_RODS) throw py::value_error("needs a worth for every rod");
+				for (size_t i = 0; i < worths.size(); i++) settings.rodSettings[i].rodWorth = worths[i];
+			});
+
+	py::class_<ControlRod> rod(m, "ControlRod", "A control rod, owned by its simulator");
+	py::enum_<ControlRod::OperationModes>(rod, "Mode")
+		.value("Manual", ControlRod::Manual)
+		.value("Simulation", ControlRod::Simulation)
+		.value("Automatic", ControlRod::Automatic)
+		.value("Pulse", ControlRod::Pulse);
+	rod
+		.def_property_readonly("name", &ControlRod::getRodName)
+		.def_property_readonly("steps", [](ControlRod &rod) { return *rod.getRodSteps(); })
+		.def_property_readonly("position", [](ControlRod &rod) { return *rod.getExactPosition(); }, "In steps")
+		.def_property_readonly("actual_position", [](ControlRod &rod) { return *rod.getActualPosition(); })
+		.def_property_readonly("reactivity", &ControlRod::getCurrentPCM, "Inserted reactivity at the actual position, in pcm")
+		.def("reactivity_at", &ControlRod::getPCMat, py::arg("position"))
+		.def_property("worth", &ControlRod::getRodWorth, &ControlRod::setRodWorth)
+		.def_property("enabled", [](ControlRod &rod) { return *rod.isEnabled(); }, [](ControlRod &rod, bool enabled) { rod.setEnabled(enabled); })
+		.def_property("mode", &ControlRod::getOperationMode, &ControlRod::setOperationMode)
+		.def("move_to", [](ControlRod &rod, float position) { rod.commandMove(position); }, py::arg("position"))
+		.def("to_top", &ControlRod::commandToTop)
+		.def("to_bottom", &ControlRod::commandToBottom);
+
+	py::class_<Simulator>(m, "Simulator")
+		.def(py::init<Settings*>(), py::arg("settings") = nullptr, py::keep_alive<1, 2>())
+		.def("reset", &Simulator::reset, py::arg("settings") = nullptr, py::keep_alive<1, 2>(), "Starts again from the initial state")
+		.def("step", [](Simulator &simulator, size_t steps) {
+				py::gil_scoped_release release;
+				simulator.runFrame(steps);
+			}, py::arg("steps") = 1, "Calculates a frame of the given number of time steps")
+		.def("run", [](Simulator &simulator, double seconds, size_t frameSteps) {
+				if (frameSteps == 0) throw py::value_error("frame_steps must be positive");
+				py::gil_scoped_release release;
+				simulator.run(seconds, frameSteps);
+			}, py::arg("seconds"), py::arg("frame_steps") = RUN_FRAME_STEPS, "Calculates the simulated seconds in frames of frame_steps")
+		.def("command", [](Simulator &simulator, const std::string &name, const std::string &value) {
+				Command command;
+				std::string error;
+				if (!compileCommand(name, value, command, error)) throw py::value_error(error);
+				simulator.runScriptCommand(command);
+			}, py::arg("name"), py::arg("value") = "", "Runs a script command")
+		.def_property_readonly("time", &Simulator::getCurrentTime)
+		.def_property_readonly("steps", &Simulator::getTotalIterations)
+		.def_property_readonly("power", &Simulator::getCurrentPower)
+		.def_property_readonly("reactivity", &Simulator::getCurrentReactivity)
+		.def_property_readonly("temperature", &Simulator::getCurrentTemperature)
+		.def_property_readonly("water_temperature", [](Simulator &simulator) { return *simulator.getWaterTemperature(); })
+		.def_property_readonly("period", [](Simulator &simulator) { return *simulator.getReactorPeriod(); })
+		.def_property_readonly("scram_status", &Simulator::getScramStatus)
+		.def_property_readonly("power_per_neutron", [](Simulator &simulator) { return simulator.powerFromNeutrons(1.); }, "Multiplies the neutrons channel to power in W")
+		.def("scram", [](Simulator &simulator) { simulator.scram(Simulator::User); })
+		.def("reset_scram", [](Simulator &simulator) { simulator.scram(Simulator::None); })
+		.def("fire_pulse", &Simulator::beginPulse)
+		.def_property_readonly("pulses", &Simulator::getPulsesFinished)
+		.def_property_readonly("last_pulse", [](Simulator &simulator) { return pulseData(simulator.getLastPulse()); })
+		.def_property_readonly("safety_rod", &Simulator::safetyRod, py::return_value_policy::reference_internal)
+		.def_property_readonly("regulating_rod", &Simulator::regulatingRod, py::return_value_policy::reference_internal)
+		.def_property_readonly("shim_rod", &Simulator::shimRod, py::return_value_policy::reference_internal)
+		.def("save_checkpoint", &Simulator::saveCheckpoint, py::arg("file_name"), py::arg("history") = false)
+		.def("load_checkpoint", [](Simulator &simulator, const std::string &fileName) { return simulator.loadCheckpoint(fileName, simulator.appliedSettings); }, py::arg("file_name"))
+		.def("save_journal", &Simulator::saveJournal, py::arg("file_name"))
+		.def("replay_journal", [](Simulator &simulator, const std::string &fileName) {
+				py::gil_scoped_release release;
+				return simulator.replayJournal(fileName, simulator.appliedSettings);
+			}, py::arg("file_name"))
+		.def("rewind", &Simulator::rewind, py::arg("time"))
+		.def_property_readonly("data_length", &Simulator::getDataLength, "Samples the history keeps")
+		.def_property_readonly_static("channels", [](py::object) {
+				return std::vector<std::string>(std::begin(channelNames), std::end(channelNames));
+			})
+		.def("history", [](py::object self, const std::string &channel) {
+				return history(self.cast<Simulator&>(), channel, self);
+			}, py::arg("channel"), "Read-only views of a channel, see the module documentation")
+		.def("meter_reactivity", [](Simulator &simulator, py::array_t<double, py::array::c_style | py::array::forcecast> time,
+			py::array_t<double, py::array::c_style | py::array::forcecast> power) {
+				if (time.size() != power.size()) throw py::value_error("time and power need the same length");
+				py::array_t<float> reactivity((size_t)time.size());
+				ReactivityMeter meter = simulator.reactivityMeter;
+				meter.process(time.data(), power.data(), (size_t)time.size(), reactivity.mutable_data());
+				return reactivity;
+			}, py::arg("time"), py::arg("power"),
+			"Reactivity (pcm) of a measured power series by the inverse kinetics meter with the kinetics of the simulator");
+
+	py::enum_<SweepParameter>(m, "Parameter")
+		.value("RodWorth", SweepParameter::RodWorth)
+		.value("Beta", SweepParameter::Beta)
+		.value("Lambda", SweepParameter::Lambda)
+		.value("Alpha0", SweepParameter::Alpha0)
+		.value("AlphaAtT1", SweepParameter::AlphaAtT1)
+		.value("AlphaT1", SweepParameter::AlphaT1)
+		.value("AlphaK", SweepParameter::AlphaK)
+		.value("PromptNeutronLifetime", SweepParameter::PromptNeutronLifetime)
+		.value("ExcessReactivity", SweepParameter::ExcessReactivity);
+
+	py::class_<SweepChange>(m, "Change", "A parameter of the settings set to a value, index is the rod or the delayed group")
+		.def(py::init([](SweepParameter parameter, double value, size_t index) { return SweepChange{ parameter, index, value }; }),
+			py::arg("parameter"), py::arg("value"), py::arg("index") = 0)
+		.def_readonly("parameter", &SweepChange::parameter)
+		.def_readonly("index", &SweepChange::index)
+		.def_readonly("value", &SweepChange::value)
+		.def_property_readonly("name", &sweepChangeName);
+
+	m.def("sweep_grid", &sweepGrid, py::arg("axes"), "Every combination of one change from each axis");
+	m.def("sweep", [](const Settings &base, const std::vector<SweepVariation> &variations, const std::string &scriptText, double duration, unsigned threads) {
+			std::istringstream stream(scriptText);
+			Script script;
+			std::string error;
+			if (!compileScript(stream, script, error)) throw py::value_error(error);
+			std::vector<SweepResult> results;
+			{
+				py::gil_scoped_release release;
+				results = runSweep(base, variations, script, duration, threads);
+			}
+			py::list rows;
+			for (const SweepResult &result : results) {
+				py::dict row;
+				for (const SweepChange &change : result.variation) row[sweepChangeName(change).c_str()] = change.value;
+				row["peak_power"] = result.peakPower;
+				row["max_fuel_temperature"] = result.maxFuelTemperature;
+				row["scram_time"] = result.scramTime;
+				row["final_power"] = result.finalPower;
+				row["final_xenon"] = result.finalXenon;
+				row["error"] = result.error;
+				rows.append(row);
+			}
+			return rows;
+		}, py::arg("settings"), py::arg("variations"), py::arg("script"), py::arg("duration"), py::arg("threads") = 0,
+		"Runs the script on every variation of settings in parallel (see ParameterSweep.h), a dict of results per run");
+
+	py::class_<ParameterDistribution> distribution(m, "Distribution", "Of a parameter, see Uncertainty.h for a and b");
+	py::enum_<ParameterDistribution::Kind>(distribution, "Kind")
+		.value("Normal", ParameterDistribution::Normal)
+		.value("LogNormal", ParameterDistribution::LogNormal)
+		.value("Uniform", ParameterDistribution::Uniform);
+	distribution.def(py::init([](SweepParameter parameter, ParameterDistribution::Kind kind, double a, double b, size_t index) {
+			return ParameterDistribution{ parameter, index, kind, a, b };
+		}), py::arg("parameter"), py::arg("kind"), py::arg("a"), py::arg("b"), py::arg("index") = 0);
+
+	m.def("uncertainty", [](const Settings &base, const std::vector<ParameterDistribution> &distributions, const std::string &scriptText,
+		size_t realisations, double duration, double interval, const std::vector<double> &quantiles, uint64_t seed, unsigned threads, const std::string &fileName) {
+			std::istringstream stream(scriptText);
+			Script script;
+			std::string error;
+			if (!compileScript(stream, script, error)) throw py::value_error(error);
+			UncertaintyOptions options;
+			options.realisations = realisations;
+			options.duration = duration;
+			options.interval = interval;
+			options.quantiles = quantiles;
+			options.seed = seed;
+			options.threads = threads;
+			py::gil_scoped_release release;
+			return runUncertainty(base, distributions, script, options, fileName);
+		}, py::arg("settings"), py::arg("distributions"), py::arg("script"), py::arg("realisations") = 1000, py::arg("duration") = 600.,
+		py::arg("interval") = 0.1, py::arg("quantiles") = std::vector<double>{ 0.05, 0.5, 0.95 }, py::arg("seed") = 1, py::arg("threads") = 0,
+		py::arg("file_name") = "", "Monte Carlo envelopes of power and fuel temperature, see Uncertainty.h");
+
+	py::class_<UncertaintyEnvelope> envelope(m, "Envelope");
+	py::enum_<UncertaintyEnvelope::Channel>(envelope, "Channel")
+		.value("Power", UncertaintyEnvelope::Power)
+		.value("Temperature", UncertaintyEnvelope::Temperature);
+	envelope
+		.def_property_readonly("points", &UncertaintyEnvelope::points)
+		.def_property_readonly("realisations", &UncertaintyEnvelope::realisations)
+		.def("mean", [](const UncertaintyEnvelope &envelope, UncertaintyEnvelope::Channel channel) {
+				py::array_t<double> values(envelope.points());
+				for (size_t i = 0; i < envelope.points(); i++) values.mutable_at(i) = envelope.mean(channel, i);
+				return values;
+			}, py::arg("channel"))
+		.def("quantile", [](const UncertaintyEnvelope &envelope, UncertaintyEnvelope::Channel channel, size_t quantile) {
+				py::array_t<double> values(envelope.points());
+				for (size_t i = 0; i < envelope.points(); i++) values.mutable_at(i) = envelope.quantile(channel, i, quantile);
+				return values;
+			}, py::arg("channel"), py::arg("quantile"), "quantile is the index in the quantiles of the run")
+		.def("save", &UncertaintyEnvelope::save, py::arg("file_name"));
+
+	py::enum_<FitParameter>(m, "FitParameter")
+		.value("Alpha0", FitParameter::Alpha0)
+		.value("AlphaAtT1", FitParameter::AlphaAtT1)
+		.value("AlphaT1", FitParameter::AlphaT1)
+		.value("AlphaK", FitParameter::AlphaK)
+		.value("RodCurve", FitParameter::RodCurve)
+		.value("CoolingPower", FitParameter::CoolingPower);
+
+	py::class_<FitBound>(m, "FitBound", "A parameter to fit between lower and upper, rod and point are of RodCurve")
+		.def(py::init([](FitParameter parameter, double lower, double upper, size_t rod, size_t point) {
+				return FitBound{ parameter, rod, point, lower, upper };
+			}), py::arg("parameter"), py::arg("lower"), py::arg("upper"), py::arg("rod") = 0, py::arg("point") = 0)
+		.def_readonly("parameter", &FitBound::parameter)
+		.def_readonly("lower", &FitBound::lower)
+		.def_readonly("upper", &FitBound::upper)
+		.def_property_readonly("name", &fitParameterName);
+
+	py::class_<FitResult>(m, "FitResult")
+		.def_readonly("values", &FitResult::values)
+		.def_readonly("score", &FitResult::score)
+		.def_readonly("excess_reactivity", &FitResult::excessReactivity)
+		.def_readonly("generations", &FitResult::generations)
+		.def_readonly("evaluations", &FitResult::evaluations);
+
+	m.def("fit", [](const Settings &base, const std::string &logFile, const std::vector<FitBound> &bounds, size_t population,
+		size_t generations, double temperatureScale, bool balanceStart, uint64_t seed, unsigned threads) {
+			MeasuredLog log;
+			if (!log.open(logFile)) throw py::value_error(log.error());
+			FitOptions options;
+			options.population = population;
+			options.generations = generations;
+			options.temperatureScale = temperatureScale;
+			options.balanceStart = balanceStart;
+			options.seed = seed;
+			options.threads = threads;
+			FitResult result;
+			{
+				py::gil_scoped_release release;
+				result = fitParameters(base, log, bounds, options);
+			}
+			if (!result.error.empty()) throw std::runtime_error(result.error);
+			return result;
+		}, py::arg("settings"), py::arg("log"), py::arg("bounds"), py::arg("population") = 0, py::arg("generations") = 60,
+		py::arg("temperature_scale") = 5., py::arg("balance_start") = true, py::arg("seed") = 1, py::arg("threads") = 0,
+		"Fits the parameters to a measured log, see ParameterFit.h");
+	m.def("apply_fit", [](Settings &settings, const std::vector<FitBound> &bounds, const FitResult &fit) { applyFit(settings, bounds, fit); },
+		py::arg("settings"), py::arg("bounds"), py::arg("fit"), "Writes the fitted values and excess reactivity to the settings");
+	m.def("apply_fit", [](Settings &settings, const std::vector<FitBound> &bounds, const std::vector<double> &values) { applyFit(settings, bounds, values); },
+		py::arg("settings"), py::arg("bounds"), py::arg("values"), "Writes fitted values to the settings");
+
+	m.def("calibrate_rods", [](const Settings &base, const std::vector<size_t> &rods, size_t increments, double power,
+		double powerRatio, double maxTime, bool feedback, unsigned threads, const std::string &fileName) {
+			RodCalibrationOptions options;
+			options.increments = increments;
+			options.power = power;
+			options.powerRatio = powerRatio;
+			options.maxTime = maxTime;
+			options.feedback = feedback;
+			options.threads = threads;
+			std::vector<RodCalibration> calibrations;
+			{
+				py::gil_scoped_release release;
+				calibrations = calibrateRods(base, rods, options);
+			}
+			if (!fileName.empty()) saveRodCalibration(fileName, calibrations);
+			py::list results;
+			for (const RodCalibration &calibration : calibrations) {
+				py::dict result;
+				result["rod"] = calibration.rod;
+				result["name"] = calibration.name;
+				std::vector<double> position(1, 0.), period(1, -1.), reactivity(1, 0.), integral(1, 0.), model(1, 0.);
+				for (const RodCalibrationPoint &point : calibration.points) {
+					position.push_back((double)point.position);
+					period.push_back(point.period);
+					reactivity.push_back(point.reactivity);
+					integral.push_back(point.integral);
+					model.push_back(point.modelIntegral);
+				}
+				result["position"] = position;
+				result["period"] = period;
+				result["reactivity"] = reactivity;
+				result["integral"] = integral;
+				result["model_integral"] = model;
+				result["rms_difference"] = calibration.rmsDifference;
+				result["max_difference"] = calibration.maxDifference;
+				result["failed"] = calibration.failed;
+				results.append(result);
+			}
+			return results;
+		}, py::arg("settings"), py::arg("rods") = std::vector<size_t>{ 0, 1, 2 }, py::arg("increments") = 20, py::arg("power") = 1.,
+		py::arg("power_ratio") = 1000., py::arg("max_time") = 300., py::arg("feedback") = false, py::arg("threads") = 0, py::arg("file_name") = "",
+		"Positive period calibration of the rods (see RodCalibration.h), a dict of curves per rod starting at the bottom");
+}
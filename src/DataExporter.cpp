@@ -0,0 +1,202 @@
+#include <DataExporter.h>
+#include <RunLog.h>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+// Size of the text buffer that is written to the file at once
+constexpr size_t EXPORT_BUFFER_SIZE = 1 << 20;
+// Longest possible line of the log
+constexpr size_t EXPORT_MAX_LINE = 256;
+
+DataExporter::~DataExporter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+		mCondition.notify_all();
+	}
+	if (mThread.joinable()) mThread.join();
+}
+
+void DataExporter::submit(Job &&job)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mJobs.push_back(std::move(job));
+	mBusy = true;
+	if (!mThread.joinable()) mThread = std::thread([this]() { run(); });
+	mCondition.notify_all();
+}
+
+void DataExporter::finish()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdle.wait(lock, [this]() { return mJobs.empty() && !mWriting; });
+}
+
+size_t DataExporter::pending() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mJobs.size() + mWriting;
+}
+
+int DataExporter::formatTime(char* buffer, size_t size, double t)
+{
+	size_t time[4];
+	time[3] = (size_t)floor(fmod(t, 1.) * 1000);
+	time[2] = (size_t)floor(fmod(t, 60.));
+	time[1] = (size_t)floor(fmod(t, 3600.) / 60.);
+	time[0] = (size_t)floor(t / 3600.);
+	return std::snprintf(buffer, size, "%02zu:%02zu:%02zu:%03zu", time[0], time[1], time[2], time[3]);
+}
+
+void DataExporter::run()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true) {
+		mCondition.wait(lock, [this]() { return mStop || !mJobs.empty(); });
+		// Queued jobs are still written when stopping
+		if (mJobs.empty()) break;
+		Job job = std::move(mJobs.front());
+		mJobs.pop_front();
+		mWriting = 1;
+		lock.unlock();
+
+		mProgress = 0.f;
+		auto start = std::chrono::steady_clock::now();
+		if (job.binary ? writeBinary(job) : write(job)) {
+			std::cout << "Saved " << job.rows.size() << " lines to " << job.fileName << " in "
+				<< std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+		}
+		else {
+			std::cerr << "Could not write data to " << job.fileName << "!" << std::endl;
+		}
+		mProgress = 1.f;
+
+		lock.lock();
+		mWriting = 0;
+		mBusy = !mJobs.empty();
+		if (mJobs.empty()) mIdle.notify_all();
+	}
+}
+
+bool DataExporter::write(const Job &job)
+{
+	std::ofstream logFile(job.fileName);
+	if (!logFile.is_open()) return false;
+
+	std::vector<char> buffer(EXPORT_BUFFER_SIZE);
+	size_t used = 0;
+
+	char created[100];
+	strftime(created, 100, "%c", localtime(&job.created));
+	used += std::snprintf(buffer.data() + used, buffer.size() - used,
+		"###############################################################################################################\n"
+		"#                  Research reactor simulator log %s                   #\n"
+		"#Time[h:m:s:ms] Reactivity[pcm] Inserted-reactivity[pcm] Power[W] Temp[C] Xenon-conc.[g/m3] Iodine-conc.[g/m3]#\n"
+		"###############################################################################################################\n",
+		created);
+
+	const size_t rows = job.rows.size();
+	for (size_t i = 0; i < rows; i++) {
+		if (buffer.size() - used < EXPORT_MAX_LINE) {
+			logFile.write(buffer.data(), used);
+			used = 0;
+			mProgress = (float)i / rows;
+		}
+		const Row &r = job.rows[i];
+		char* line = buffer.data() + used;
+		int len = formatTime(line, EXPORT_MAX_LINE, r.time);
+		len += std::snprintf(line + len, EXPORT_MAX_LINE - len, "\t%g\t%g\t%g\t%g\t%g\t%g\n",
+			r.reactivity, r.rodReactivity, r.power, r.temperature, r.xenon, r.iodine);
+		used += std::min((size_t)len, EXPORT_MAX_LINE - 1);
+	}
+	logFile.write(buffer.data(), used);
+	logFile.close();
+	return !logFile.fail();
+}
+
+bool DataExporter::writeBinary(const Job &job)
+{
+	std::ofstream logFile(job.fileName, std::ios::out | std::ios::binary);
+	if (!logFile.is_open()) return false;
+
+	// Every channel is a member of Row
+	struct Column {
+		const char* name;
+		const char* unit;
+		RunLogType type;
+		size_t member;
+	};
+	const Column columns[] = {
+		{ "time", "s", RunLogType::Float64, offsetof(Row, time) },
+		{ "reactivity", "pcm", RunLogType::Float32, offsetof(Row, reactivity) },
+		{ "inserted reactivity", "pcm", RunLogType::Float32, offsetof(Row, rodReactivity) },
+		{ "power", "W", RunLogType::Float64, offsetof(Row, power) },
+		{ "temperature", "C", RunLogType::Float32, offsetof(Row, temperature) },
+		{ "xenon", "g/m3", RunLogType::Float32, offsetof(Row, xenon) },
+		{ "iodine", "g/m3", RunLogType::Float32, offsetof(Row, iodine) }
+	};
+	const uint32_t channelCount = sizeof(columns) / sizeof(Column);
+	const uint64_t rows = job.rows.size();
+	auto align = [](uint64_t offset) { return (offset + RUN_LOG_ALIGNMENT - 1) / RUN_LOG_ALIGNMENT * RUN_LOG_ALIGNMENT; };
+
+	RunLogHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "RRSLOG\0\0", 8);
+	header.version = RUN_LOG_VERSION;
+	header.channelCount = channelCount;
+	header.rowCount = rows;
+	header.settingsOffset = sizeof(RunLogHeader);
+	header.settingsSize = job.settings.size();
+	header.channelsOffset = align(header.settingsOffset + header.settingsSize);
+	header.created = (int64_t)job.created;
+	header.timeStep = job.timeStep;
+
+	RunLogChannel channels[sizeof(columns) / sizeof(Column)];
+	memset(channels, 0, sizeof(channels));
+	uint64_t offset = align(header.channelsOffset + sizeof(channels));
+	for (uint32_t c = 0; c < channelCount; c++) {
+		strncpy(channels[c].name, columns[c].name, sizeof(channels[c].name) - 1);
+		strncpy(channels[c].unit, columns[c].unit, sizeof(channels[c].unit) - 1);
+		channels[c].type = (uint32_t)columns[c].type;
+		channels[c].offset = offset;
+		offset = align(offset + rows * (columns[c].type == RunLogType::Float64 ? sizeof(double) : sizeof(float)));
+	}
+
+	const char padding[RUN_LOG_ALIGNMENT] = {};
+	auto pad = [&]() {
+		uint64_t position = (uint64_t)logFile.tellp();
+		logFile.write(padding, align(position) - position);
+	};
+	logFile.write((const char*)&header, sizeof(header));
+	logFile.write(job.settings.data(), job.settings.size());
+	pad();
+	logFile.write((const char*)channels, sizeof(channels));
+	pad();
+
+	// Gather each column through the buffer
+	std::vector<char> buffer(EXPORT_BUFFER_SIZE);
+	for (uint32_t c = 0; c < channelCount; c++) {
+		const size_t valueSize = columns[c].type == RunLogType::Float64 ? sizeof(double) : sizeof(float);
+		size_t used = 0;
+		for (uint64_t i = 0; i < rows; i++) {
+			if (used + valueSize > buffer.size()) {
+				logFile.write(buffer.data(), used);
+				used = 0;
+				mProgress = (c + (float)i / rows) / channelCount;
+			}
+			memcpy(buffer.data() + used, (const char*)&job.rows[i] + columns[c].member, valueSize);
+			used += valueSize;
+		}
+		logFile.write(buffer.data(), used);
+		pad();
+	}
+	logFile.close();
+	return !logFile.fail();
+}
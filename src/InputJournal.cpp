@@ -0,0 +1,273 @@
+#include <InputJournal.h>
+#include <Checkpoint.h>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <algorithm>
+
+void InputJournal::setRecording(bool recording)
+{
+	if (recording && !mRecording) {
+		mData.clear();
+		mRead = 0;
+	}
+	mRecording = recording;
+}
+
+void InputJournal::append(JournalRecord type)
+{
+	if (mData.size() > JOURNAL_MAX_SIZE) {
+		std::cerr << "Input journal: stopped recording, the journal is larger than " << (JOURNAL_MAX_SIZE >> 20) << " MB" << std::endl;
+		mRecording = false;
+		return;
+	}
+	mData += (char)type;
+}
+
+void InputJournal::appendNumber(uint64_t value)
+{
+	// 7 bits per byte, most frames take a single byte
+	while (value >= 0x80) {
+		mData += (char)(0x80 | (value & 0x7F));
+		value >>= 7;
+	}
+	mData += (char)value;
+}
+
+void InputJournal::appendText(const std::string &text)
+{
+	appendNumber(text.size());
+	mData += text;
+}
+
+void InputJournal::start(const std::string &state)
+{
+	if (!mRecording) return;
+	append(JournalRecord::Start);
+	if (mRecording) appendText(state);
+}
+
+void InputJournal::frame(size_t steps)
+{
+	if (!mRecording) return;
+	append(JournalRecord::Frame);
+	if (mRecording) appendNumber(steps);
+}
+
+std::string InputJournal::diff(const std::string &before, const std::string &after)
+{
+	// The new size, then the changed runs as (unchanged bytes before it, length, bytes)
+	InputJournal writer;
+	writer.appendNumber(after.size());
+	size_t end = 0, i = 0;
+	auto differs = [&](size_t at) { return at >= before.size() || before[at] != after[at]; };
+	while (i < after.size()) {
+		if (!differs(i)) {
+			i++;
+			continue;
+		}
+		size_t runEnd = i + 1;
+		// Short unchanged gaps are cheaper to repeat than to start a new run
+		for (size_t gap = runEnd; gap < after.size() && gap < runEnd + 8; gap++) {
+			if (differs(gap)) runEnd = gap + 1;
+		}
+		writer.appendNumber(i - end);
+		writer.appendNumber(runEnd - i);
+		writer.mData.append(after, i, runEnd - i);
+		end = i = runEnd;
+	}
+	return writer.mData;
+}
+
+void InputJournal::input(JournalRecord type, uint64_t step, const std::string &label, const std::string &before, const std::string &after)
+{
+	if (!mRecording || before == after) return;
+	Entry entry;
+	entry.type = type;
+	entry.step = step;
+	entry.checksum = checkpointChecksum(before.data(), before.size());
+	entry.label = label;
+	entry.data = diff(before, after);
+	record(entry);
+}
+
+void InputJournal::record(const Entry &entry)
+{
+	if (!mRecording) return;
+	append(entry.type);
+	if (!mRecording) return;
+	switch (entry.type) {
+	case JournalRecord::Start:
+		appendText(entry.data);
+		break;
+	case JournalRecord::Frame:
+		appendNumber(entry.step);
+		break;
+	default:
+		appendNumber(entry.step);
+		mData.append((const char*)&entry.checksum, sizeof(entry.checksum));
+		if (entry.type != JournalRecord::Check) {
+			appendText(entry.label);
+			appendText(entry.data);
+		}
+		break;
+	}
+}
+
+void InputJournal::truncate(size_t size)
+{
+	if (size < mData.size()) mData.resize(size);
+	mRead = std::min(mRead, mData.size());
+}
+
+size_t InputJournal::rebase(const std::string &state, size_t position)
+{
+	InputJournal writer;
+	writer.mRecording = true;
+	writer.start(state);
+	const size_t startSize = writer.mData.size();
+	writer.mData.append(mData, std::min(position, mData.size()), std::string::npos);
+	mData = std::move(writer.mData);
+	mRead = 0;
+	return startSize;
+}
+
+void InputJournal::check(uint64_t step, uint64_t checksum)
+{
+	if (!mRecording) return;
+	append(JournalRecord::Check);
+	if (!mRecording) return;
+	appendNumber(step);
+	mData.append((const char*)&checksum, sizeof(checksum));
+}
+
+bool InputJournal::save(const std::string &fileName, uint64_t dataPoints, double timeStep) const
+{
+	CheckpointHeader header;
+	memcpy(header.magic, "RRJL", 4);
+	header.version = JOURNAL_VERSION;
+	header.flags = 0;
+	header.reserved = 0;
+	header.dataPoints = dataPoints;
+	header.timeStep = timeStep;
+	header.bodySize = mData.size();
+	header.checksum = checkpointChecksum(mData.data(), mData.size());
+
+	std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write((const char*)&header, sizeof(header));
+	file.write(mData.data(), mData.size());
+	if (!file) {
+		std::cerr << "Could not write the journal " << fileName << std::endl;
+		return false;
+	}
+	std::cout << "Journal saved to " << fileName << " (" << (sizeof(header) + mData.size()) / 1024 << " kB)" << std::endl;
+	return true;
+}
+
+bool InputJournal::load(const std::string &fileName, uint64_t dataPoints, double timeStep)
+{
+	setRecording(false);
+	mData.clear();
+	mRead = 0;
+	mDamaged = false;
+	std::ifstream file(fileName, std::ios::in | std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Could not open the journal " << fileName << std::endl;
+		return false;
+	}
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	CheckpointHeader header;
+	if (text.size() < sizeof(header)) {
+		std::cerr << fileName << " is not a journal" << std::endl;
+		return false;
+	}
+	memcpy(&header, text.data(), sizeof(header));
+	if (memcmp(header.magic, "RRJL", 4) != 0 || header.version != JOURNAL_VERSION) {
+		std::cerr << fileName << " is not a journal of this version" << std::endl;
+		return false;
+	}
+	if (header.dataPoints != dataPoints || header.timeStep != timeStep) {
+		std::cerr << fileName << " was recorded by a simulator with a different time step or data length" << std::endl;
+		return false;
+	}
+	if (header.bodySize != text.size() - sizeof(header) || header.checksum != checkpointChecksum(text.data() + sizeof(header), text.size() - sizeof(header))) {
+		std::cerr << fileName << " is damaged" << std::endl;
+		return false;
+	}
+	mData = text.substr(sizeof(header));
+	return true;
+}
+
+bool InputJournal::readNumber(const std::string &data, size_t &position, uint64_t &value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (position >= data.size()) return false;
+		const unsigned char byte = (unsigned char)data[position++];
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return true;
+	}
+	return false;
+}
+
+bool InputJournal::readText(const std::string &data, size_t &position, std::string &text)
+{
+	uint64_t size;
+	if (!readNumber(data, position, size) || size > data.size() - position) return false;
+	text.assign(data, position, (size_t)size);
+	position += (size_t)size;
+	return true;
+}
+
+bool InputJournal::read(size_t &position, Entry &entry) const
+{
+	if (position >= mData.size()) return false;
+	entry = Entry();
+	entry.type = (JournalRecord)mData[position++];
+	switch (entry.type) {
+	case JournalRecord::Start:
+		return readText(mData, position, entry.data);
+	case JournalRecord::Frame:
+		return readNumber(mData, position, entry.step);
+	case JournalRecord::Input:
+	case JournalRecord::StepInput:
+	case JournalRecord::FrameInput:
+	case JournalRecord::Check:
+		if (!readNumber(mData, position, entry.step) || mData.size() - position < sizeof(entry.checksum)) return false;
+		memcpy(&entry.checksum, mData.data() + position, sizeof(entry.checksum));
+		position += sizeof(entry.checksum);
+		return entry.type == JournalRecord::Check || (readText(mData, position, entry.label) && readText(mData, position, entry.data));
+	}
+	return false;
+}
+
+bool InputJournal::next(Entry &entry)
+{
+	if (mRead >= mData.size()) return false;
+	if (!read(mRead, entry)) {
+		std::cerr << "Input journal: invalid record at byte " << mRead << std::endl;
+		mRead = mData.size();
+		mDamaged = true;
+		return false;
+	}
+	return true;
+}
+
+bool InputJournal::apply(std::string &state, const std::string &changes)
+{
+	size_t position = 0;
+	uint64_t size, gap, length;
+	if (!readNumber(changes, position, size)) return false;
+	state.resize((size_t)size);
+	size_t at = 0;
+	while (position < changes.size()) {
+		if (!readNumber(changes, position, gap) || !readNumber(changes, position, length)) return false;
+		at += (size_t)gap;
+		if (at + length > state.size() || length > changes.size() - position) return false;
+		memcpy(&state[at], changes.data() + position, (size_t)length);
+		position += (size_t)length;
+		at += (size_t)length;
+	}
+	return true;
+}
@@ -0,0 +1,340 @@
+#include <ParameterFit.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <limits>
+#include <stdexcept>
+#include <cctype>
+#include <cstdio>
+#include <cmath>
+
+bool MeasuredLog::open(const std::string &fileName)
+{
+	for (auto &column : mColumns) column.clear();
+	mError.clear();
+	std::ifstream file(fileName);
+	if (!file.is_open()) {
+		mError = "Could not open " + fileName;
+		return false;
+	}
+
+	const char* names[ColumnCount] = { "time", "power", "temperature", "safety", "regulating", "shim" };
+	std::vector<int> columns;
+	std::string line;
+	size_t lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty() || line[0] == '#') continue;
+		std::istringstream fields(line);
+		if (columns.empty()) {
+			// The header, columns that aren't known are skipped
+			std::string name;
+			while (fields >> name) {
+				std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+				columns.push_back((int)(std::find(names, names + ColumnCount, name) - names));
+			}
+			if (std::find(columns.begin(), columns.end(), Time) == columns.end() || std::find(columns.begin(), columns.end(), Power) == columns.end()) {
+				mError = fileName + " has no time or power column";
+				return false;
+			}
+			continue;
+		}
+		for (int column : columns) {
+			double value;
+			if (!(fields >> value)) {
+				mError = fileName + ": line " + std::to_string(lineNumber) + " has too few values";
+				for (auto &c : mColumns) c.clear();
+				return false;
+			}
+			if (column < ColumnCount) mColumns[column].push_back(value);
+		}
+		const std::vector<double> &time = mColumns[Time];
+		if (time.size() > 1 && time[time.size() - 1] <= time[time.size() - 2]) {
+			mError = fileName + ": the time goes back on line " + std::to_string(lineNumber);
+			for (auto &c : mColumns) c.clear();
+			return false;
+		}
+	}
+	if (size() < 2) {
+		mError = fileName + " has less than two rows";
+		return false;
+	}
+	return true;
+}
+
+double MeasuredLog::rodPosition(size_t rod, double time) const
+{
+	const std::vector<double> &times = mColumns[Time];
+	const std::vector<double> &positions = mColumns[SafetyRod + rod];
+	const size_t next = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+	if (next == 0) return positions.front();
+	if (next == times.size()) return positions.back();
+	const double a = (time - times[next - 1]) / (times[next] - times[next - 1]);
+	return positions[next - 1] * (1. - a) + positions[next] * a;
+}
+
+static void checkFitBound(const FitBound &bound)
+{
+	if (bound.parameter == FitParameter::RodCurve && (bound.rod >= NUMBER_OF_CONTROL_RODS || bound.point > 1))
+		throw std::out_of_range("no " + fitParameterName(bound));
+}
+
+void applyFitParameter(Settings &settings, const FitBound &bound, double value)
+{
+	checkFitBound(bound);
+	switch (bound.parameter) {
+	case FitParameter::Alpha0: settings.alpha0 = (float)value; break;
+	case FitParameter::AlphaAtT1: settings.alphaAtT1 = (float)value; break;
+	case FitParameter::AlphaT1: settings.alphaT1 = (float)value; break;
+	case FitParameter::AlphaK: settings.alphaK = value; break;
+	case FitParameter::RodCurve: settings.rodSettings[bound.rod].rodCurve[bound.point] = (float)value; break;
+	case FitParameter::CoolingPower: settings.waterCoolingPower = value; break;
+	}
+}
+
+void applyFitParameter(Simulator &simulator, const FitBound &bound, double value)
+{
+	// Rounded as the settings would be, so the fitted settings run the same
+	checkFitBound(bound);
+	switch (bound.parameter) {
+	case FitParameter::Alpha0: simulator.setAlpha0((float)value); break;
+	case FitParameter::AlphaAtT1: simulator.setAlphaPeak((float)value); break;
+	case FitParameter::AlphaT1: simulator.setAlphaTempPeak((float)value); break;
+	case FitParameter::AlphaK: simulator.setAlphaSlope(value); break;
+	case FitParameter::RodCurve: simulator.rods[bound.rod]->setParameter(bound.point, (float)value); break;
+	case FitParameter::CoolingPower: simulator.setCoolingPower(value); break;
+	}
+}
+
+static double fitParameterValue(const Settings &settings, const FitBound &bound)
+{
+	checkFitBound(bound);
+	switch (bound.parameter) {
+	case FitParameter::Alpha0: return settings.alpha0;
+	case FitParameter::AlphaAtT1: return settings.alphaAtT1;
+	case FitParameter::AlphaT1: return settings.alphaT1;
+	case FitParameter::AlphaK: return settings.alphaK;
+	case FitParameter::RodCurve: return settings.rodSettings[bound.rod].rodCurve[bound.point];
+	case FitParameter::CoolingPower: return settings.waterCoolingPower;
+	}
+	return 0.;
+}
+
+void applyFit(Settings &settings, const std::vector<FitBound> &bounds, const std::vector<double> &values)
+{
+	for (size_t i = 0; i < bounds.size() && i < values.size(); i++) applyFitParameter(settings, bounds[i], values[i]);
+}
+
+void applyFit(Settings &settings, const std::vector<FitBound> &bounds, const FitResult &fit)
+{
+	applyFit(settings, bounds, fit.values);
+	settings.excessReactivity = fit.excessReactivity;
+}
+
+std::string fitParameterName(const FitBound &bound)
+{
+	switch (bound.parameter) {
+	case FitParameter::Alpha0: return "alpha0";
+	case FitParameter::AlphaAtT1: return "alpha at T1";
+	case FitParameter::AlphaT1: return "alpha T1";
+	case FitParameter::AlphaK: return "alpha k";
+	case FitParameter::RodCurve: return "rod " + std::to_string(bound.rod + 1) + " curve " + std::to_string(bound.point);
+	case FitParameter::CoolingPower: return "cooling power";
+	}
+	return "unknown";
+}
+
+// The part of the reactivity at the start that the fitted parameters change
+static double startReactivity(Simulator &simulator)
+{
+	double reactivity = simulator.getTotalRodReactivity();
+	if (simulator.getTemperatureEffectsEnabled()) {
+		const double temperature = simulator.getCurrentTemperature();
+		reactivity -= simulator.getReactivityCoefficient(temperature) * (temperature - ENVIRONMENT_TEMPERATURE_DEFAULT);
+	}
+	return reactivity;
+}
+
+bool prepareFitStart(const Settings &base, const MeasuredLog &log, std::string &start, std::string &error)
+{
+	if (log.size() < 2) {
+		error = "The log has less than two rows";
+		return false;
+	}
+	const double power = log.column(MeasuredLog::Power).front();
+	if (!(power > 0.)) {
+		error = "The log doesn't start at a positive power";
+		return false;
+	}
+	Settings settings(base);
+	std::unique_ptr<Simulator> simulator(new Simulator(&settings));
+	simulator->journal.setRecording(false);
+	simulator->pushStableState(power);
+	simulator->scram(Simulator::ScramSignals::None);
+
+	// The rods go to the logged positions, the excess reactivity keeps the start critical
+	const double before = simulator->getTotalRodReactivity();
+	const double time = log.column(MeasuredLog::Time).front();
+	for (size_t rod = 0; rod < NUMBER_OF_CONTROL_RODS; rod++) {
+		if (!log.has((MeasuredLog::Column)(MeasuredLog::SafetyRod + rod))) continue;
+		simulator->rods[rod]->moveRodToStep((float)log.rodPosition(rod, time));
+		simulator->rods[rod]->clearCommands();
+	}
+	simulator->setExcessReactivity(simulator->getExcessReactivity() + before - simulator->getTotalRodReactivity());
+
+	start = simulator->checkpointData();
+	return true;
+}
+
+double scoreFitCandidate(const Settings &base, const MeasuredLog &log, const std::string &start, const std::vector<FitBound> &bounds,
+	const std::vector<double> &values, const FitOptions &options, double *excessReactivity)
+{
+	const double failed = std::numeric_limits<double>::infinity();
+	if (values.size() != bounds.size()) {
+		std::cerr << "Fit candidate has " << values.size() << " values for " << bounds.size() << " parameters" << std::endl;
+		return failed;
+	}
+	try {
+		Settings settings(base);
+		std::unique_ptr<Simulator> simulator(new Simulator(&settings));
+		simulator->journal.setRecording(false);
+		if (!simulator->restoreCheckpointData(start)) return failed;
+		const double before = startReactivity(*simulator);
+		for (size_t i = 0; i < bounds.size(); i++) applyFitParameter(*simulator, bounds[i], values[i]);
+		if (options.balanceStart)
+			simulator->setExcessReactivity(simulator->getExcessReactivity() + before - startReactivity(*simulator));
+		if (excessReactivity) *excessReactivity = simulator->getExcessReactivity();
+
+		const std::vector<double> &time = log.column(MeasuredLog::Time);
+		const std::vector<double> &power = log.column(MeasuredLog::Power);
+		const std::vector<double> &temperature = log.column(MeasuredLog::Temperature);
+		const bool hasTemperature = log.has(MeasuredLog::Temperature);
+		auto stepOf = [&](size_t row) { return (size_t)std::llround((time[row] - time[0]) / DT_STEP); };
+		const size_t first = simulator->getCurrentIndex();
+		const size_t steps = stepOf(log.size() - 1);
+
+		// The rows are compared after the frame that reached them, before the data wraps around
+		double sum = 0.;
+		size_t residuals = 0;
+		size_t row = 0;
+		size_t done = 0;
+		auto follow = [&](size_t frame) {
+			done += frame;
+			for (; row < log.size() && stepOf(row) <= done; row++) {
+				const size_t index = simulator->shiftIndex(first, (long)stepOf(row));
+				if (power[row] > 0.) {
+					const double simulated = std::max(simulator->powerFromNeutrons(simulator->state_vector_[0][index]), 1e-30);
+					sum += std::pow(std::log(simulated / power[row]), 2);
+					residuals++;
+				}
+				if (hasTemperature) {
+					sum += std::pow((simulator->temperature_[index] - temperature[row]) / options.temperatureScale, 2);
+					residuals++;
+				}
+			}
+			// The rods follow the log in the next frame
+			for (size_t rod = 0; rod < NUMBER_OF_CONTROL_RODS; rod++) {
+				if (!log.has((MeasuredLog::Column)(MeasuredLog::SafetyRod + rod))) continue;
+				simulator->rods[rod]->moveRodToStep((float)log.rodPosition(rod, time[0] + done * DT_STEP));
+				simulator->rods[rod]->clearCommands();
+			}
+			return true;
+		};
+		follow(0);
+		simulator->run(steps * DT_STEP, RUN_FRAME_STEPS, follow);
+		const double score = residuals ? sum / residuals : failed;
+		return std::isfinite(score) ? score : failed;
+	}
+	catch (std::exception &e) {
+		std::cerr << "Fit candidate failed: " << e.what() << std::endl;
+		return failed;
+	}
+}
+
+FitResult fitParameters(const Settings &base, const MeasuredLog &log, const std::vector<FitBound> &bounds, const FitOptions &options)
+{
+	FitResult result;
+	const size_t dimensions = bounds.size();
+	try {
+		for (const FitBound &bound : bounds) {
+			checkFitBound(bound);
+			if (!(bound.lower <= bound.upper)) throw std::invalid_argument("the bounds of " + fitParameterName(bound) + " are reversed");
+		}
+	}
+	catch (std::exception &e) {
+		result.error = e.what();
+		return result;
+	}
+	if (dimensions == 0) {
+		result.error = "Nothing to fit";
+		return result;
+	}
+	std::string start;
+	if (!prepareFitStart(base, log, start, result.error)) return result;
+
+	const size_t population = options.population ? std::max(options.population, (size_t)4) : std::max(10 * dimensions, (size_t)8);
+	std::mt19937_64 random(options.seed);
+	std::uniform_real_distribution<double> uniform(0., 1.);
+	std::vector<std::vector<double>> members(population, std::vector<double>(dimensions));
+	std::vector<double> scores(population), excess(population);
+	auto evaluate = [&](const std::vector<std::vector<double>> &candidates, std::vector<double> &candidateScores, std::vector<double> &candidateExcess) {
+		runParallel(candidates.size(), options.threads, [&](size_t i) {
+			candidateScores[i] = scoreFitCandidate(base, log, start, bounds, candidates[i], options, &candidateExcess[i]);
+		});
+		result.evaluations += candidates.size();
+	};
+
+	// The base settings are one of the first generation, so the fit can't end worse than them
+	for (size_t j = 0; j < dimensions; j++) {
+		members[0][j] = std::min(std::max(fitParameterValue(base, bounds[j]), bounds[j].lower), bounds[j].upper);
+		for (size_t i = 1; i < population; i++) members[i][j] = bounds[j].lower + uniform(random) * (bounds[j].upper - bounds[j].lower);
+	}
+	evaluate(members, scores, excess);
+
+	std::vector<std::vector<double>> trials(population, std::vector<double>(dimensions));
+	std::vector<double> trialScores(population), trialExcess(population);
+	std::uniform_int_distribution<size_t> pick(0, population - 1), dimension(0, dimensions - 1);
+	for (; result.generations < options.generations; result.generations++) {
+		const auto range = std::minmax_element(scores.begin(), scores.end());
+		std::cout << "Fit: generation " << result.generations << " of " << options.generations << ", best score " << *range.first << std::endl;
+		if (std::isfinite(*range.second) && *range.second - *range.first <= options.tolerance * *range.first) break;
+
+		// DE/rand/1/bin, values past a bound land between the parent and the bound
+		for (size_t i = 0; i < population; i++) {
+			size_t a, b, c;
+			do a = pick(random); while (a == i);
+			do b = pick(random); while (b == i || b == a);
+			do c = pick(random); while (c == i || c == a || c == b);
+			const size_t forced = dimension(random);
+			for (size_t j = 0; j < dimensions; j++) {
+				double value = members[i][j];
+				if (j == forced || uniform(random) < options.crossover) {
+					value = members[a][j] + options.differentialWeight * (members[b][j] - members[c][j]);
+					if (value < bounds[j].lower) value = (bounds[j].lower + members[i][j]) / 2.;
+					else if (value > bounds[j].upper) value = (bounds[j].upper + members[i][j]) / 2.;
+				}
+				trials[i][j] = value;
+			}
+		}
+		evaluate(trials, trialScores, trialExcess);
+		for (size_t i = 0; i < population; i++) {
+			if (trialScores[i] <= scores[i]) {
+				members[i] = trials[i];
+				scores[i] = trialScores[i];
+				excess[i] = trialExcess[i];
+			}
+		}
+	}
+	const size_t best = std::min_element(scores.begin(), scores.end()) - scores.begin();
+	result.values = members[best];
+	result.score = scores[best];
+	result.excessReactivity = excess[best];
+	if (!std::isfinite(result.score)) result.error = "No candidate ran through the log";
+	std::cout << "Fit after " << result.evaluations << " runs, score " << result.score << ":" << std::endl;
+	for (size_t j = 0; j < dimensions; j++) std::cout << "  " << fitParameterName(bounds[j]) << " = " << result.values[j] << std::endl;
+	return result;
+}
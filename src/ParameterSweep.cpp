@@ -0,0 +1,171 @@
+#include <ParameterSweep.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+void applySweepChange(Settings &settings, const SweepChange &change)
+{
+	const size_t limit = change.parameter == SweepParameter::RodWorth ? NUMBER_OF_CONTROL_RODS : 6;
+	if ((change.parameter == SweepParameter::RodWorth || change.parameter == SweepParameter::Beta || change.parameter == SweepParameter::Lambda)
+		&& change.index >= limit) throw std::out_of_range("no " + sweepChangeName(change));
+	switch (change.parameter) {
+	case SweepParameter::RodWorth: settings.rodSettings[change.index].rodWorth = (float)change.value; break;
+	case SweepParameter::Beta: settings.betas[change.index] = change.value; break;
+	case SweepParameter::Lambda: settings.lambdas[change.index] = change.value; break;
+	case SweepParameter::Alpha0: settings.alpha0 = (float)change.value; break;
+	case SweepParameter::AlphaAtT1: settings.alphaAtT1 = (float)change.value; break;
+	case SweepParameter::AlphaT1: settings.alphaT1 = (float)change.value; break;
+	case SweepParameter::AlphaK: settings.alphaK = change.value; break;
+	case SweepParameter::PromptNeutronLifetime: settings.promptNeutronLifetime = change.value; break;
+	case SweepParameter::ExcessReactivity: settings.excessReactivity = (float)change.value; break;
+	}
+}
+
+std::string sweepChangeName(const SweepChange &change)
+{
+	switch (change.parameter) {
+	case SweepParameter::RodWorth: return "rod worth " + std::to_string(change.index + 1);
+	case SweepParameter::Beta: return "beta " + std::to_string(change.index + 1);
+	case SweepParameter::Lambda: return "lambda " + std::to_string(change.index + 1);
+	case SweepParameter::Alpha0: return "alpha0";
+	case SweepParameter::AlphaAtT1: return "alpha at T1";
+	case SweepParameter::AlphaT1: return "alpha T1";
+	case SweepParameter::AlphaK: return "alpha k";
+	case SweepParameter::PromptNeutronLifetime: return "prompt neutron lifetime";
+	case SweepParameter::ExcessReactivity: return "excess reactivity";
+	}
+	return "unknown";
+}
+
+std::vector<SweepVariation> sweepGrid(const std::vector<std::vector<SweepChange>> &axes)
+{
+	std::vector<SweepVariation> variations(1);
+	for (const auto &axis : axes) {
+		std::vector<SweepVariation> combined;
+		combined.reserve(variations.size() * axis.size());
+		for (const SweepVariation &variation : variations) {
+			for (const SweepChange &change : axis) {
+				combined.push_back(variation);
+				combined.back().push_back(change);
+			}
+		}
+		variations = std::move(combined);
+	}
+	return variations;
+}
+
+SweepResult runSweepVariation(const Settings &base, const SweepVariation &variation, const Script &script, double duration,
+	const SweepObserver &observer)
+{
+	SweepResult result;
+	result.variation = variation;
+	try {
+		Settings settings(base);
+		for (const SweepChange &change : variation) applySweepChange(settings, change);
+		std::unique_ptr<Simulator> simulator(new Simulator(&settings));
+		simulator->journal.setRecording(false);
+		simulator->setScramCallback([&result, &simulator](int) {
+			if (result.scramTime < 0.) result.scramTime = simulator->getCurrentTime();
+		});
+		for (const Command &command : script.timed) simulator->addScriptCommand(command);
+		if (!script.program.empty()) simulator->addScriptProgram(script.program);
+
+		// The extremes are found in the samples of each frame
+		double peakNeutrons = simulator->state_vector_[0][simulator->getCurrentIndex()];
+		float maxTemperature = simulator->temperature_[simulator->getCurrentIndex()];
+		simulator->run(duration, RUN_FRAME_STEPS, [&](size_t frame) {
+			for (size_t i = 0; i < frame; i++) {
+				const size_t index = simulator->shiftIndex(simulator->getCurrentIndex(), -(long)i);
+				peakNeutrons = std::max(peakNeutrons, simulator->state_vector_[0][index]);
+				maxTemperature = std::max(maxTemperature, simulator->temperature_[index]);
+			}
+			if (observer) observer(*simulator);
+			return true;
+		});
+		result.peakPower = simulator->powerFromNeutrons(peakNeutrons);
+		result.maxFuelTemperature = maxTemperature;
+		result.finalPower = simulator->getCurrentPower();
+		result.finalXenon = *simulator->getXenonConcentration() / AVOGADRO_NUM * XENON_MOLAR_MASS;
+	}
+	catch (std::exception &e) {
+		result.error = e.what();
+		if (result.error.empty()) result.error = "failed";
+	}
+	return result;
+}
+
+void runParallel(size_t count, unsigned threads, const std::function<void(size_t)> &run)
+{
+	if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+	threads = (unsigned)std::min((size_t)threads, count);
+	// The runs take about as long as each other, a free thread takes the next one
+	std::atomic<size_t> next(0);
+	auto work = [&]() {
+		for (size_t i = next++; i < count; i = next++) run(i);
+	};
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads; t++) pool.emplace_back(work);
+	work();
+	for (std::thread &thread : pool) thread.join();
+}
+
+std::vector<SweepResult> runSweep(const Settings &base, const std::vector<SweepVariation> &variations,
+	const Script &script, double duration, unsigned threads)
+{
+	std::vector<SweepResult> results(variations.size());
+	const auto start = std::chrono::steady_clock::now();
+	std::atomic<size_t> finished(0);
+	std::mutex progress;
+	runParallel(variations.size(), threads, [&](size_t i) {
+		results[i] = runSweepVariation(base, variations[i], script, duration);
+		const size_t done = ++finished;
+		std::lock_guard<std::mutex> lock(progress);
+		if (!results[i].error.empty()) std::cerr << "Sweep run " << i << " failed: " << results[i].error << std::endl;
+		std::cout << "Sweep: " << done << " of " << variations.size() << " runs" << std::endl;
+	});
+	std::cout << "Sweep of " << variations.size() << " runs took "
+		<< std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+	return results;
+}
+
+bool saveSweep(const std::string &fileName, const std::vector<SweepResult> &results)
+{
+	// A column for every parameter that was changed, in the order they first appear
+	std::vector<std::string> columns;
+	for (const SweepResult &result : results) {
+		for (const SweepChange &change : result.variation) {
+			const std::string name = sweepChangeName(change);
+			if (std::find(columns.begin(), columns.end(), name) == columns.end()) columns.push_back(name);
+		}
+	}
+
+	std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+	for (const std::string &column : columns) file << column << '\t';
+	file << "peak power (W)\tmax fuel temperature (C)\tscram time (s)\tfinal power (W)\tfinal xenon (g/m3)\terror" << std::endl;
+	file.precision(9);
+	for (const SweepResult &result : results) {
+		for (const std::string &column : columns) {
+			for (const SweepChange &change : result.variation) {
+				if (sweepChangeName(change) == column) {
+					file << change.value;
+					break;
+				}
+			}
+			file << '\t';
+		}
+		file << result.peakPower << '\t' << result.maxFuelTemperature << '\t' << result.scramTime << '\t'
+			<< result.finalPower << '\t' << result.finalXenon << '\t' << result.error << '\n';
+	}
+	if (!file) {
+		std::cerr << "Could not write the sweep to " << fileName << std::endl;
+		return false;
+	}
+	std::cout << "Sweep of " << results.size() << " runs saved to " << fileName << std::endl;
+	return true;
+}
@@ -0,0 +1,365 @@
+#include <RemoteControl.h>
+#include <LocalSocket.h>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	// Recursive descent over the request text, depth is limited so a hostile request can't overflow the stack
+	class JsonParser {
+	public:
+		JsonParser(const std::string &text) : c(text.c_str()), end(text.c_str() + text.size()) {}
+
+		bool document(JsonValue &value) {
+			if (!parse(value, 0)) return false;
+			skipSpace();
+			return c == end;
+		}
+
+	private:
+		const char* c;
+		const char* end;
+
+		void skipSpace() {
+			while (c < end && (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n')) c++;
+		}
+		bool literal(const char* word) {
+			size_t length = strlen(word);
+			if ((size_t)(end - c) < length || strncmp(c, word, length) != 0) return false;
+			c += length;
+			return true;
+		}
+
+		bool parse(JsonValue &value, int depth) {
+			if (depth > 32) return false;
+			skipSpace();
+			if (c == end) return false;
+			value = JsonValue();
+			switch (*c) {
+			case '{':
+				value.type = JsonValue::Object;
+				c++;
+				skipSpace();
+				if (c < end && *c == '}') { c++; return true; }
+				while (true) {
+					std::pair<std::string, JsonValue> member;
+					skipSpace();
+					if (!string(member.first)) return false;
+					skipSpace();
+					if (c == end || *c++ != ':') return false;
+					if (!parse(member.second, depth + 1)) return false;
+					value.members.push_back(std::move(member));
+					skipSpace();
+					if (c == end) return false;
+					if (*c == '}') { c++; return true; }
+					if (*c++ != ',') return false;
+				}
+			case '[':
+				value.type = JsonValue::Array;
+				c++;
+				skipSpace();
+				if (c < end && *c == ']') { c++; return true; }
+				while (true) {
+					value.items.emplace_back();
+					if (!parse(value.items.back(), depth + 1)) return false;
+					skipSpace();
+					if (c == end) return false;
+					if (*c == ']') { c++; return true; }
+					if (*c++ != ',') return false;
+				}
+			case '"':
+				value.type = JsonValue::String;
+				return string(value.string);
+			case 't':
+				value.type = JsonValue::Bool;
+				value.boolean = true;
+				return literal("true");
+			case 'f':
+				value.type = JsonValue::Bool;
+				return literal("false");
+			case 'n':
+				return literal("null");
+			default: {
+				// The text is zero terminated, so strtod can't run past the end
+				char* numberEnd;
+				value.type = JsonValue::Number;
+				value.number = strtod(c, &numberEnd);
+				if (numberEnd == c || !std::isfinite(value.number)) return false;
+				c = numberEnd;
+				return true;
+			}
+			}
+		}
+
+		bool string(std::string &out) {
+			if (c == end || *c != '"') return false;
+			c++;
+			while (c < end && *c != '"') {
+				if (*c != '\\') {
+					out += *c++;
+					continue;
+				}
+				if (++c == end) return false;
+				switch (*c++) {
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u': {
+					if (end - c < 4) return false;
+					unsigned code = (unsigned)strtoul(std::string(c, 4).c_str(), nullptr, 16);
+					c += 4;
+					// UTF-8, surrogate pairs are not needed for any of the names used here
+					if (code < 0x80) out += (char)code;
+					else if (code < 0x800) {
+						out += (char)(0xC0 | (code >> 6));
+						out += (char)(0x80 | (code & 0x3F));
+					}
+					else {
+						out += (char)(0xE0 | (code >> 12));
+						out += (char)(0x80 | ((code >> 6) & 0x3F));
+						out += (char)(0x80 | (code & 0x3F));
+					}
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			if (c == end) return false;
+			c++;
+			return true;
+		}
+	};
+}
+
+bool JsonValue::parse(const std::string &text, JsonValue &value)
+{
+	return JsonParser(text).document(value);
+}
+
+std::string JsonValue::dump() const
+{
+	std::string text;
+	switch (type) {
+	case Null:
+		return "null";
+	case Bool:
+		return boolean ? "true" : "false";
+	case Number:
+		return JsonWriter::number(number);
+	case String:
+		return JsonWriter::quote(string);
+	case Array:
+		for (const JsonValue &item : items) text += (text.empty() ? "" : ",") + item.dump();
+		return "[" + text + "]";
+	case Object:
+		for (const auto &member : members) text += (text.empty() ? "" : ",") + JsonWriter::quote(member.first) + ":" + member.second.dump();
+		return "{" + text + "}";
+	}
+	return "null";
+}
+
+const JsonValue* JsonValue::find(const std::string &name) const
+{
+	for (const auto &member : members) {
+		if (member.first == name) return &member.second;
+	}
+	return nullptr;
+}
+
+JsonWriter& JsonWriter::add(const char* name, double value)
+{
+	return raw(name, number(value));
+}
+
+JsonWriter& JsonWriter::raw(const char* name, const std::string &json)
+{
+	if (!mText.empty()) mText += ',';
+	mText += quote(name) + ':' + json;
+	return *this;
+}
+
+std::string JsonWriter::quote(const std::string &value)
+{
+	std::string text = "\"";
+	for (char ch : value) {
+		switch (ch) {
+		case '"': text += "\\\""; break;
+		case '\\': text += "\\\\"; break;
+		case '\n': text += "\\n"; break;
+		case '\r': text += "\\r"; break;
+		case '\t': text += "\\t"; break;
+		default:
+			if ((unsigned char)ch < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)ch);
+				text += escaped;
+			}
+			else text += ch;
+		}
+	}
+	return text + "\"";
+}
+
+std::string JsonWriter::number(double value)
+{
+	// JSON has no infinity, a period of a steady reactor is sent as null
+	if (!std::isfinite(value)) return "null";
+	char text[32];
+	snprintf(text, sizeof(text), "%.17g", value);
+	return text;
+}
+
+bool RemoteControlServer::start(int port)
+{
+	stop();
+	intptr_t listener = LocalSocket::listen(port);
+	if (listener == INVALID) {
+		std::cerr << "Remote control: could not listen on port " << port << std::endl;
+		return false;
+	}
+	mListener = listener;
+	mPort = port;
+	std::cout << "Remote control: listening on 127.0.0.1:" << port << std::endl;
+	return true;
+}
+
+void RemoteControlServer::stop()
+{
+	if (!isRunning()) return;
+	for (Client &client : mClients) LocalSocket::close(client.socket);
+	mClients.clear();
+	LocalSocket::close(mListener);
+	mListener = INVALID;
+	LocalSocket::release();
+	std::cout << "Remote control: stopped" << std::endl;
+}
+
+void RemoteControlServer::poll(std::vector<RemoteRequest> &requests)
+{
+	if (!isRunning()) return;
+	intptr_t socket;
+	while ((socket = LocalSocket::accept(mListener)) != INVALID) {
+		Client client;
+		client.socket = socket;
+		client.id = mNextClient++;
+		mClients.push_back(std::move(client));
+		std::cout << "Remote control: client connected (" << mClients.size() << " total)" << std::endl;
+	}
+	// From the back so dropping keeps the indices valid
+	for (size_t i = mClients.size(); i-- > 0;) {
+		if (!receive(mClients[i], requests)) drop(i, "disconnected");
+	}
+	flush();
+}
+
+void RemoteControlServer::flush()
+{
+	for (size_t i = mClients.size(); i-- > 0;) {
+		Client &client = mClients[i];
+		if (client.out.size() - client.sent > REMOTE_CONTROL_MAX_BACKLOG) drop(i, "dropped, it does not read the responses");
+		else if (!send(client)) drop(i, "disconnected");
+	}
+}
+
+bool RemoteControlServer::receive(Client &client, std::vector<RemoteRequest> &requests)
+{
+	char buffer[4096];
+	while (true) {
+		int received = LocalSocket::receive(client.socket, buffer, sizeof(buffer));
+		if (received <= 0) return received == 0;
+		client.in.append(buffer, received);
+		size_t start = 0, end;
+		while ((end = client.in.find('\n', start)) != std::string::npos) {
+			request(client, client.in.substr(start, end - start), requests);
+			start = end + 1;
+		}
+		client.in.erase(0, start);
+		if (client.in.size() > REMOTE_CONTROL_MAX_REQUEST) {
+			client.in.clear();
+			queue(client.id, "null", "\"error\":{\"code\":" + std::to_string(InvalidRequest) + ",\"message\":\"Request too long\"}");
+		}
+	}
+}
+
+void RemoteControlServer::request(Client &client, const std::string &line, std::vector<RemoteRequest> &requests)
+{
+	if (line.find_first_not_of(" \t\r") == std::string::npos) return;
+	RemoteRequest request;
+	request.client = client.id;
+	JsonValue message;
+	if (!JsonValue::parse(line, message)) {
+		request.id = "null";
+		respondError(request, ParseError, "Parse error");
+		return;
+	}
+	const JsonValue* id = message.find("id");
+	const JsonValue* method = message.find("method");
+	const JsonValue* params = message.find("params");
+	if (id) request.id = id->dump();
+	if (message.type != JsonValue::Object || !method || !method->isString() ||
+		(params && params->type != JsonValue::Object && params->type != JsonValue::Null)) {
+		if (!id) request.id = "null";
+		respondError(request, InvalidRequest, "Invalid request");
+		return;
+	}
+	request.method = method->string;
+	if (params) request.params = *params;
+	request.params.type = JsonValue::Object;
+	requests.push_back(std::move(request));
+}
+
+void RemoteControlServer::respond(const RemoteRequest &request, const std::string &resultJson)
+{
+	queue(request.client, request.id, "\"result\":" + resultJson);
+}
+
+void RemoteControlServer::respondError(const RemoteRequest &request, int code, const std::string &message)
+{
+	queue(request.client, request.id, "\"error\":{\"code\":" + std::to_string(code) + ",\"message\":" + JsonWriter::quote(message) + "}");
+}
+
+void RemoteControlServer::queue(uint64_t client, const std::string &id, const std::string &member)
+{
+	if (id.empty()) return;
+	for (Client &c : mClients) {
+		if (c.id == client) {
+			c.out += "{\"jsonrpc\":\"2.0\",\"id\":" + id + "," + member + "}\n";
+			return;
+		}
+	}
+}
+
+bool RemoteControlServer::send(Client &client)
+{
+	while (client.sent < client.out.size()) {
+		int sent = LocalSocket::send(client.socket, client.out.data() + client.sent, client.out.size() - client.sent);
+		if (sent > 0) client.sent += sent;
+		else if (sent == 0) break;
+		else return false;
+	}
+	if (client.sent == client.out.size()) {
+		client.out.clear();
+		client.sent = 0;
+	}
+	else if (client.sent > client.out.size() / 2) {
+		client.out.erase(0, client.sent);
+		client.sent = 0;
+	}
+	return true;
+}
+
+void RemoteControlServer::drop(size_t index, const char* reason)
+{
+	LocalSocket::close(mClients[index].socket);
+	mClients.erase(mClients.begin() + index);
+	std::cout << "Remote control: client " << reason << " (" << mClients.size() << " left)" << std::endl;
+}
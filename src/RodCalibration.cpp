@@ -0,0 +1,166 @@
+#include <RodCalibration.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <cmath>
+
+double inhourReactivity(const Simulator &simulator, double period)
+{
+	// rho = L / T + sum of beta_i / (1 + lambda_i T), the delayed groups that are switched off don't count
+	const double* betas = simulator.getDelayedGroupFractions();
+	const double* lambdas = simulator.getDelayedGroupDecays();
+	const bool* enabled = simulator.getDelayedGroupEnabled();
+	double reactivity = simulator.getPromptNeutronLifetime() / period;
+	for (int i = 0; i < 6; i++) {
+		if (enabled[i]) reactivity += betas[i] / (1. + lambdas[i] * period);
+	}
+	return reactivity * 1e5;
+}
+
+// Withdraws the rod from critical at one position to the next and measures the period
+static RodCalibrationPoint calibrateIncrement(const Settings &prepared, size_t rod, size_t from, size_t to,
+	const RodCalibrationOptions &options, std::string &name)
+{
+	RodCalibrationPoint point;
+	point.position = to;
+	point.period = -1.;
+	Settings settings(prepared);
+	std::unique_ptr<Simulator> simulator(new Simulator(&settings));
+	simulator->journal.setRecording(false);
+	bool scrammed = false;
+	simulator->setScramCallback([&scrammed](int) { scrammed = true; });
+	simulator->pushStableState(options.power);
+	simulator->scram(Simulator::ScramSignals::None);
+
+	ControlRod* controlRod = simulator->rods[rod];
+	name = controlRod->getRodName();
+	point.modelIntegral = controlRod->stepDataArray()[to] * controlRod->getRodWorth();
+	const double before = simulator->getTotalRodReactivity();
+	controlRod->moveRodToStep((float)from);
+	controlRod->clearCommands();
+	simulator->setExcessReactivity(simulator->getExcessReactivity() + before - simulator->getTotalRodReactivity());
+	controlRod->moveRodToStep((float)to);
+	controlRod->clearCommands();
+
+	// The logarithm of the power after every frame until it rose enough
+	const double startPower = simulator->powerFromNeutrons(simulator->state_vector_[0][simulator->getCurrentIndex()]);
+	std::vector<double> times, logPower;
+	size_t steps = 0;
+	simulator->run(options.maxTime, RUN_FRAME_STEPS, [&](size_t frame) {
+		steps += frame;
+		const double power = simulator->powerFromNeutrons(simulator->state_vector_[0][simulator->getCurrentIndex()]);
+		times.push_back(steps * DT_STEP);
+		logPower.push_back(std::log(power));
+		return !scrammed && power < startPower * options.powerRatio;
+	});
+	if (scrammed || times.size() < 4) return point;
+
+	// The transients of the faster roots are gone in the second half, a line through its logarithm
+	const size_t first = times.size() / 2;
+	const double n = (double)(times.size() - first);
+	double st = 0., sp = 0., stt = 0., stp = 0.;
+	for (size_t i = first; i < times.size(); i++) {
+		st += times[i];
+		sp += logPower[i];
+		stt += times[i] * times[i];
+		stp += times[i] * logPower[i];
+	}
+	const double slope = (n * stp - st * sp) / (n * stt - st * st);
+	if (slope > 0.) {
+		point.period = 1. / slope;
+		point.reactivity = inhourReactivity(*simulator, point.period);
+	}
+	return point;
+}
+
+std::vector<RodCalibration> calibrateRods(const Settings &base, const std::vector<size_t> &rods, const RodCalibrationOptions &options)
+{
+	Settings prepared(base);
+	prepared.periodScram = false;
+	if (!options.feedback) {
+		prepared.temperatureEffects = false;
+		prepared.fissionPoisons = false;
+		prepared.neutronSourceInserted = false;
+	}
+	const size_t increments = std::max(options.increments, (size_t)1);
+	std::vector<RodCalibration> calibrations(rods.size());
+	for (size_t r = 0; r < rods.size(); r++) {
+		if (rods[r] >= NUMBER_OF_CONTROL_RODS) throw std::out_of_range("no rod " + std::to_string(rods[r]));
+		calibrations[r].rod = rods[r];
+		calibrations[r].points.resize(increments);
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	std::atomic<size_t> finished(0);
+	std::mutex progress;
+	runParallel(rods.size() * increments, options.threads, [&](size_t job) {
+		RodCalibration &calibration = calibrations[job / increments];
+		const size_t k = job % increments;
+		const size_t steps = prepared.rodSettings[calibration.rod].rodSteps;
+		std::string name;
+		calibration.points[k] = calibrateIncrement(prepared, calibration.rod, k * steps / increments, (k + 1) * steps / increments, options, name);
+		const size_t done = ++finished;
+		std::lock_guard<std::mutex> lock(progress);
+		calibration.name = name;
+		std::cout << "Rod calibration: " << done << " of " << rods.size() * increments << " increments" << std::endl;
+	});
+
+	for (RodCalibration &calibration : calibrations) {
+		// The model worth of the failed increments is missing from the measured integral, it is left out of the model's too
+		double integral = 0., sumSquares = 0., missing = 0., modelBefore = 0.;
+		size_t compared = 0;
+		for (RodCalibrationPoint &point : calibration.points) {
+			const bool measured = point.period > 0.;
+			if (!measured) {
+				calibration.failed++;
+				missing += point.modelIntegral - modelBefore;
+			}
+			modelBefore = point.modelIntegral;
+			integral += point.reactivity;
+			point.integral = integral;
+			if (!measured) continue;
+			const double difference = point.integral - (point.modelIntegral - missing);
+			sumSquares += difference * difference;
+			compared++;
+			calibration.maxDifference = std::max(calibration.maxDifference, std::abs(difference));
+		}
+		calibration.rmsDifference = compared ? std::sqrt(sumSquares / compared) : 0.;
+		std::cout << calibration.name << ": " << calibration.points.back().integral << " pcm measured, "
+			<< calibration.points.back().modelIntegral << " pcm in the model, RMS difference " << calibration.rmsDifference << " pcm" << std::endl;
+		if (calibration.failed) {
+			std::cerr << calibration.name << ": the period of " << calibration.failed << " of " << calibration.points.size()
+				<< " increments couldn't be measured, they are left out of the integral and the comparison" << std::endl;
+		}
+	}
+	std::cout << "Rod calibration took " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+	return calibrations;
+}
+
+bool saveRodCalibration(const std::string &fileName, const std::vector<RodCalibration> &calibrations)
+{
+	std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+	file.precision(7);
+	for (const RodCalibration &calibration : calibrations) {
+		file << "# " << calibration.name << " (rod " << calibration.rod << "), RMS difference " << calibration.rmsDifference
+			<< " pcm, largest " << calibration.maxDifference << " pcm" << std::endl;
+		if (calibration.failed) {
+			file << "# " << calibration.failed << " increments not measured (period -1), left out of the integral and the differences" << std::endl;
+		}
+		file << "position (steps)\tperiod (s)\treactivity (pcm)\tintegral (pcm)\tmodel integral (pcm)" << std::endl;
+		file << "0\t\t\t0\t0" << std::endl;
+		for (const RodCalibrationPoint &point : calibration.points) {
+			file << point.position << '\t' << point.period << '\t' << point.reactivity << '\t' << point.integral << '\t' << point.modelIntegral << '\n';
+		}
+		file << std::endl;
+	}
+	if (!file) {
+		std::cerr << "Could not write the rod calibration to " << fileName << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,95 @@
+#include <RunLog.h>
+#include <cstring>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool RunLogReader::open(const std::string &fileName)
+{
+	close();
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return fail("Could not open " + fileName);
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	HANDLE mapping = size.QuadPart ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	if (!mapping) {
+		CloseHandle(file);
+		return fail("Could not map " + fileName);
+	}
+	mFile = file;
+	mMapping = mapping;
+	mSize = (size_t)size.QuadPart;
+	mData = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) return fail("Could not open " + fileName);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return fail("Could not read " + fileName);
+	}
+	void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) return fail("Could not map " + fileName);
+	mSize = (size_t)st.st_size;
+	mData = (const char*)data;
+#endif
+	if (!mData) return fail("Could not map " + fileName);
+
+	// Validate the header and that every column lies inside the file
+	if (mSize < sizeof(RunLogHeader) || memcmp(header().magic, "RRSLOG\0\0", 8) != 0)
+		return fail(fileName + " is not a run log");
+	const RunLogHeader &h = header();
+	if (h.version > RUN_LOG_VERSION) return fail(fileName + " was written by a newer version");
+	// Sizes are compared with the room left after the offsets, a corrupt header must not overflow the sums
+	if (h.settingsOffset > mSize || h.settingsSize > mSize - h.settingsOffset
+		|| h.channelsOffset > mSize || h.channelCount > (mSize - h.channelsOffset) / sizeof(RunLogChannel))
+		return fail(fileName + " is truncated");
+	for (size_t i = 0; i < h.channelCount; i++) {
+		const RunLogChannel &c = channel(i);
+		size_t valueSize = c.type == (uint32_t)RunLogType::Float64 ? sizeof(double) : c.type == (uint32_t)RunLogType::Float32 ? sizeof(float) : 0;
+		if (!valueSize) return fail(fileName + " has a channel of unknown type");
+		if (c.offset % RUN_LOG_ALIGNMENT || c.offset > mSize || h.rowCount > (mSize - c.offset) / valueSize)
+			return fail(fileName + " is truncated");
+	}
+	mError = "";
+	return true;
+}
+
+void RunLogReader::close()
+{
+#if defined(_WIN32)
+	if (mData) UnmapViewOfFile(mData);
+	if (mMapping) CloseHandle((HANDLE)mMapping);
+	if (mFile) CloseHandle((HANDLE)mFile);
+	mMapping = nullptr;
+	mFile = nullptr;
+#else
+	if (mData) munmap((void*)mData, mSize);
+#endif
+	mData = nullptr;
+	mSize = 0;
+}
+
+int RunLogReader::findChannel(const std::string &name) const
+{
+	for (size_t i = 0; i < channelCount(); i++) {
+		if (strncmp(channel(i).name, name.c_str(), sizeof(RunLogChannel::name)) == 0) return (int)i;
+	}
+	return -1;
+}
+
+bool RunLogReader::fail(const std::string &message)
+{
+	close();
+	mError = message;
+	return false;
+}
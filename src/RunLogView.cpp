@@ -0,0 +1,215 @@
+#include <RunLogView.h>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+bool RunLogView::open(const std::string &fileName)
+{
+	close();
+	const std::string binaryExtension = RUN_LOG_EXTENSION;
+	bool binary = fileName.length() > binaryExtension.length() &&
+		fileName.compare(fileName.length() - binaryExtension.length(), binaryExtension.length(), binaryExtension) == 0;
+	if (!(binary ? openBinary(fileName) : openText(fileName))) return false;
+	if (!mRows) return fail(fileName + " contains no data");
+	mFileName = fileName;
+	mError = "";
+	buildPowerTable();
+	return true;
+}
+
+void RunLogView::close()
+{
+	mReader.close();
+	mFileName = "";
+	mRows = 0;
+	mTime = mPower = nullptr;
+	mReactivity = mRodReactivity = mTemperature = nullptr;
+	mOwnedTime = std::vector<double>();
+	mOwnedPower = std::vector<double>();
+	mOwnedReactivity = std::vector<float>();
+	mOwnedRodReactivity = std::vector<float>();
+	mOwnedTemperature = std::vector<float>();
+	mMeterReactivity = std::vector<float>();
+	mPowerTable = std::vector<PowerBlock>();
+}
+
+void RunLogView::computeMeterReactivity(ReactivityMeter meter)
+{
+	mMeterReactivity.resize(mRows);
+	meter.process(mTime, mPower, mRows, mMeterReactivity.data());
+}
+
+bool RunLogView::openBinary(const std::string &fileName)
+{
+	if (!mReader.open(fileName)) return fail(mReader.error());
+	const size_t rows = mReader.rowCount();
+	int time = mReader.findChannel("time");
+	int power = mReader.findChannel("power");
+	if (time < 0 || power < 0) return fail(fileName + " has no time or power channel");
+
+	// Columns of the expected type are used from the mapping, others are converted
+	auto doubles = [&](int channel, std::vector<double> &owned) -> const double* {
+		if (mReader.float64(channel)) return mReader.float64(channel);
+		owned.resize(rows);
+		for (size_t i = 0; i < rows; i++) owned[i] = mReader.value(channel, i);
+		return owned.data();
+	};
+	auto floats = [&](const char* name, std::vector<float> &owned) -> const float* {
+		int channel = mReader.findChannel(name);
+		if (channel >= 0 && mReader.float32(channel)) return mReader.float32(channel);
+		owned.assign(rows, 0.f);
+		if (channel >= 0) {
+			for (size_t i = 0; i < rows; i++) owned[i] = (float)mReader.value(channel, i);
+		}
+		return owned.data();
+	};
+	mTime = doubles(time, mOwnedTime);
+	mPower = doubles(power, mOwnedPower);
+	mReactivity = floats("reactivity", mOwnedReactivity);
+	mRodReactivity = floats("inserted reactivity", mOwnedRodReactivity);
+	mTemperature = floats("temperature", mOwnedTemperature);
+	mRows = rows;
+	return true;
+}
+
+bool RunLogView::openText(const std::string &fileName)
+{
+	std::ifstream logFile(fileName, std::ios::in | std::ios::binary);
+	if (!logFile.is_open()) return fail("Could not open " + fileName);
+	std::string text((std::istreambuf_iterator<char>(logFile)), std::istreambuf_iterator<char>());
+
+	// Lines are "h:m:s:ms reactivity inserted-reactivity power temperature xenon iodine", see DataExporter
+	const size_t expected = std::count(text.begin(), text.end(), '\n');
+	mOwnedTime.reserve(expected);
+	mOwnedPower.reserve(expected);
+	mOwnedReactivity.reserve(expected);
+	mOwnedRodReactivity.reserve(expected);
+	mOwnedTemperature.reserve(expected);
+	const char* c = text.c_str();
+	while (*c) {
+		const char* lineEnd = strchr(c, '\n');
+		if (!lineEnd) lineEnd = c + strlen(c);
+		if (*c != '#' && *c != '\r' && *c != '\n') {
+			char* end;
+			double clock[4];
+			for (int i = 0; i < 4; i++) {
+				clock[i] = strtod(c, &end);
+				c = (*end == ':') ? end + 1 : end;
+			}
+			double values[4];
+			for (int i = 0; i < 4; i++) {
+				values[i] = strtod(c, &end);
+				c = end;
+			}
+			if (c > lineEnd) return fail(fileName + " is not a data log");
+			mOwnedTime.push_back(clock[0] * 3600. + clock[1] * 60. + clock[2] + clock[3] * 1e-3);
+			mOwnedReactivity.push_back((float)values[0]);
+			mOwnedRodReactivity.push_back((float)values[1]);
+			mOwnedPower.push_back(values[2]);
+			mOwnedTemperature.push_back((float)values[3]);
+		}
+		c = *lineEnd ? lineEnd + 1 : lineEnd;
+	}
+	mTime = mOwnedTime.data();
+	mPower = mOwnedPower.data();
+	mReactivity = mOwnedReactivity.data();
+	mRodReactivity = mOwnedRodReactivity.data();
+	mTemperature = mOwnedTemperature.data();
+	mRows = mOwnedTime.size();
+	return true;
+}
+
+size_t RunLogView::indexFromTime(double time) const
+{
+	if (!mRows) return 0;
+	size_t index = std::lower_bound(mTime, mTime + mRows, time) - mTime;
+	return std::min(index, mRows - 1);
+}
+
+void RunLogView::buildPowerTable()
+{
+	mPowerTable.resize((mRows + RUN_LOG_VIEW_BLOCK - 1) / RUN_LOG_VIEW_BLOCK);
+	for (size_t b = 0; b < mPowerTable.size(); b++) {
+		PowerBlock &block = mPowerTable[b];
+		block.minPositive = std::numeric_limits<double>::infinity();
+		block.max = -std::numeric_limits<double>::infinity();
+		block.nonPositive = false;
+		const size_t end = std::min((b + 1) * RUN_LOG_VIEW_BLOCK, mRows);
+		for (size_t i = b * RUN_LOG_VIEW_BLOCK; i < end; i++) {
+			if (mPower[i] > 0.) block.minPositive = std::min(block.minPositive, mPower[i]);
+			else block.nonPositive = true;
+			block.max = std::max(block.max, mPower[i]);
+		}
+	}
+}
+
+bool RunLogView::powerOrders(size_t from, size_t to, int &low, int &high, bool &hasZero) const
+{
+	double minPositive = std::numeric_limits<double>::infinity();
+	double max = -std::numeric_limits<double>::infinity();
+	hasZero = false;
+	if (!mRows) return false;
+	to = std::min(to, mRows - 1);
+	// Whole blocks come from the table, the rows at the edges are checked one by one
+	size_t i = from;
+	while (i <= to) {
+		if (i % RUN_LOG_VIEW_BLOCK == 0 && i + RUN_LOG_VIEW_BLOCK - 1 <= to) {
+			const PowerBlock &block = mPowerTable[i / RUN_LOG_VIEW_BLOCK];
+			minPositive = std::min(minPositive, block.minPositive);
+			max = std::max(max, block.max);
+			hasZero = hasZero || block.nonPositive;
+			i += RUN_LOG_VIEW_BLOCK;
+		}
+		else {
+			if (mPower[i] > 0.) minPositive = std::min(minPositive, mPower[i]);
+			else hasZero = true;
+			max = std::max(max, mPower[i]);
+			i++;
+		}
+	}
+	if (max <= 0.) return false;
+	low = (int)floor(log10(minPositive));
+	high = (int)floor(log10(max)) + 1;
+	return true;
+}
+
+bool RunLogView::findPulse(Pulse &pulse) const
+{
+	if (mRows < 3) return false;
+	const size_t peak = std::max_element(mPower, mPower + mRows) - mPower;
+	// The pulse starts where the power was still three orders lower
+	size_t start = peak;
+	while (start > 0 && mPower[start] > mPower[peak] * 1e-3) start--;
+	// A slow rise to power is not a pulse
+	if (mPower[start] > mPower[peak] * 1e-3 || peak == start || mTime[peak] - mTime[start] > 1.) return false;
+
+	pulse = Pulse();
+	pulse.startIndex = start;
+	pulse.peakPower = mPower[peak];
+	pulse.timeAtMax = mTime[peak];
+
+	// Width at half of the peak
+	size_t left = peak, right = peak;
+	while (left > start && mPower[left - 1] >= pulse.peakPower / 2.) left--;
+	while (right + 1 < mRows && mPower[right + 1] >= pulse.peakPower / 2.) right++;
+	pulse.FWHM = mTime[right] - mTime[left];
+
+	// Energy and fuel temperature over the five seconds the pulse tab shows
+	const double endTime = mTime[start] + 5.;
+	for (size_t i = start; i < mRows && mTime[i] <= endTime; i++) {
+		if (i > start) pulse.releasedEnergy += (mPower[i] + mPower[i - 1]) / 2. * (mTime[i] - mTime[i - 1]);
+		pulse.maxFuelTemp = std::max(pulse.maxFuelTemp, (double)mTemperature[i]);
+	}
+	return true;
+}
+
+bool RunLogView::fail(const std::string &message)
+{
+	close();
+	mError = message;
+	return false;
+}
@@ -0,0 +1,209 @@
+#include <Scenario.h>
+#include <Simulator.h>
+#include <coro.h>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <cmath>
+
+struct Scenario::Context {
+	coro_context caller;
+	coro_context own;
+	coro_stack stack;
+};
+
+Scenario::Scenario(const std::string &name, Simulator &simulator, ScenarioBody body)
+	: simulator(simulator), context(new Context), name(name), body(std::move(body))
+{
+	if (!coro_stack_alloc(&context->stack, SCENARIO_STACK_SIZE / sizeof(void*)))
+		throw std::runtime_error("could not allocate the stack of scenario " + name);
+	// An empty context stores where resume was called from
+	coro_create(&context->caller, nullptr, nullptr, nullptr, 0);
+	coro_create(&context->own, run, this, context->stack.sptr, context->stack.ssze);
+}
+
+Scenario::~Scenario()
+{
+	// Unwind the body, so its locals are destroyed
+	if (started && !finished) {
+		stopping = true;
+		resume();
+	}
+	coro_destroy(&context->own);
+	coro_destroy(&context->caller);
+	coro_stack_free(&context->stack);
+}
+
+void Scenario::run(void* argument)
+{
+	Scenario &scenario = *(Scenario*)argument;
+	try {
+		scenario.body(scenario);
+		std::cout << "Scenario " << scenario.name << " finished" << std::endl;
+	}
+	catch (ScenarioStopped&) {
+		std::cout << "Scenario " << scenario.name << " stopped" << std::endl;
+	}
+	catch (std::exception &e) {
+		std::cerr << "Scenario " << scenario.name << " failed: " << e.what() << std::endl;
+	}
+	scenario.finished = true;
+	scenario.condition = nullptr;
+	// A coroutine must never return
+	while (true) coro_transfer(&scenario.context->own, &scenario.context->caller);
+}
+
+void Scenario::resume()
+{
+	started = running = true;
+	coro_transfer(&context->caller, &context->own);
+	running = false;
+}
+
+void Scenario::yield()
+{
+	if (!running) throw std::logic_error("scenario " + name + " can only wait in its own body");
+	if (stopping) throw ScenarioStopped();
+	coro_transfer(&context->own, &context->caller);
+	if (stopping) throw ScenarioStopped();
+}
+
+void Scenario::sleep(double seconds)
+{
+	// At least until the next step
+	const double steps = std::min(std::round(seconds / DT_STEP), 1e15);
+	wakeStep = simulator.getTotalIterations() + (steps >= 1. ? (size_t)steps : 1);
+	yield();
+}
+
+void Scenario::await(std::function<bool()> until)
+{
+	if (until()) return;
+	condition = std::move(until);
+	yield();
+	condition = nullptr;
+}
+
+void Scenario::awaitPulse()
+{
+	const size_t pulses = simulator.getPulsesFinished();
+	await([this, pulses] { return simulator.getPulsesFinished() > pulses; });
+}
+
+
+void ScenarioScheduler::start(const std::string &name, Simulator &simulator, ScenarioBody body)
+{
+	scenarios.emplace_back(new Scenario(name, simulator, std::move(body)));
+	// It begins before the next step
+	nextWake = 0;
+}
+
+void ScenarioScheduler::clear()
+{
+	scenarios.clear();
+	nextWake = SIZE_MAX;
+	awaiting = 0;
+}
+
+void ScenarioScheduler::shift(int64_t steps)
+{
+	for (auto &scenario : scenarios) {
+		if (!scenario->condition) scenario->wakeStep = (size_t)std::max((int64_t)0, (int64_t)scenario->wakeStep + steps);
+	}
+	nextWake = 0;
+}
+
+Scenario* ScenarioScheduler::next(size_t step)
+{
+	scenarios.erase(std::remove_if(scenarios.begin(), scenarios.end(),
+		[](const std::unique_ptr<Scenario> &scenario) { return scenario->isFinished(); }), scenarios.end());
+	for (auto &scenario : scenarios) {
+		if (scenario->due(step)) return scenario.get();
+	}
+	// All of them wait, until the earliest wake-up only the conditions are checked
+	nextWake = SIZE_MAX;
+	awaiting = 0;
+	for (auto &scenario : scenarios) {
+		if (scenario->condition) awaiting++;
+		else nextWake = std::min(nextWake, scenario->wakeStep);
+	}
+	return nullptr;
+}
+
+
+namespace {
+	// Time for the power to settle after a rod was moved, in seconds
+	const double approachSettleTime = 60.;
+
+	/* Withdraws the regulating rod with the source inserted, like the first start-up of a core.
+	After each move the power settles to the subcritical multiplication M of the source, the
+	inverse 1/M falls towards zero at the critical position, which is extrapolated from the last
+	two positions. Every move goes half of the way there. */
+	void approachToCriticality(Scenario &scenario)
+	{
+		Simulator &reactor = scenario.simulator;
+		ControlRod* rod = reactor.regulatingRod();
+		const size_t top = *rod->getRodSteps();
+		reactor.setNeutronSourceInserted(true);
+		rod->setEnabled(true);
+		if (!*rod->isEnabled()) {
+			std::cerr << "approachToCriticality: the " << rod->getRodName() << " rod has to be down and in the manual mode" << std::endl;
+			return;
+		}
+		auto settle = [&](size_t position) {
+			rod->commandMove(position);
+			scenario.await([&] { return rod->getPosition() == position || reactor.getScramStatus(); });
+			scenario.sleep(approachSettleTime);
+		};
+
+		settle(rod->getPosition());
+		const double reference = reactor.getCurrentPower();
+		size_t position = rod->getPosition(), previous = position;
+		double previousInverse = 1.;
+		std::cout << "Approach to criticality with the " << rod->getRodName() << " rod" << std::endl << "Position\t1/M\tCritical" << std::endl;
+		while (!reactor.getScramStatus()) {
+			const double inverse = reference / reactor.getCurrentPower();
+			size_t next = position + std::max(top / 10, (size_t)1);
+			if (position > previous && inverse < previousInverse) {
+				const double critical = position + inverse * (position - previous) / (previousInverse - inverse);
+				std::cout << position << "\t" << inverse << "\t" << critical << std::endl;
+				if (critical - position < 2. || inverse < 0.02) {
+					std::cout << "The reactor is critical at about " << std::min(critical, (double)top) << " steps" << std::endl;
+					return;
+				}
+				next = std::min(next, position + std::max((size_t)((critical - position) / 2.), (size_t)1));
+			}
+			else {
+				std::cout << position << "\t" << inverse << std::endl;
+			}
+			if (position >= top) {
+				std::cout << "The " << rod->getRodName() << " rod is out and the reactor is still subcritical" << std::endl;
+				return;
+			}
+			previous = position;
+			previousInverse = inverse;
+			position = std::min(next, top);
+			settle(position);
+		}
+		std::cout << "The approach to criticality was stopped by a SCRAM" << std::endl;
+	}
+
+	const std::pair<const char*, void(*)(Scenario&)> scenarioTable[] = {
+		{ "approachToCriticality", approachToCriticality }
+	};
+}
+
+ScenarioBody findScenario(const std::string &name)
+{
+	for (const auto &scenario : scenarioTable) {
+		if (name == scenario.first) return scenario.second;
+	}
+	return nullptr;
+}
+
+std::vector<std::string> scenarioNames()
+{
+	std::vector<std::string> names;
+	for (const auto &scenario : scenarioTable) names.push_back(scenario.first);
+	return names;
+}
@@ -1,25 +1,149 @@
 #include <ScriptCommand.h>
+#include <Scenario.h>
+#include <unordered_map>
+#include <cstdlib>
+#include <cmath>
+
+namespace {
+	// Names of the choices, in the order of ControlRod::OperationModes and Simulator::ExportThinning
+	const char* simulationModes[] = { "Manual", "Simulation", "Automatic", "Pulse", nullptr };
+	const char* dataLogModes[] = { "Division", "LTTB", "MinMax", nullptr };
+
+	struct CommandInfo {
+		const char* name;
+		Operand operand;
+		const char** choices;
+	};
+
+	// In the order of the commands enum
+	const CommandInfo commandTable[unknownCommand] = {
+		{ "setRegulatingRod", Operand::Steps, nullptr },
+		{ "moveRegulatingRod", Operand::Move, nullptr },
+		{ "setShimRod", Operand::Steps, nullptr },
+		{ "setSafetyRod", Operand::Steps, nullptr },
+		{ "setStablePower", Operand::Positive, nullptr },
+		{ "setAlpha0", Operand::Number, nullptr },
+		{ "setAlphaAtT1", Operand::Number, nullptr },
+		{ "setAlphaT1", Operand::Number, nullptr },
+		{ "setAlphaK", Operand::Number, nullptr },
+		{ "saveToFile", Operand::Text, nullptr },
+		{ "exitSimulator", Operand::None, nullptr },
+		{ "setSimulationSpeed", Operand::NonNegative, nullptr },
+		{ "setSimulationMode", Operand::Choice, simulationModes },
+		{ "holdPower", Operand::Positive, nullptr },
+		{ "firePulse", Operand::None, nullptr },
+		{ "setDataLogDivider", Operand::Count, nullptr },
+		{ "setRegulatingSteps", Operand::Steps, nullptr },
+		{ "setCvCoeffC", Operand::Number, nullptr },
+		{ "setCvCoeffPropA", Operand::Number, nullptr },
+		{ "setCvCoeffPropB", Operand::Number, nullptr },
+		{ "setDataLogPoints", Operand::Number, nullptr },
+		{ "setDataLogMode", Operand::Choice, dataLogModes },
+		{ "startTelemetry", Operand::Port, nullptr },
+		{ "stopTelemetry", Operand::None, nullptr },
+		{ "startRemoteControl", Operand::Port, nullptr },
+		{ "stopRemoteControl", Operand::None, nullptr },
+		{ "saveCheckpoint", Operand::Text, nullptr },
+		{ "loadCheckpoint", Operand::Text, nullptr },
+		{ "saveJournal", Operand::Text, nullptr },
+		{ "runScenario", Operand::Text, nullptr }
+	};
+	static_assert(sizeof(commandTable) / sizeof(commandTable[0]) == unknownCommand, "Every command needs an entry in commandTable");
+}
+
+bool parseCommandNumber(const std::string &text, double &value) {
+	if (text.empty()) return false;
+	char* end;
+	value = strtod(text.c_str(), &end);
+	return *end == '\0' && std::isfinite(value);
+}
 
 commands hashit(std::string const& strCommand) {
-	if (strCommand == "setRegulatingRod") return setRegulatingRod;
-	if (strCommand == "moveRegulatingRod") return moveRegulatingRod;
-	if (strCommand == "setShimRod") return setShimRod;
-	if (strCommand == "setSafetyRod") return setSafetyRod;
-	if (strCommand == "setStablePower") return setStablePower;
-	if (strCommand == "setAlpha0") return setAlpha0;
-	if (strCommand == "setAlphaAtT1") return setAlphaAtT1;
-	if (strCommand == "setAlphaT1") return setAlphaT1;
-	if (strCommand == "setAlphaK") return setAlphaK;
-	if (strCommand == "saveToFile") return saveToFile;
-	if (strCommand == "exitSimulator") return exitSimulator;
-	if (strCommand == "setSimulationSpeed") return setSimulationSpeed;
-	if (strCommand == "setSimulationMode") return setSimulationMode;
-	if (strCommand == "holdPower") return holdPower;
-	if (strCommand == "firePulse") return firePulse;
-	if (strCommand == "setDataLogDivider") return setDataLogDivider;
-	if (strCommand == "setRegulatingSteps") return setRegulatingSteps;
-	if (strCommand == "setCvCoeffPropA") return setCvCoeffPropA;
-	if (strCommand == "setCvCoeffPropB") return setCvCoeffPropB;
+	static const std::unordered_map<std::string, commands> names = [] {
+		std::unordered_map<std::string, commands> map;
+		for (int i = 0; i < unknownCommand; i++) map[commandTable[i].name] = (commands)i;
+		return map;
+	}();
+	auto found = names.find(strCommand);
+	return found != names.end() ? found->second : unknownCommand;
+}
+
+Operand commandOperand(commands command) {
+	return command < unknownCommand ? commandTable[command].operand : Operand::None;
+}
+
+bool compileCommand(const std::string &name, const std::string &value, Command &command, std::string &error) {
+	command.strCommand = name;
+	command.command = hashit(name);
+	command.value = value;
+	command.number = 0.;
+	if (command.command == unknownCommand) {
+		error = "unknown command " + name;
+		return false;
+	}
+	if (command.command == setCvCoeffC) {
+		error = "setCvCoeffC is not supported, the heat capacity is set with setCvCoeffPropA and setCvCoeffPropB";
+		return false;
+	}
+
+	const Operand operand = commandTable[command.command].operand;
+	const char** choices = commandTable[command.command].choices;
+	double &number = command.number;
+	switch (operand) {
+	case Operand::None:
+		return true;
+	case Operand::Choice:
+		for (int i = 0; choices[i]; i++) {
+			if (value == choices[i]) {
+				number = i;
+				return true;
+			}
+		}
+		error = name + " needs one of";
+		for (int i = 0; choices[i]; i++) error += std::string(" ") + choices[i];
+		error += ", not \"" + value + "\"";
+		return false;
+	case Operand::Text:
+		if (command.command == runScenario && !findScenario(value)) {
+			error = "there is no scenario \"" + value + "\", the scenarios are";
+			for (const std::string &scenario : scenarioNames()) error += " " + scenario;
+			return false;
+		}
+		if (!value.empty()) return true;
+		error = name + " needs a file name";
+		return false;
+	default:
+		if (parseCommandNumber(value, number) && operandValid(operand, number)) return true;
+		error = name + " needs " + operandDescription(operand) + ", not \"" + value + "\"";
+		return false;
+	}
+}
+
+bool operandValid(Operand operand, double number) {
+	switch (operand) {
+	case Operand::Number: return true;
+	case Operand::Positive: return number > 0.;
+	case Operand::NonNegative: return number >= 0.;
+	case Operand::Count: return number == std::floor(number) && number >= 1.;
+	case Operand::Steps: return number == std::floor(number) && number >= 0.;
+	case Operand::Move: return number == std::floor(number);
+	case Operand::Port: return number == std::floor(number) && number >= 0. && number < 65536.;
+	default: return false;
+	}
+}
+
+const char* operandDescription(Operand operand) {
+	switch (operand) {
+	case Operand::Number: return "a number";
+	case Operand::Positive: return "a positive number";
+	case Operand::NonNegative: return "a number that isn't negative";
+	case Operand::Count: return "a whole number from 1 up";
+	case Operand::Steps: case Operand::Move: return "a whole number of steps";
+	case Operand::Port: return "a port number (0 for the default port)";
+	case Operand::Choice: return "the name of a mode";
+	case Operand::Text: return "a file name";
+	default: return "no value";
+	}
 }
 
 
@@ -30,11 +154,11 @@ bool compareByTime(const Command& a, const Command& b) {
 std::istream& operator>>(std::istream& is, Command& p)
 {
 	Command c;
-	std::string timestr;
+	std::string error;
 	if (is >> c.timed >> c.strCommand >> c.value)
-	{ 
-		c.command = hashit(c.strCommand);
-		p = c;
+	{
+		if (compileCommand(c.strCommand, c.value, c, error)) p = c;
+		else is.setstate(std::ios::failbit);
 	}
 
 	return is;
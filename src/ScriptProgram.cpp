@@ -0,0 +1,352 @@
+#include <ScriptProgram.h>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+	const char* signalNames[(int)ScriptSignal::Count] = {
+		"time", "scriptTime", "power", "period", "reactivity", "temperature",
+		"waterTemperature", "waterLevel", "regulatingRod", "shimRod", "safetyRod", "scram"
+	};
+
+	struct Unit {
+		const char* name;
+		double factor;
+	};
+	const Unit units[] = {
+		{ "W", 1. }, { "kW", 1e3 }, { "MW", 1e6 }, { "GW", 1e9 },
+		{ "ms", 1e-3 }, { "s", 1. }, { "min", 60. }, { "h", 3600. },
+		{ "pcm", 1. }
+	};
+
+	const char* keywords[] = { "wait", "until", "if", "else", "end", "while", "repeat", "and", "or", "not" };
+
+	bool isReserved(const std::string &name) {
+		for (const char* keyword : keywords) {
+			if (name == keyword) return true;
+		}
+		for (const char* signal : signalNames) {
+			if (name == signal) return true;
+		}
+		for (const Unit &unit : units) {
+			if (name == unit.name) return true;
+		}
+		return hashit(name) != unknownCommand;
+	}
+
+	// Recursive descent over the text of an expression, the ops come out in postfix order
+	class ExpressionCompiler {
+	public:
+		ExpressionCompiler(const std::string &text, const std::vector<std::string> &variables)
+			: mText(text), mVariables(variables) {}
+
+		bool compile(ScriptExpression &expression, std::string &error) {
+			bool valid = orExpression();
+			skipSpace();
+			if (valid && mAt < mText.size()) valid = fail("unexpected \"" + mText.substr(mAt) + "\"");
+			if (!valid) {
+				error = mError;
+				return false;
+			}
+			// The stack the evaluation needs
+			size_t depth = 0, deepest = 0;
+			for (const ScriptOp &op : mOps) {
+				if (op.code == ScriptOp::Constant || op.code == ScriptOp::Variable || op.code == ScriptOp::Signal) deepest = std::max(deepest, ++depth);
+				else if (op.code != ScriptOp::Negate && op.code != ScriptOp::Not) depth--;
+			}
+			if (deepest > SCRIPT_STACK_SIZE) {
+				error = "the expression is too complex";
+				return false;
+			}
+			expression = std::move(mOps);
+			return true;
+		}
+
+	private:
+		bool fail(const std::string &error) {
+			if (mError.empty()) mError = error;
+			return false;
+		}
+
+		void skipSpace() {
+			while (mAt < mText.size() && std::isspace((unsigned char)mText[mAt])) mAt++;
+		}
+
+		// Consumes the operator if it is next
+		bool accept(const char* op) {
+			skipSpace();
+			const size_t length = strlen(op);
+			if (mText.compare(mAt, length, op) != 0) return false;
+			// Words have to end there
+			if (std::isalpha((unsigned char)op[0]) && mAt + length < mText.size() && (std::isalnum((unsigned char)mText[mAt + length]) || mText[mAt + length] == '_')) return false;
+			// < is not the start of <=
+			if ((op[0] == '<' || op[0] == '>' || op[0] == '!' || op[0] == '=') && length == 1 && mAt + 1 < mText.size() && mText[mAt + 1] == '=') return false;
+			mAt += length;
+			return true;
+		}
+
+		std::string word() {
+			skipSpace();
+			size_t end = mAt;
+			while (end < mText.size() && (std::isalnum((unsigned char)mText[end]) || mText[end] == '_')) end++;
+			return mText.substr(mAt, end - mAt);
+		}
+
+		void emit(ScriptOp::Code code, std::uint32_t index = 0, double value = 0.) {
+			mOps.push_back(ScriptOp{ code, index, value });
+		}
+
+		bool orExpression() {
+			if (!andExpression()) return false;
+			while (accept("or") || accept("||")) {
+				if (!andExpression()) return false;
+				emit(ScriptOp::Or);
+			}
+			return true;
+		}
+
+		bool andExpression() {
+			if (!comparison()) return false;
+			while (accept("and") || accept("&&")) {
+				if (!comparison()) return false;
+				emit(ScriptOp::And);
+			}
+			return true;
+		}
+
+		bool comparison() {
+			if (!sum()) return false;
+			const struct { const char* op; ScriptOp::Code code; } comparisons[] = {
+				{ "<=", ScriptOp::LessEqual }, { ">=", ScriptOp::GreaterEqual }, { "==", ScriptOp::Equal },
+				{ "!=", ScriptOp::NotEqual }, { "<", ScriptOp::Less }, { ">", ScriptOp::Greater }
+			};
+			for (const auto &comparison : comparisons) {
+				if (accept(comparison.op)) {
+					if (!sum()) return false;
+					emit(comparison.code);
+					return true;
+				}
+			}
+			return true;
+		}
+
+		bool sum() {
+			if (!product()) return false;
+			while (true) {
+				const bool add = accept("+");
+				if (!add && !accept("-")) return true;
+				if (!product()) return false;
+				emit(add ? ScriptOp::Add : ScriptOp::Subtract);
+			}
+		}
+
+		bool product() {
+			if (!unary()) return false;
+			while (true) {
+				const bool multiply = accept("*");
+				if (!multiply && !accept("/")) return true;
+				if (!unary()) return false;
+				emit(multiply ? ScriptOp::Multiply : ScriptOp::Divide);
+			}
+		}
+
+		bool unary() {
+			if (accept("-")) {
+				if (!unary()) return false;
+				emit(ScriptOp::Negate);
+				return true;
+			}
+			if (accept("not") || accept("!")) {
+				if (!unary()) return false;
+				emit(ScriptOp::Not);
+				return true;
+			}
+			return primary();
+		}
+
+		bool primary() {
+			skipSpace();
+			if (mAt >= mText.size()) return fail("the expression ends too soon");
+			if (accept("(")) {
+				if (!orExpression()) return false;
+				return accept(")") || fail("a ) is missing");
+			}
+			if (std::isdigit((unsigned char)mText[mAt]) || mText[mAt] == '.') {
+				char* end;
+				double value = strtod(mText.c_str() + mAt, &end);
+				if (end == mText.c_str() + mAt) return fail("\"" + mText.substr(mAt) + "\" is not a number");
+				mAt = end - mText.c_str();
+				// An optional unit, right after the number or after a space
+				const size_t before = mAt;
+				const std::string unit = word();
+				bool found = false;
+				for (const Unit &u : units) {
+					if (unit == u.name) {
+						value *= u.factor;
+						mAt += unit.size();
+						found = true;
+					}
+				}
+				if (!found) mAt = before;
+				emit(ScriptOp::Constant, 0, value);
+				return true;
+			}
+			const std::string name = word();
+			if (name.empty()) return fail("unexpected \"" + mText.substr(mAt) + "\"");
+			mAt += name.size();
+			for (int i = 0; i < (int)ScriptSignal::Count; i++) {
+				if (name == signalNames[i]) {
+					emit(ScriptOp::Signal, i);
+					return true;
+				}
+			}
+			for (size_t i = 0; i < mVariables.size(); i++) {
+				if (name == mVariables[i]) {
+					emit(ScriptOp::Variable, (std::uint32_t)i);
+					return true;
+				}
+			}
+			return fail("unknown name " + name + ", variables have to be assigned first");
+		}
+
+		const std::string &mText;
+		const std::vector<std::string> &mVariables;
+		size_t mAt = 0;
+		ScriptExpression mOps;
+		std::string mError;
+	};
+
+	struct Block {
+		enum Kind { If, Else, While, Repeat } kind;
+		size_t line;
+		size_t start;		// first statement of a loop
+		size_t jump;		// the statement whose target is the end of the block
+		size_t counter;		// variable of a repeat
+	};
+}
+
+bool compileScript(std::istream &is, Script &script, std::string &error)
+{
+	Script compiled;
+	ScriptProgram &program = compiled.program;
+	std::vector<ScriptStatement> &statements = program.statements;
+	std::vector<Block> blocks;
+	std::string line;
+	size_t lineNumber = 0;
+	auto failAt = [&](size_t at, const std::string &reason) {
+		error = "line " + std::to_string(at) + ": " + reason;
+		return false;
+	};
+	auto expression = [&](const std::string &text, ScriptExpression &result) {
+		std::string reason;
+		if (ExpressionCompiler(text, program.variableNames).compile(result, reason)) return true;
+		return failAt(lineNumber, reason);
+	};
+	auto statement = [&](ScriptStatement::Kind kind) -> ScriptStatement& {
+		statements.push_back(ScriptStatement());
+		statements.back().kind = kind;
+		statements.back().line = lineNumber;
+		return statements.back();
+	};
+
+	while (std::getline(is, line)) {
+		lineNumber++;
+		std::istringstream words(line);
+		std::string first, second;
+		if (!(words >> first) || first[0] == '#') continue;
+		// The rest of the line after the first word
+		std::string rest;
+		std::getline(words >> std::ws, rest);
+		while (!rest.empty() && std::isspace((unsigned char)rest.back())) rest.pop_back();
+		std::istringstream(rest) >> second;
+
+		Command command;
+		if (parseCommandNumber(first, command.timed)) {
+			// A timed command, "time command value"
+			std::string name, value, extra;
+			std::istringstream(rest) >> name >> value >> extra;
+			if (command.timed < 0.) return failAt(lineNumber, "the time can't be negative");
+			if (!extra.empty()) return failAt(lineNumber, "unexpected \"" + extra + "\" after the value");
+			if (name.empty()) return failAt(lineNumber, "the command is missing");
+			if (!compileCommand(name, value, command, error)) return failAt(lineNumber, error);
+			compiled.timed.push_back(std::move(command));
+		}
+		else if (first == "wait") {
+			const bool until = second == "until";
+			ScriptStatement &wait = statement(until ? ScriptStatement::WaitUntil : ScriptStatement::Wait);
+			if (!expression(until ? rest.substr(5) : rest, wait.expression)) return false;
+		}
+		else if (first == "if" || first == "while") {
+			const bool loop = first == "while";
+			blocks.push_back(Block{ loop ? Block::While : Block::If, lineNumber, statements.size(), statements.size(), 0 });
+			if (!expression(rest, statement(ScriptStatement::JumpUnless).expression)) return false;
+		}
+		else if (first == "repeat") {
+			// counter = count, then while counter > 0 with counter = counter - 1 at the end
+			const size_t counter = program.variableNames.size();
+			ScriptStatement &assign = statement(ScriptStatement::Assign);
+			assign.variable = counter;
+			if (!expression(rest, assign.expression)) return false;
+			program.variableNames.push_back("repeat at line " + std::to_string(lineNumber));
+			blocks.push_back(Block{ Block::Repeat, lineNumber, statements.size(), statements.size(), counter });
+			ScriptStatement &check = statement(ScriptStatement::JumpUnless);
+			check.expression = { { ScriptOp::Variable, (std::uint32_t)counter, 0. }, { ScriptOp::Constant, 0, 0. }, { ScriptOp::Greater, 0, 0. } };
+		}
+		else if (first == "else") {
+			if (blocks.empty() || blocks.back().kind != Block::If) return failAt(lineNumber, "else without if");
+			if (!rest.empty()) return failAt(lineNumber, "unexpected \"" + rest + "\" after else");
+			statement(ScriptStatement::Jump);
+			statements[blocks.back().jump].target = statements.size();
+			blocks.back().kind = Block::Else;
+			blocks.back().jump = statements.size() - 1;
+		}
+		else if (first == "end") {
+			if (blocks.empty()) return failAt(lineNumber, "end without if, while or repeat");
+			if (!rest.empty()) return failAt(lineNumber, "unexpected \"" + rest + "\" after end");
+			const Block block = blocks.back();
+			blocks.pop_back();
+			if (block.kind == Block::Repeat) {
+				ScriptStatement &count = statement(ScriptStatement::Assign);
+				count.variable = block.counter;
+				count.expression = { { ScriptOp::Variable, (std::uint32_t)block.counter, 0. }, { ScriptOp::Constant, 0, 1. }, { ScriptOp::Subtract, 0, 0. } };
+			}
+			if (block.kind == Block::While || block.kind == Block::Repeat) statement(ScriptStatement::Jump).target = block.start;
+			statements[block.jump].target = statements.size();
+		}
+		else if (second == "=") {
+			if (isReserved(first) || !(std::isalpha((unsigned char)first[0]) || first[0] == '_')
+				|| std::find_if(first.begin(), first.end(), [](char c) { return !std::isalnum((unsigned char)c) && c != '_'; }) != first.end())
+				return failAt(lineNumber, first + " can't be a variable name");
+			ScriptStatement &assign = statement(ScriptStatement::Assign);
+			if (!expression(rest.substr(1), assign.expression)) return false;
+			auto found = std::find(program.variableNames.begin(), program.variableNames.end(), first);
+			assign.variable = found - program.variableNames.begin();
+			if (found == program.variableNames.end()) program.variableNames.push_back(first);
+		}
+		else {
+			// A command when the program gets to it, numeric values may be expressions
+			ScriptStatement &run = statement(ScriptStatement::Run);
+			const Operand operand = commandOperand(hashit(first));
+			double number;
+			if (operand == Operand::Choice || operand == Operand::Text || operand == Operand::None || parseCommandNumber(rest, number)) {
+				if (!compileCommand(first, rest, run.command, error)) return failAt(lineNumber, error);
+			}
+			else {
+				// 1 fits every numeric operand, the value is checked when it was evaluated
+				if (!compileCommand(first, "1", run.command, error)) return failAt(lineNumber, error);
+				if (!expression(rest, run.expression)) return false;
+				run.command.value = rest;
+			}
+		}
+	}
+	if (!blocks.empty()) return failAt(blocks.back().line, "the block is not closed with end");
+
+	script.timed.insert(script.timed.end(), compiled.timed.begin(), compiled.timed.end());
+	if (!statements.empty()) {
+		program.variables.assign(program.variableNames.size(), 0.);
+		script.program = std::move(program);
+	}
+	return true;
+}
@@ -1,32 +1,871 @@
 #include <Simulator.h>
 #include <limits>
+#include <algorithm>
 #include <cmath>
 #include <ctime>
 #include <iterator>
 #include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <Downsampling.h>
+#include <Checkpoint.h>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/deque.hpp>
 
 void Simulator::dataToFile(std::string fileName)
 {
-	ofstream logFile;
-	logFile.open(fileName + ".dat");
-	logFile << "###############################################################################################################\n";
-	time_t now = time(0);
-	struct tm *p = localtime(&now);
-	char s[100];
-	strftime(s, 100, "%c", p);
-	logFile << "#                  Research reactor simulator log " << s << "                   #\n";
-	logFile << "#Time[h:m:s:ms] Reactivity[pcm] Inserted-reactivity[pcm] Power[W] Temp[C] Xenon-conc.[g/m3] Iodine-conc.[g/m3]#\n";
-	logFile << "###############################################################################################################\n";
+	// Only the snapshot is taken here, the file is written on the exporter thread
+	DataExporter::Job job;
+	const std::string binaryExtension = RUN_LOG_EXTENSION;
+	job.binary = fileName.length() > binaryExtension.length() &&
+		fileName.compare(fileName.length() - binaryExtension.length(), binaryExtension.length(), binaryExtension) == 0;
+	job.fileName = job.binary ? fileName : fileName + ".dat";
+	job.created = time(0);
+	job.timeStep = DT_STEP * data_division;
+	if (job.binary && appliedSettings) {
+		std::ostringstream settings;
+		appliedSettings->saveArchive(settings);
+		job.settings = settings.str();
+	}
 	size_t start = getOldestIndex();
 	long len = (long)std::min(iterations_total, getDataLength());
 	size_t idx, poisonIdx;
-	for (long shift = 0L; shift < len/data_division; shift++) {
-		idx = shiftIndex(start, shift * data_division);
+
+	// Choose the samples to export, as steps from the oldest one
+	std::vector<size_t> shifts;
+	if (exportThinning == ExportThinning::Division) {
+		shifts.resize((size_t)(len / data_division));
+		for (size_t i = 0; i < shifts.size(); i++) shifts[i] = i * data_division;
+	}
+	else {
+		// Every channel that students analyse gets an equal share of the points, the history is read once for all of them
+		const size_t n = (size_t)len;
+		const size_t share = std::max(exportPoints / 3, (size_t)3);
+		auto sample = [this, start](size_t i, DownsamplePoint<3> &point) {
+			const size_t idx = shiftIndex(start, (long)i);
+			point.x = time_[idx];
+			point.y[0] = std::log10(std::max(state_vector_[0][idx], 1e-30));
+			point.y[1] = reactivity_[idx];
+			point.y[2] = temperature_[idx];
+		};
+		std::vector<std::vector<size_t>> picks;
+		if (exportThinning == ExportThinning::LTTB) downsampleLTTB<3>(n, share, sample, picks);
+		else downsampleMinMax<3>(n, share, sample, picks);
+		shifts = mergeIndices(picks);
+		job.timeStep = 0.; // rows are not evenly spaced
+	}
+
+	job.rows.resize(shifts.size());
+	for (size_t r = 0; r < shifts.size(); r++) {
+		idx = shiftIndex(start, (long)shifts[r]);
 		poisonIdx = idx / POISON_DATA_DEL_DIVISION;
-		logFile << formatTime(time_[idx]) << "\t" << reactivity_[idx] << "\t" << rodReactivity_[idx] << "\t"
-			<< powerFromNeutrons(state_vector_[0][idx]) << "\t" << temperature_[idx] << "\t" << xenon_[poisonIdx] << "\t" << iodine_[poisonIdx] << std::endl;
+		DataExporter::Row &row = job.rows[r];
+		row.time = time_[idx];
+		row.reactivity = reactivity_[idx];
+		row.rodReactivity = rodReactivity_[idx];
+		row.power = powerFromNeutrons(state_vector_[0][idx]);
+		row.temperature = temperature_[idx];
+		row.xenon = xenon_[poisonIdx];
+		row.iodine = iodine_[poisonIdx];
+	}
+	exporter.submit(std::move(job));
+}
+
+void Simulator::publishTelemetry()
+{
+	if (!telemetry.isRunning()) return;
+	if (telemetry.subscribers()) {
+		// Steps since the last call that are still in the ring buffers
+		if (telemetryStep > iterations_total) telemetryStep = iterations_total; // the simulator was reset
+		const size_t count = std::min(iterations_total - telemetryStep, getDataLength() - 1);
+		telemetryRows.resize(count * TelemetryServer::ChannelCount);
+		const size_t current = getCurrentIndex();
+		for (size_t r = 0; r < count; r++) {
+			const size_t idx = shiftIndex(current, (long)r - (long)count + 1);
+			double* row = &telemetryRows[r * TelemetryServer::ChannelCount];
+			row[TelemetryServer::Time] = time_[idx];
+			row[TelemetryServer::Power] = powerFromNeutrons(state_vector_[0][idx]);
+			row[TelemetryServer::Reactivity] = reactivity_[idx];
+			row[TelemetryServer::RodReactivity] = rodReactivity_[idx];
+			row[TelemetryServer::Temperature] = temperature_[idx];
+			row[TelemetryServer::Xenon] = xenon_[idx / POISON_DATA_DEL_DIVISION];
+			row[TelemetryServer::Iodine] = iodine_[idx / POISON_DATA_DEL_DIVISION];
+			for (int g = 0; g < 6; g++) row[TelemetryServer::Delayed1 + g] = state_vector_[g + 1][idx];
+		}
+		if (count) telemetry.publish(iterations_total - count, count, telemetryRows.data());
+
+		TelemetryState state;
+		state.time = getCurrentTime();
+		state.period = reactorPeriod;
+		state.waterTemperature = waterTemperature;
+		for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) state.rodPositions[i] = *rods[i]->getExactPosition() / (float)*rods[i]->getRodSteps();
+		state.scramStatus = (uint32_t)status;
+		telemetry.publishState(state);
+	}
+	telemetryStep = iterations_total;
+	telemetry.poll();
+}
+
+template <class Archive>
+void Simulator::serializeModel(Archive &archive)
+{
+	archive(beta_, temperature_effects, fissionPoisoning_effects,
+		power_scram_enabled, fuel_temp_scram_enabled, water_temp_scram_enabled, period_scram_enabled, water_level_scram_enabled,
+		Xe_conc, I_conc, Sigma_f, cp_const_a, cp_const_b, groupStability, totalDelayed, lambda_eff,
+		waterLevel_delta, reactor_vessel_radius, keepCurrentPower, keepSteadyPowerAt, avoidPeriodScram, steadyDeviation,
+		alpha0, alphaAtT1, alphaT1, alphaK);
+	archive(source_inserted, core_volume, beta_neutrons, delayed_decay_time, delayed_enabled, prompt_lifetime,
+		core_excess_reactivity, ns_modulation, ns_base_activity, source_mode, *source_sqw, *source_sinMode, *source_saw,
+		ns_activity_temp, waterTemperature, w_cooling, cooling_p, waterVolume, doseRate, powerHold);
+	archive(pulsing, pulse_maxP, pulse_energy, pulse_FWHM, pulse_maxT, time_at_peak, pulse_startP, autoScramAfterPulse,
+		reactorPeriod, reactorAsymPeriod, periodLimit, powerLimit, fuelTemperatureLimit, waterTemperatureLimit, waterLevelLimit,
+		periodTimer, status, tempMode, calc_performed, frames_total);
+	archive(lastPulse.peakPower, lastPulse.FWHM, lastPulse.releasedEnergy, lastPulse.maxFuelTemp, lastPulse.powerBeforeSCRAM,
+		lastPulse.pulseStartIndex, lastPulse.timeAtMax, pulsesFinished);
+	for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) archive(*rods[i]);
+	archive(reactivityMeter);
+}
+
+template <class Archive>
+void Simulator::serializeState(Archive &archive)
+{
+	serializeModel(archive);
+	archive(*powerExtremes, trailingExtreme);
+}
+
+template <class Archive>
+void Simulator::restoreModel(Archive &archive)
+{
+	size_t steps[NUMBER_OF_CONTROL_RODS];
+	float curves[NUMBER_OF_CONTROL_RODS][2];
+	for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) {
+		steps[i] = *rods[i]->getRodSteps();
+		for (int p = 0; p < 2; p++) curves[i][p] = rods[i]->getParameter(p);
+	}
+	serializeModel(archive);
+	updateReactivityMeter();
+	for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) {
+		if (steps[i] != *rods[i]->getRodSteps() || curves[i][0] != rods[i]->getParameter(0) || curves[i][1] != rods[i]->getParameter(1))
+			rods[i]->recalculateStepData();
+	}
+}
+
+template <class Archive>
+void Simulator::serializeSamples(Archive &archive, size_t first, size_t count)
+{
+	auto channel = [&](auto* data) {
+		const size_t firstPart = std::min(count, dataPoints - first);
+		archive(cereal::binary_data(data + first, firstPart * sizeof(*data)));
+		if (count > firstPart) archive(cereal::binary_data(data, (count - firstPart) * sizeof(*data)));
+	};
+	channel(time_);
+	for (int i = 0; i < 8; i++) channel(state_vector_[i]);
+	channel(reactivity_);
+	channel(rodReactivity_);
+	channel(temperature_);
+	channel(meterReactivity_);
+}
+
+bool Simulator::saveCheckpoint(const std::string &fileName, bool history)
+{
+	const std::string data = checkpointData(history);
+	std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(data.data(), data.size());
+	if (!file) {
+		cerr << "Could not write the checkpoint " << fileName << endl;
+		return false;
+	}
+	cout << "Checkpoint saved to " << fileName << " (" << data.size() / 1024 << " kB)" << endl;
+	return true;
+}
+
+std::string Simulator::checkpointData(bool history)
+{
+	std::ostringstream body(std::ios::out | std::ios::binary);
+	{
+		cereal::BinaryOutputArchive archive(body);
+		std::ostringstream settings;
+		if (appliedSettings) appliedSettings->saveArchive(settings);
+		archive(settings.str());
+		serializeState(archive);
+
+		// The history is the data buffer as it is, otherwise the last steps in order
+		const uint64_t count = std::min(iterations_total, history ? dataPoints : CHECKPOINT_TAIL_STEPS);
+		const size_t first = history ? 0 : shiftIndex(getCurrentIndex(), 1 - (long)count);
+		const uint64_t resetAge = iterations_total - std::min(resetAverage, iterations_total);
+		const uint64_t pulseAge = (getCurrentIndex() + dataPoints - pulse_start) % dataPoints;
+		archive((uint64_t)iterations_total, count, resetAge, pulseAge);
+		serializeSamples(archive, first, (size_t)count);
+		if (history) {
+			const size_t poisonPoints = (size_t)(2 * DELETE_OLD_DATA_TIME_DEFAULT + 1);
+			archive(cereal::binary_data(xenon_, poisonPoints * sizeof(float)), cereal::binary_data(iodine_, poisonPoints * sizeof(float)));
+		}
+	}
+	const std::string text = body.str();
+
+	CheckpointHeader header;
+	memcpy(header.magic, "RRCP", 4);
+	header.version = CHECKPOINT_VERSION;
+	header.flags = history ? CheckpointHistory : 0;
+	header.reserved = 0;
+	header.dataPoints = dataPoints;
+	header.timeStep = DT_STEP;
+	header.bodySize = text.size();
+	header.checksum = checkpointChecksum(text.data(), text.size());
+	return std::string((const char*)&header, sizeof(header)) + text;
+}
+
+bool Simulator::loadCheckpoint(const std::string &fileName, Settings* settings)
+{
+	std::ifstream file(fileName, std::ios::in | std::ios::binary);
+	if (!file.is_open()) {
+		cerr << "Could not open the checkpoint " << fileName << endl;
+		return false;
+	}
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return restoreCheckpoint(text, fileName, settings);
+}
+
+bool Simulator::restoreCheckpointData(const std::string &data, Settings* settings)
+{
+	return restoreCheckpoint(data, "the checkpoint data", settings);
+}
+
+bool Simulator::restoreCheckpoint(const std::string &text, const std::string &fileName, Settings* settings)
+{
+	CheckpointHeader header;
+	if (text.size() < sizeof(header)) {
+		cerr << fileName << " is not a checkpoint" << endl;
+		return false;
+	}
+	memcpy(&header, text.data(), sizeof(header));
+	if (memcmp(header.magic, "RRCP", 4) != 0 || header.version != CHECKPOINT_VERSION) {
+		cerr << fileName << " is not a checkpoint of this version" << endl;
+		return false;
+	}
+	if (header.dataPoints != dataPoints || header.timeStep != DT_STEP) {
+		cerr << fileName << " was saved by a simulator with a different time step or data length" << endl;
+		return false;
+	}
+	if (header.bodySize != text.size() - sizeof(header) || header.checksum != checkpointChecksum(text.data() + sizeof(header), text.size() - sizeof(header))) {
+		cerr << fileName << " is damaged" << endl;
+		return false;
+	}
+
+	const bool history = (header.flags & CheckpointHistory) != 0;
+	const size_t stepsBefore = iterations_total;
+	try {
+		std::istringstream body(text.substr(sizeof(header)), std::ios::in | std::ios::binary);
+		cereal::BinaryInputArchive archive(body);
+		std::string settingsText;
+		archive(settingsText);
+		if (settings && settingsText.size()) {
+			std::istringstream settingsStream(settingsText);
+			settings->restoreArchive(settingsStream);
+		}
+
+		restoreModel(archive);
+		archive(*powerExtremes, trailingExtreme);
+
+		uint64_t iterations, count, resetAge, pulseAge;
+		archive(iterations, count, resetAge, pulseAge);
+		if (count == 0 || count > dataPoints) throw std::runtime_error("invalid number of samples");
+		// The samples fill the data buffer from its start
+		serializeSamples(archive, 0, (size_t)count);
+		iterations_total = history ? (size_t)iterations : (size_t)count;
+		if (history) {
+			const size_t poisonPoints = (size_t)(2 * DELETE_OLD_DATA_TIME_DEFAULT + 1);
+			archive(cereal::binary_data(xenon_, poisonPoints * sizeof(float)), cereal::binary_data(iodine_, poisonPoints * sizeof(float)));
+		}
+		else {
+			for (size_t i = 0; i < count; i += POISON_DATA_DEL_DIVISION) {
+				xenon_[i / POISON_DATA_DEL_DIVISION] = (float)(Xe_conc / AVOGADRO_NUM * XENON_MOLAR_MASS);
+				iodine_[i / POISON_DATA_DEL_DIVISION] = (float)(I_conc / AVOGADRO_NUM * IODINE_MOLAR_MASS);
+			}
+		}
+		resetAverage = iterations_total - std::min((size_t)resetAge, iterations_total);
+		pulse_start = shiftIndex(getCurrentIndex(), -(long)std::min((size_t)pulseAge, (size_t)count - 1));
+	}
+	catch (std::exception &e) {
+		cerr << "Could not restore " << fileName << ": " << e.what() << endl;
+		return false;
+	}
+
+	// The run goes on from the restored time
+	simulatorTime = getCurrentTime();
+	frameSamples = 0;
+	telemetryStep = iterations_total;
+	remoteSchedule.clear();
+	scenarios.shift((int64_t)iterations_total - (int64_t)stepsBefore);
+	journalStart();
+	if (scramResetCallback) scramResetCallback();
+	if (status && scramCallback) scramCallback(status);
+	if (stateRestoredCallback) stateRestoredCallback();
+	cout << "Checkpoint restored from " << fileName << " at " << formatTime(getCurrentTime()) << endl;
+	return true;
+}
+
+std::string Simulator::journalSnapshot()
+{
+	std::ostringstream stream(std::ios::out | std::ios::binary);
+	{
+		cereal::BinaryOutputArchive archive(stream);
+		serializeModel(archive);
+		// pushStableState writes a sample, so the latest one is an input as well
+		const size_t i = getCurrentIndex();
+		archive(godMode, (uint64_t)iterations_total, (uint64_t)resetAverage, (uint64_t)pulse_start, time_[i]);
+		for (int g = 0; g < 8; g++) archive(state_vector_[g][i]);
+		archive(reactivity_[i], rodReactivity_[i], temperature_[i], meterReactivity_[i]);
+	}
+	return stream.str();
+}
+
+void Simulator::applySnapshot(const std::string &snapshot)
+{
+	std::istringstream stream(snapshot, std::ios::in | std::ios::binary);
+	cereal::BinaryInputArchive archive(stream);
+	restoreModel(archive);
+	uint64_t iterations, average, pulse;
+	archive(godMode, iterations, average, pulse);
+	if (iterations == 0 || pulse >= dataPoints) throw std::runtime_error("invalid step numbers");
+	iterations_total = (size_t)iterations;
+	resetAverage = (size_t)average;
+	pulse_start = (size_t)pulse;
+	const size_t i = getCurrentIndex();
+	archive(time_[i]);
+	for (int g = 0; g < 8; g++) archive(state_vector_[g][i]);
+	archive(reactivity_[i], rodReactivity_[i], temperature_[i], meterReactivity_[i]);
+}
+
+void Simulator::journalStart()
+{
+	if (!journal.isRecording()) return;
+	// Restored in the middle of a frame (script, scheduled request), the frame has to finish first
+	if (journalFrameOpen) {
+		journalRestart = true;
+		return;
+	}
+	journalMark();
+	// Unlike a checkpoint, the samples keep their place in the buffers, the poisons are recalculated at fixed indices
+	std::ostringstream stream(std::ios::out | std::ios::binary);
+	{
+		cereal::BinaryOutputArchive archive(stream);
+		std::ostringstream settings;
+		if (appliedSettings) appliedSettings->saveArchive(settings);
+		const uint64_t count = std::min(iterations_total, CHECKPOINT_TAIL_STEPS);
+		archive(settings.str(), journalBase, count);
+		serializeSamples(archive, shiftIndex(getCurrentIndex(), 1 - (long)count), (size_t)count);
+	}
+	journal.start(stream.str());
+	journalCheckStep = (iterations_total / JOURNAL_CHECK_STEPS + 1) * JOURNAL_CHECK_STEPS;
+	// The earlier keyframes belong to the replaced history
+	keyframes.clear();
+	addKeyframe();
+}
+
+void Simulator::restoreJournalStart(const std::string &state, Settings* settings)
+{
+	std::istringstream stream(state, std::ios::in | std::ios::binary);
+	cereal::BinaryInputArchive archive(stream);
+	std::string settingsText, snapshot;
+	uint64_t count;
+	archive(settingsText, snapshot, count);
+	if (settings && settingsText.size()) {
+		std::istringstream settingsStream(settingsText);
+		settings->restoreArchive(settingsStream);
+	}
+	applySnapshot(snapshot);
+	if (count == 0 || count > std::min(iterations_total, dataPoints)) throw std::runtime_error("invalid number of samples");
+	serializeSamples(archive, shiftIndex(getCurrentIndex(), 1 - (long)count), (size_t)count);
+	frameSamples = 0;
+	telemetryStep = iterations_total;
+	remoteSchedule.clear();
+	replayStepInputs.clear();
+	replayFrameInputs.clear();
+}
+
+void Simulator::journalMark()
+{
+	if (!journal.isRecording()) return;
+	journalBase = journalSnapshot();
+	journalBaseStep = iterations_total;
+}
+
+void Simulator::journalInput(JournalRecord type, const std::string &label)
+{
+	if (!journal.isRecording()) return;
+	std::string state = journalSnapshot();
+	journal.input(type, journalBaseStep, label, journalBase, state);
+	journalBase = std::move(state);
+	journalBaseStep = iterations_total;
+}
+
+void Simulator::journalFrameEnd()
+{
+	journalFrameOpen = false;
+	if (!journal.isRecording()) return;
+	if (journalRestart) {
+		journalRestart = false;
+		journalStart();
+		return;
+	}
+	// The operator's changes until the next frame are compared to this
+	journalMark();
+	if (iterations_total >= journalCheckStep) {
+		journal.check(iterations_total, checkpointChecksum(journalBase.data(), journalBase.size()));
+		journalCheckStep = (iterations_total / JOURNAL_CHECK_STEPS + 1) * JOURNAL_CHECK_STEPS;
+	}
+	if (iterations_total >= keyframeStep) addKeyframe();
+	if (journal.size() > JOURNAL_TRIM_SIZE) trimJournal();
+}
+
+void Simulator::addKeyframe()
+{
+	// journalBase was just taken, the journal continues after it
+	Keyframe keyframe;
+	keyframe.step = iterations_total;
+	keyframe.journalSize = journal.size();
+	if (keyframes.empty()) keyframeFirst = journalBase;
+	else keyframe.changes = InputJournal::diff(keyframeLast, journalBase);
+	keyframeLast = journalBase;
+	keyframes.push_back(std::move(keyframe));
+	keyframeStep = (iterations_total / REWIND_KEYFRAME_STEPS + 1) * REWIND_KEYFRAME_STEPS;
+	// Older samples were overwritten, so the times before them can't be shown or rewound to
+	while (keyframes.size() > 1 && keyframes.front().step + dataPoints <= iterations_total) {
+		InputJournal::apply(keyframeFirst, keyframes[1].changes);
+		keyframes.pop_front();
+	}
+}
+
+void Simulator::trimJournal()
+{
+	// The first keyframe that leaves half of the journal and still has the samples its start record needs in the buffers
+	size_t k = 1;
+	auto fits = [this](const Keyframe &keyframe) {
+		const size_t count = std::min(keyframe.step, CHECKPOINT_TAIL_STEPS);
+		return journal.size() - keyframe.journalSize <= JOURNAL_TRIM_SIZE / 2 && keyframe.step + dataPoints >= iterations_total + count;
+	};
+	while (k < keyframes.size() && !fits(keyframes[k])) k++;
+	if (k >= keyframes.size()) {
+		cout << "Input journal: no keyframe to keep, the journal starts again" << endl;
+		journal.setRecording(false);
+		journal.setRecording(true);
+		journalStart();
+		return;
+	}
+
+	std::string state = keyframeFirst;
+	for (size_t i = 1; i <= k; i++) InputJournal::apply(state, keyframes[i].changes);
+	const Keyframe &keyframe = keyframes[k];
+	std::ostringstream stream(std::ios::out | std::ios::binary);
+	{
+		// The same start record as journalStart would have written at the keyframe
+		cereal::BinaryOutputArchive archive(stream);
+		std::ostringstream settings;
+		if (appliedSettings) appliedSettings->saveArchive(settings);
+		const uint64_t count = std::min(keyframe.step, CHECKPOINT_TAIL_STEPS);
+		archive(settings.str(), state, count);
+		serializeSamples(archive, shiftIndex(getCurrentIndex(), 1 - (long)count - (long)(iterations_total - keyframe.step)), (size_t)count);
+	}
+	const size_t dropped = keyframe.journalSize;
+	const size_t startSize = journal.rebase(stream.str(), dropped);
+	keyframes.erase(keyframes.begin(), keyframes.begin() + k);
+	keyframeFirst = std::move(state);
+	keyframes.front().changes.clear();
+	for (Keyframe &kept : keyframes) kept.journalSize = kept.journalSize - dropped + startSize;
+	cout << "Input journal: dropped " << (dropped >> 10) << " kB before " << formatTime(keyframes.front().step * DT_STEP) << endl;
+}
+
+double Simulator::getRewindLimit() const
+{
+	if (!journal.isRecording() || keyframes.empty() || keyframes.back().journalSize > journal.size()) return -1.;
+	const size_t first = std::max(keyframes.front().step, iterations_total - std::min(iterations_total, dataPoints) + 1);
+	return time_[shiftIndex(getCurrentIndex(), -(int)(iterations_total - first))];
+}
+
+bool Simulator::rewind(double time)
+{
+	const double limit = getRewindLimit();
+	if (limit < 0. || journalFrameOpen) {
+		cerr << "Can't rewind, the inputs were not journaled" << endl;
+		return false;
+	}
+	if (time >= getCurrentTime()) return false;
+	const size_t rewoundFrom = iterations_total;
+	const size_t target = iterations_total - (getCurrentIndex() + dataPoints - getIndexFromTime(std::max(time, limit))) % dataPoints;
+	const double started = nanogui::get_seconds_since_epoch();
+
+	// The last keyframe before the target, the later ones are in the dropped future
+	size_t k = keyframes.size() - 1;
+	while (k > 0 && keyframes[k].step > target) k--;
+	std::string state = keyframeFirst;
+	for (size_t i = 1; i <= k; i++) InputJournal::apply(state, keyframes[i].changes);
+	keyframes.erase(keyframes.begin() + k + 1, keyframes.end());
+	keyframeLast = state;
+	applySnapshot(state);
+	// The extremes are found again while calculating
+	while (!powerExtremes->empty() && powerExtremes->back().when > getCurrentTime()) powerExtremes->pop_back();
+	remoteSchedule.clear();
+	replayStepInputs.clear();
+	replayFrameInputs.clear();
+	replayExact = true;
+	// The commands the scripts ran are in the journal, the ones still waiting stay for later
+	std::vector<ScheduledCommand> waiting;
+	std::vector<ScriptProgram> running;
+	ScenarioScheduler waitingScenarios;
+	std::swap(waiting, scriptCommands);
+	std::swap(running, scriptPrograms);
+	std::swap(waitingScenarios, scenarios);
+
+	// The journaled frames and inputs after the keyframe, until the target step
+	size_t position = keyframes.back().journalSize, end = position;
+	try {
+		InputJournal::Entry entry;
+		while (iterations_total < target && journal.read(position, entry)) {
+			switch (entry.type) {
+			case JournalRecord::Input:
+				replayInput(entry, false);
+				break;
+			case JournalRecord::Check:
+				break;
+			case JournalRecord::Frame: {
+				InputJournal::Entry input;
+				size_t next = position;
+				while (journal.read(next, input) && (input.type == JournalRecord::StepInput || input.type == JournalRecord::FrameInput)) {
+					(input.type == JournalRecord::StepInput ? replayStepInputs : replayFrameInputs).push_back(std::move(input));
+					position = next;
+				}
+				const size_t steps = std::min((size_t)entry.step, target - iterations_total);
+				if (steps < entry.step) {
+					// The frame ends at the target, it is journaled again as it was calculated now
+					journal.truncate(end);
+					journal.frame(steps);
+					for (const InputJournal::Entry &due : replayStepInputs) {
+						if (due.step < target) journal.record(due);
+					}
+					replayFrameInputs.clear();
+					position = journal.size();
+				}
+				mainLoop(steps);
+				takeFrameSamples();
+				solvePerFrame();
+				frames_total++;
+				replayStepInputs.clear();
+				replayFrameInputs.clear();
+				break;
+			}
+			default:
+				throw std::runtime_error("unexpected record after a keyframe");
+			}
+			end = position;
+		}
+		journal.truncate(end);
+	}
+	catch (std::exception &e) {
+		// The journal no longer matches, it starts again from wherever this got to
+		cerr << "Could not rewind to " << formatTime(time) << ": " << e.what() << endl;
+		replayStepInputs.clear();
+		replayFrameInputs.clear();
+		journal.truncate(end);
+		journalStart();
+	}
+	std::swap(waiting, scriptCommands);
+	std::swap(running, scriptPrograms);
+	std::swap(waitingScenarios, scenarios);
+	// They wait for as many steps as they still had to, from the moment they were rewound to
+	scenarios.shift((int64_t)iterations_total - (int64_t)rewoundFrom);
+
+	// The run goes on from here
+	simulatorTime = getCurrentTime();
+	frameSamples = 0;
+	telemetryStep = iterations_total;
+	keyframeStep = (iterations_total / REWIND_KEYFRAME_STEPS + 1) * REWIND_KEYFRAME_STEPS;
+	journalCheckStep = (iterations_total / JOURNAL_CHECK_STEPS + 1) * JOURNAL_CHECK_STEPS;
+	journalMark();
+	if (scramResetCallback) scramResetCallback();
+	if (status && scramCallback) scramCallback(status);
+	if (stateRestoredCallback) stateRestoredCallback();
+	cout << "Rewound to " << formatTime(getCurrentTime()) << ", calculated " << (iterations_total - keyframes.back().step)
+		<< " steps in " << (int)((nanogui::get_seconds_since_epoch() - started) * 1e3) << " ms" << endl;
+	return true;
+}
+
+bool Simulator::saveJournal(const std::string &fileName) const
+{
+	return journal.save(fileName, dataPoints, DT_STEP);
+}
+
+void Simulator::replayDiverged(uint64_t step, const std::string &where)
+{
+	// Only the first difference is worth reporting, the rest follows from it
+	if (!replayExact) return;
+	replayExact = false;
+	cerr << "Replay diverged at step " << step << " (" << formatTime(getCurrentTime()) << "), " << where << endl;
+}
+
+void Simulator::replayInput(const InputJournal::Entry &input, bool report)
+{
+	std::string state = journalSnapshot();
+	if (input.step != iterations_total || input.checksum != checkpointChecksum(state.data(), state.size()))
+		replayDiverged(input.step, "before the input of " + input.label);
+	if (!InputJournal::apply(state, input.data)) throw std::runtime_error("invalid input record");
+	applySnapshot(state);
+	replayInputs++;
+	if (report) cout << formatTime(getCurrentTime()) << "  step " << iterations_total << "  " << input.label << endl;
+}
+
+void Simulator::replayStepInputsDue()
+{
+	while (!replayStepInputs.empty() && replayStepInputs.front().step <= iterations_total) {
+		replayInput(replayStepInputs.front());
+		replayStepInputs.pop_front();
+	}
+}
+
+bool Simulator::replayJournal(const std::string &fileName, Settings* settings)
+{
+	InputJournal replay;
+	if (!replay.load(fileName, dataPoints, DT_STEP)) return false;
+	journal.setRecording(false);
+	if (replay.peek() != (int)JournalRecord::Start) {
+		cerr << fileName << " does not start with the state of the simulator" << endl;
+		return false;
+	}
+	replayExact = true;
+	replayInputs = 0;
+	size_t frames = 0, steps = 0;
+	const double started = nanogui::get_seconds_since_epoch();
+	InputJournal::Entry entry;
+	try {
+		while (replay.next(entry)) {
+			switch (entry.type) {
+			case JournalRecord::Start:
+				restoreJournalStart(entry.data, settings);
+				cout << formatTime(getCurrentTime()) << "  step " << iterations_total << "  start" << endl;
+				break;
+			case JournalRecord::Input:
+				replayInput(entry);
+				break;
+			case JournalRecord::StepInput:
+			case JournalRecord::FrameInput:
+				throw std::runtime_error("input outside of a frame");
+			case JournalRecord::Frame: {
+				// The inputs of the frame follow it, they are applied by mainLoop and solvePerFrame
+				InputJournal::Entry input;
+				while (replay.peek() == (int)JournalRecord::StepInput || replay.peek() == (int)JournalRecord::FrameInput) {
+					if (!replay.next(input)) break;
+					(input.type == JournalRecord::StepInput ? replayStepInputs : replayFrameInputs).push_back(std::move(input));
+				}
+				mainLoop((size_t)entry.step);
+				takeFrameSamples();
+				solvePerFrame();
+				frames_total++;
+				if (!replayStepInputs.empty() || !replayFrameInputs.empty()) {
+					replayDiverged(iterations_total, "inputs of the frame were not reached");
+					replayStepInputs.clear();
+					replayFrameInputs.clear();
+				}
+				frames++;
+				steps += (size_t)entry.step;
+				break;
+			}
+			case JournalRecord::Check: {
+				const std::string state = journalSnapshot();
+				if (entry.step != iterations_total || entry.checksum != checkpointChecksum(state.data(), state.size()))
+					replayDiverged(entry.step, "the state differs from the recorded one");
+				break;
+			}
+			}
+		}
+	}
+	catch (std::exception &e) {
+		cerr << "Could not replay " << fileName << ": " << e.what() << endl;
+		return false;
+	}
+	if (replay.isDamaged()) return false;
+	const double seconds = nanogui::get_seconds_since_epoch() - started;
+	cout << "Replayed " << frames << " frames, " << steps << " steps and " << replayInputs << " inputs of " << fileName
+		<< " in " << seconds << " s (" << (seconds > 0. ? steps * DT_STEP / seconds : 0.) << "x real time), "
+		<< (replayExact ? "the state matches the recording" : "the replay DIVERGED") << endl;
+	return replayExact;
+}
+
+namespace {
+	// Names of ControlRod::OperationModes, as in the setSimulationMode script command
+	const char* operationModeNames[] = { "Manual", "Simulation", "Automatic", "Pulse" };
+}
+
+void Simulator::pollRemoteControl()
+{
+	if (!remote.isRunning()) {
+		remoteSchedule.clear();
+		return;
+	}
+	remoteRequests.clear();
+	remote.poll(remoteRequests);
+	for (const RemoteRequest &request : remoteRequests) {
+		const JsonValue* step = request.params.find("step");
+		const JsonValue* time = request.params.find("time");
+		if ((step && !step->isNumber()) || (time && !time->isNumber())) {
+			remote.respondError(request, InvalidParams, "step and time must be numbers");
+			continue;
+		}
+		size_t due = iterations_total;
+		if (step) due = (size_t)std::max(step->number, 0.);
+		else if (time) due = iterations_total + (size_t)std::max(ceil((time->number - getCurrentTime()) / DT_STEP - 1e-6), 0.);
+		// Requests for a later step wait in the schedule, the rest run before the next step
+		if (due <= iterations_total) {
+			runRemoteRequest(request);
+			journalInput(JournalRecord::Input, "remote " + request.method);
+		}
+		else {
+			auto at = std::upper_bound(remoteSchedule.begin(), remoteSchedule.end(), due,
+				[](size_t step, const ScheduledRequest &scheduled) { return step < scheduled.step; });
+			remoteSchedule.insert(at, ScheduledRequest{ due, request });
+		}
+	}
+}
+
+void Simulator::runScheduledRequests()
+{
+	journalMark();
+	while (!remoteSchedule.empty() && remoteSchedule.front().step <= iterations_total) {
+		RemoteRequest request = std::move(remoteSchedule.front().request);
+		remoteSchedule.pop_front();
+		runRemoteRequest(request);
+		journalInput(JournalRecord::StepInput, "remote " + request.method);
 	}
-	logFile.close();
+}
+
+ControlRod* Simulator::remoteRod(const JsonValue &params)
+{
+	const JsonValue* rod = params.find("rod");
+	if (!rod) return regulatingRod();
+	for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) {
+		if ((rod->isNumber() && rod->number == i) || (rod->isString() && rod->string == rods[i]->getRodName())) return rods[i];
+	}
+	return nullptr;
+}
+
+std::string Simulator::remoteState()
+{
+	std::string rodStates;
+	for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) {
+		JsonWriter rod;
+		rod.add("name", rods[i]->getRodName())
+			.add("position", *rods[i]->getExactPosition())
+			.add("steps", *rods[i]->getRodSteps())
+			.add("mode", operationModeNames[rods[i]->getOperationMode()]);
+		rodStates += (i ? "," : "") + rod.str();
+	}
+	JsonWriter state;
+	state.add("step", iterations_total)
+		.add("time", getCurrentTime())
+		.add("power", getCurrentPower())
+		.add("reactivity", getCurrentReactivity())
+		.add("rodReactivity", getCurrentRodReactivity())
+		.add("fuelTemperature", getCurrentTemperature())
+		.add("waterTemperature", waterTemperature)
+		.add("period", reactorPeriod)
+		.add("speedFactor", speedFactor)
+		.add("scramStatus", status)
+		.raw("rods", "[" + rodStates + "]");
+	return state.str();
+}
+
+void Simulator::runRemoteRequest(const RemoteRequest &request)
+{
+	const std::string &method = request.method;
+	const JsonValue &params = request.params;
+	auto number = [&params](const char* name, double &value) {
+		const JsonValue* parameter = params.find(name);
+		if (!parameter || !parameter->isNumber()) return false;
+		value = parameter->number;
+		return true;
+	};
+	double value;
+	ControlRod* rod = nullptr;
+	if (method == "commandMove" || method == "commandToTop" || method == "setOperationMode") {
+		rod = remoteRod(params);
+		if (!rod) {
+			remote.respondError(request, InvalidParams, "Unknown rod");
+			return;
+		}
+	}
+
+	if (method == "getState") {
+		remote.respond(request, remoteState());
+		return;
+	}
+	else if (method == "commandMove") {
+		if (!number("position", value)) {
+			remote.respondError(request, InvalidParams, "position (in steps) is required");
+			return;
+		}
+		rod->commandMove((float)std::min(std::max(value, 0.), (double)*rod->getRodSteps()));
+	}
+	else if (method == "commandToTop") {
+		rod->commandToTop();
+	}
+	else if (method == "scram") {
+		scram(ScramSignals::User);
+	}
+	else if (method == "resetScram") {
+		scram(ScramSignals::None);
+	}
+	else if (method == "setOperationMode") {
+		const JsonValue* mode = params.find("mode");
+		int found = -1;
+		for (int m = 0; m < 4; m++) {
+			if (mode && mode->isString() && mode->string == operationModeNames[m]) found = m;
+		}
+		if (found < 0) {
+			remote.respondError(request, InvalidParams, "mode must be Manual, Simulation, Automatic or Pulse");
+			return;
+		}
+		rod->setOperationMode((ControlRod::OperationModes)found);
+	}
+	else if (method == "pushStableState") {
+		if (!number("power", value) || value <= 0.) {
+			remote.respondError(request, InvalidParams, "power (in W) must be positive");
+			return;
+		}
+		// Same as the script command, which also clears a SCRAM and puts the rod in manual mode
+		runScriptCommand(Command{ 0., "setStablePower", setStablePower, JsonWriter::number(value), value });
+	}
+	else if (method == "setSpeedFactor") {
+		if (!number("value", value) || value < 0.) {
+			remote.respondError(request, InvalidParams, "value must not be negative");
+			return;
+		}
+		setSpeedFactor(value);
+	}
+	else if (method == "command") {
+		// Any script command, e.g. for settings such as setAlpha0 or setCvCoeffPropA
+		const JsonValue* name = params.find("command");
+		const JsonValue* argument = params.find("value");
+		Command command;
+		command.timed = getCurrentTime();
+		std::string error;
+		if (!compileCommand(name && name->isString() ? name->string : "", !argument ? "0" : argument->isString() ? argument->string : argument->dump(), command, error)) {
+			remote.respondError(request, InvalidParams, error);
+			return;
+		}
+		// A client may operate the reactor, but not exit, touch files or the servers
+		const bool fileCommand = commandOperand(command.command) == Operand::Text && command.command != runScenario;
+		if (fileCommand || command.command == exitSimulator || command.command == startTelemetry || command.command == stopTelemetry
+			|| command.command == startRemoteControl || command.command == stopRemoteControl) {
+			remote.respondError(request, InvalidParams, command.strCommand + " is not available to remote clients");
+			return;
+		}
+		runScriptCommand(command);
+	}
+	else {
+		remote.respondError(request, MethodNotFound, "Method not found: " + method);
+		return;
+	}
+	remote.respond(request, JsonWriter().add("step", iterations_total).add("time", getCurrentTime()).str());
 }
 
 void Simulator::rodsToFile(std::string fileName)
@@ -72,7 +911,6 @@ void Simulator::setDemoMode()
 	
 	scram(ScramSignals::None);
 	simulatorTime += DT_STEP;
-	last_sample_number = 1;
 }
 
 void Simulator::setHighPowerDemoMode()
@@ -83,7 +921,6 @@ void Simulator::setHighPowerDemoMode()
 
 	scram(ScramSignals::None);
 	simulatorTime += DT_STEP;
-	last_sample_number = 1;
 }
 
 void Simulator::setScramEnabled(ScramSignals scramType, bool value)
@@ -139,6 +976,7 @@ Simulator::Simulator(Settings* properties)
 	time_ = new double[dataPoints];
 	reactivity_ = new float[dataPoints];
 	rodReactivity_ = new float[dataPoints];
+	meterReactivity_ = new float[dataPoints];
 
 	// Initialize the state vector
 	for (int i = 0; i < 8; i++)
@@ -157,6 +995,9 @@ Simulator::Simulator(Settings* properties)
 	source_saw = new SawTooth(SIMULATION_MODE_PERIOD_DEFAULT, 1.f);
 	source_none = new PeriodicalMode(1.f, 0.f);
 
+	// Every session is journaled from the start
+	journal.setRecording(true);
+
 	// Initialize simulator
 	reset(properties);
 	
@@ -173,6 +1014,7 @@ void Simulator::init() {
 	time_[0] = 0.;
 	reactivity_[0] = getTotalRodReactivity() + core_excess_reactivity - getTotalRodWorth();
 	rodReactivity_[0] = reactivity_[0];
+	meterReactivity_[0] = 0.f;
 	state_vector_[0][0] = -1e5 * getCurrentSourceActivity() * prompt_lifetime / rodReactivity_[0];
 	state_vector_[7][0] = state_vector_[0][0];
 	for (int i = 1; i < 7; i++) {
@@ -198,6 +1040,7 @@ void Simulator::init() {
 	pulse_start = 0;
 	time_at_peak = 0.;
 	last_sample_number = 0;
+	frameSamples = 0;
 	speedFactor = 1.;
 	calc_performed = 0;
 	iterations_total = 0;
@@ -212,11 +1055,14 @@ void Simulator::init() {
 	powerExtremes->push_back(PowerExtreme());
 
 	recalculateLambdaBetaEffective();
+	reactivityMeter.reset(state_vector_[0][0]);
 
 	iterations_total++;
 }
 
 Simulator::~Simulator() {
+	// The scenarios are unwound while the simulator is still whole
+	scenarios.clear();
 	delete time_;
 	delete reactivity_;
 	for(int i = 0; i < 8; i++)
@@ -225,6 +1071,7 @@ Simulator::~Simulator() {
 	delete iodine_;
 	delete temperature_;
 	delete rodReactivity_;
+	delete[] meterReactivity_;
 	delete powerExtremes;
 	for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) delete rods[i];
 }
@@ -234,6 +1081,7 @@ void Simulator::setAllToDefaults()
 	Settings* default_settings = new Settings();
 	setProperties(default_settings);
 	delete default_settings;
+	appliedSettings = nullptr;
 }
 
 void Simulator::reset(Settings * properties)
@@ -241,6 +1089,7 @@ void Simulator::reset(Settings * properties)
 	if (properties) { setProperties(properties); }
 	else { setAllToDefaults(); }
 	init();
+	journalStart();
 }
 
 const bool &Simulator::getNeutronSourceInserted() const
@@ -328,6 +1177,7 @@ const double &Simulator::getPromptNeutronLifetime() const
 void Simulator::setPromptNeutronLifetime(const double &value)
 {
 	prompt_lifetime = value;
+	updateReactivityMeter();
 }
 
 const double & Simulator::getExcessReactivity() const
@@ -584,6 +1434,11 @@ void Simulator::setSevereErrorCallback(const std::function<void(int)>& callback)
 	severeErrorCallback = callback;
 }
 
+void Simulator::setStateRestoredCallback(const std::function<void()>& callback)
+{
+	stateRestoredCallback = callback;
+}
+
 void Simulator::setPulseCallback(const std::function<void(PulseData)>& callback)
 {
 	pulseCallback = callback;
@@ -742,6 +1597,13 @@ void Simulator::scram(ScramSignals reason)
 			rods[i]->scramRod();
 		}
 		waterLevel_delta = 0.;
+		if (telemetry.isRunning()) {
+			TelemetryScram event;
+			event.time = getCurrentTime();
+			event.status = (uint32_t)status;
+			event.reason = (uint32_t)reason;
+			telemetry.publishScram(event);
+		}
 		if (scramCallback) scramCallback(status);
 	}
 	else {
@@ -794,14 +1656,49 @@ void Simulator::runLoop()
 		simulatorTime += processTime;
 	}
 
-	mainLoop(srt_iterations);
-	last_sample_number = srt_iterations;
-	solvePerFrame();
-	frames_total++;
+	runFrame(srt_iterations);
 	lastTime = time;
 	actualTime = time - startTime; // Maybe we will use this some time in the future, doesn't hurt fps so why not
 }
 
+void Simulator::runFrame(size_t steps)
+{
+	// What the operator and the control box changed since the last frame
+	journalInput(JournalRecord::Input, "operator");
+	pollRemoteControl();
+	journal.frame(steps);
+	journalFrameOpen = true;
+	mainLoop(steps);
+	takeFrameSamples();
+	solvePerFrame();
+	frames_total++;
+	journalFrameEnd();
+	publishTelemetry();
+	remote.flush();
+	// Frames run without the clock move the time runLoop catches up to
+	if (simulatorTime < getCurrentTime()) simulatorTime = getCurrentTime();
+}
+
+size_t Simulator::run(double seconds, size_t frameSteps, const std::function<bool(size_t)> &observer)
+{
+	const size_t steps = (size_t)std::llround(std::max(seconds, 0.) / DT_STEP);
+	size_t done = 0;
+	while (done < steps && frameSteps > 0) {
+		const size_t frame = std::min(steps - done, frameSteps);
+		runFrame(frame);
+		done += frame;
+		if (observer && !observer(frame)) break;
+	}
+	return done;
+}
+
+void Simulator::takeFrameSamples()
+{
+	// Commands in the frame may have replaced the history, only the samples since then are new
+	last_sample_number = frameSamples;
+	frameSamples = 0;
+}
+
 const float rodAutoMove = 0.001f; // how much can the control rod move at a time (raw fraction of rodSteps)[0.1%]
 void Simulator::mainLoop(size_t iterations)
 {
@@ -811,6 +1708,20 @@ void Simulator::mainLoop(size_t iterations)
 	double stationary_temperature, new_temperature;
 	for (size_t i = 0; i < iterations; i++)
 	{
+		// Remote control requests run exactly at the step they were scheduled for
+		if (!remoteSchedule.empty() && remoteSchedule.front().step <= iterations_total)
+			runScheduledRequests();
+		// Script commands at the first step of their time
+		if (!scriptCommands.empty() && scriptCommands.front().command.timed <= time_[getCurrentIndex()])
+			doScriptCommands();
+		if (!scriptPrograms.empty())
+			runScriptPrograms();
+		if (!scenarios.empty() && scenarios.due(iterations_total))
+			resumeScenarios();
+		// As do the inputs of a replayed journal
+		if (!replayStepInputs.empty() && replayStepInputs.front().step <= iterations_total)
+			replayStepInputsDue();
+
 		// Check pulse status
 		checkPulsingStatus();
 
@@ -952,6 +1863,8 @@ void Simulator::mainLoop(size_t iterations)
 
 		// Push new neutron concentrations
 		pushNewState(finalState, nextIndex);
+		meterReactivity_[nextIndex] = (float)reactivityMeter.add(finalState[0], DT_STEP);
+		frameSamples++;
 
 		waterHeatingCycle(DT_STEP);
 
@@ -978,13 +1891,22 @@ void Simulator::recalculateLambdaBetaEffective()
 		groupStability[i] = beta_neutrons[i] / (delayed_decay_time[i] * prompt_lifetime);
 		if (!delayed_enabled[i]) leftOver += groupStability[i];
 	}
+	updateReactivityMeter();
+}
+
+void Simulator::updateReactivityMeter()
+{
+	reactivityMeter.setKinetics(prompt_lifetime, beta_neutrons, delayed_decay_time, delayed_enabled);
 }
 
 const double periodK = 0.95;
 void Simulator::solvePerFrame() {
 	const size_t currentIdx = getCurrentIndex();
-	//if ()
-	doScriptCommands();
+	// Script commands of journals recorded when they ran at the end of frames
+	while (!replayFrameInputs.empty()) {
+		replayInput(replayFrameInputs.front());
+		replayFrameInputs.pop_front();
+	}
 	
 	const auto NO_AVERAGES_REACTIVITY = 700;
 	int averageValues = (int)std::min(iterations_total - resetAverage - 1, (size_t)NO_AVERAGES_REACTIVITY);
@@ -1146,6 +2068,7 @@ void Simulator::pushStableState(double power)
 	time_[newIndex] = time_[currentIndex] + DT_STEP;
 	rodReactivity_[newIndex] = getTotalRodReactivity() + core_excess_reactivity - getTotalRodWorth();
 	reactivity_[newIndex] = 0.f;
+	meterReactivity_[newIndex] = 0.f;
 	temperature_[newIndex] = stableFuelTemp;
 	
 
@@ -1159,6 +2082,9 @@ void Simulator::pushStableState(double power)
 		neuts[7] += neuts[i];
 	}
 	pushNewState(neuts, newIndex);
+	reactivityMeter.reset(neuts[0]);
+	// The history starts again with this sample
+	frameSamples = 1;
 
 	resetAverage = iterations_total;
 	iterations_total++;
@@ -1166,6 +2092,7 @@ void Simulator::pushStableState(double power)
 
 void Simulator::setProperties(Settings * nodes)
 {
+	appliedSettings = nodes;
 	source_inserted = nodes->neutronSourceInserted;
 
 	safetyRod()->setRodName(SAFETY_ROD_NAME_DEFAULT);
@@ -1210,14 +2137,13 @@ void Simulator::setProperties(Settings * nodes)
 	core_volume = nodes->coreVolume;
 	reactor_vessel_radius = nodes->vesselRadius;
 	prompt_lifetime = nodes->promptNeutronLifetime;
-	double sumBeta = 0.;
 	for (size_t i = 0; i < 6; i++) {
 		beta_neutrons[i] = nodes->betas[i];
-		if(nodes->groupsEnabled[i]) sumBeta += beta_neutrons[i];
-		setDelayedGroupDecay(i, nodes->lambdas[i]);
 		delayed_enabled[i] = nodes->groupsEnabled[i];
+		setDelayedGroupDecay(i, nodes->lambdas[i]);
 	}
-	beta_ = sumBeta;
+	// beta_, lambda_eff and the group stabilities with all the groups as they are now
+	recalculateLambdaBetaEffective();
 	waterVolume = nodes->waterVolume;
 
 	w_cooling = nodes->waterCooling;
@@ -1274,123 +2200,281 @@ void Simulator::beginPulse()
 }
 void Simulator::doScriptCommands()
 {
-	if (!scriptCommands.empty()) {
-		std::pair<double, double> coefficients;
-		scriptTimer += DT_STEP;
-		for (auto i = scriptCommands.begin(); i != scriptCommands.end(); ) {
-			if (i->timed <= getCurrentTime()) {
-				switch (i->command) {
-					size_t dest;
-					size_t position;
-					//auto coefficients = getHeatCpConstants();
-					cout << "Running action number" << i->command << " name " << i->strCommand << endl;
-				case setRegulatingRod:
-					cout << "Pushing regulating rod to position" << i->value << endl;
-					if (sscanf(i->value.c_str(), "%zu", &dest))
-						regulatingRod()->commandMove(dest);
-					break;
-				case setRegulatingSteps:
-					cout << i->strCommand << " " << i->value << endl;
-					if (sscanf(i->value.c_str(), "%zu", &dest))
-						regulatingRod()->moveRodToStep(dest);
-					break;
-				case moveRegulatingRod:
-					position = regulatingRod()->getPosition();
-					if (sscanf(i->value.c_str(), "%zu", &dest)) {
-						position += dest;
-						cout << "Pushing regulating rod to position " << position << endl;
-						regulatingRod()->commandMove(position);
-					}
-					break;
-				case setShimRod:
-					cout << "Pushing shim rod to position " << i->value << endl;
-					if (sscanf(i->value.c_str(), "%zu", &dest))
-						shimRod()->commandMove(dest);
-					break;
-				case setSafetyRod:
-					cout << "Pushing safety rod to position " << i->value << endl;
-					if (sscanf(i->value.c_str(), "%zu", &dest))
-						safetyRod()->commandMove(dest);
-					break;
-				case commands::setAlpha0:
-					cout << i->strCommand << " " << i->value << endl;
-					setAlpha0(stod(i->value));
-					break;
-				case commands::setAlphaAtT1:
-					cout << i->strCommand << " " << i->value << endl;
-					setAlphaPeak(stod(i->value));
-					break;
-				case commands::setAlphaT1:
-					cout << i->strCommand << " " << i->value << endl;
-					setAlphaTempPeak(stod(i->value));
-					break;
-				case commands::setAlphaK:
-					cout << i->strCommand << " " << i->value << endl;
-					setAlphaSlope(stod(i->value));
-					break;
-				case setStablePower:
-					cout << "Pushing stable state ..." << i->value << endl;
-					pushStableState(stod(i->value));
-					regulatingRod()->setOperationMode(ControlRod::OperationModes::Manual);
-					scram(ScramSignals::None);
-					simulatorTime += DT_STEP;
-					last_sample_number = 1;
-					break;
-				case setSimulationSpeed:
-					cout << "Setting simulation speed to: " << i->value << endl;
-					setSpeedFactor(std::stod(i->value));
-					break;
-				case setSimulationMode:
-					cout << "Setting simulation mode to: " << i->value << endl;
-					if (i->value == "Manual")
-						regulatingRod()->setOperationMode(ControlRod::OperationModes::Manual);
-					if (i->value == "Automatic")
-						regulatingRod()->setOperationMode(ControlRod::OperationModes::Automatic);
-					if (i->value == "Pulse")
-						regulatingRod()->setOperationMode(ControlRod::OperationModes::Pulse);
-					if (i->value == "Simulation")
-						regulatingRod()->setOperationMode(ControlRod::OperationModes::Simulation);
-					break;
-				case holdPower:
-					cout << "Holding power at: " << i->value << endl;
-					regulatingRod()->setOperationMode(ControlRod::OperationModes::Automatic);
-					setPowerHold(stod(i->value));
-					break;
-				case saveToFile:
-					std::cout << "Saving data to file: " << i->value << endl;
-					dataToFile(i->value);
-					break;
-				case exitSimulator:
-					std::cout << "Exiting simulator" << endl;
-					std::exit(0);
-					break;
-				case firePulse:
-					std::cout << "Fireing pulse rod" << endl;
-					beginPulse();
-					break;
-				case setDataLogDivider:
-					cout << i->strCommand << " " << i->value << endl;
-					data_division = stod(i->value);
-					break;
-				case setCvCoeffPropA:
-					coefficients = getHeatCpConstants();
-					coefficients.first = stod(i->value);
-					setHeatCpConstants(coefficients);
-					break;
-				case setCvCoeffPropB:
-					coefficients = getHeatCpConstants();
-					coefficients.second = stod(i->value);
-					setHeatCpConstants(coefficients);
+	journalMark();
+	while (!scriptCommands.empty() && scriptCommands.front().command.timed <= getCurrentTime()) {
+		std::pop_heap(scriptCommands.begin(), scriptCommands.end());
+		const Command command = std::move(scriptCommands.back().command);
+		scriptCommands.pop_back();
+		runScriptCommand(command);
+		journalInput(JournalRecord::StepInput, "script " + command.strCommand + " " + command.value);
+	}
+}
+
+void Simulator::addScriptCommand(const Command &command)
+{
+	scriptCommands.push_back(ScheduledCommand{ command, scriptOrder++ });
+	std::push_heap(scriptCommands.begin(), scriptCommands.end());
+}
+
+void Simulator::addScriptProgram(ScriptProgram program)
+{
+	program.startTime = getCurrentTime();
+	program.variables.assign(program.variableNames.size(), 0.);
+	program.next = 0;
+	program.waitTime = -1.;
+	scriptPrograms.push_back(std::move(program));
+}
+
+void Simulator::startScenario(const std::string &name, ScenarioBody body)
+{
+	scenarios.start(name, *this, std::move(body));
+}
+
+void Simulator::resumeScenarios()
+{
+	// A scenario that changed something may have released others waiting in the same step
+	while (Scenario* scenario = scenarios.next(iterations_total)) {
+		journalMark();
+		scenario->resume();
+		journalInput(JournalRecord::StepInput, "scenario " + scenario->getName());
+	}
+}
+
+double Simulator::scriptSignal(ScriptSignal signal, const ScriptProgram &program)
+{
+	switch (signal) {
+	case ScriptSignal::Time: return getCurrentTime();
+	case ScriptSignal::ScriptTime: return getCurrentTime() - program.startTime;
+	case ScriptSignal::Power: return getCurrentPower();
+	case ScriptSignal::Period: return reactorPeriod;
+	case ScriptSignal::Reactivity: return getCurrentReactivity();
+	case ScriptSignal::Temperature: return getCurrentTemperature();
+	case ScriptSignal::WaterTemperature: return waterTemperature;
+	case ScriptSignal::WaterLevel: return waterLevel_delta;
+	case ScriptSignal::RegulatingRod: return *regulatingRod()->getExactPosition();
+	case ScriptSignal::ShimRod: return *shimRod()->getExactPosition();
+	case ScriptSignal::SafetyRod: return *safetyRod()->getExactPosition();
+	case ScriptSignal::Scram: return status;
+	default: return 0.;
+	}
+}
+
+void Simulator::runScriptPrograms()
+{
+	for (size_t i = 0; i < scriptPrograms.size();) {
+		if (runScriptProgram(scriptPrograms[i])) i++;
+		else scriptPrograms.erase(scriptPrograms.begin() + i);
+	}
+}
+
+bool Simulator::runScriptProgram(ScriptProgram &program)
+{
+	auto evaluate = [this, &program](const ScriptExpression &expression) {
+		return evaluateScript(expression, program.variables.data(), [this, &program](ScriptSignal signal) { return scriptSignal(signal, program); });
+	};
+	if (program.waitTime >= 0.) {
+		if (getCurrentTime() < program.waitTime) return true;
+		program.waitTime = -1.;
+		program.next++;
+	}
+	// A loop that never waits continues in the next step
+	for (size_t budget = 0; budget < SCRIPT_STEP_BUDGET && !program.finished(); budget++) {
+		const ScriptStatement &statement = program.statements[program.next];
+		switch (statement.kind) {
+		case ScriptStatement::Run: {
+			Command command = statement.command;
+			if (!statement.expression.empty()) {
+				const Operand operand = commandOperand(command.command);
+				command.number = evaluate(statement.expression);
+				// Computed rod positions and counts fall between the whole numbers
+				if (operand == Operand::Steps || operand == Operand::Move || operand == Operand::Port || operand == Operand::Count) command.number = std::round(command.number);
+				command.value = JsonWriter::number(command.number);
+				if (!operandValid(operand, command.number)) {
+					cerr << "Script line " << statement.line << ": " << command.strCommand << " needs "
+						<< operandDescription(operand) << ", not " << command.value << endl;
+					program.next++;
 					break;
 				}
-				i = scriptCommands.erase(i);
 			}
-			else {
-				++i;
+			program.next++;
+			journalMark();
+			runScriptCommand(command);
+			journalInput(JournalRecord::StepInput, "script " + command.strCommand + " " + command.value);
+			break;
+		}
+		case ScriptStatement::Assign:
+			program.variables[statement.variable] = evaluate(statement.expression);
+			program.next++;
+			break;
+		case ScriptStatement::Wait:
+			program.waitTime = getCurrentTime() + evaluate(statement.expression);
+			if (getCurrentTime() < program.waitTime) return true;
+			program.waitTime = -1.;
+			program.next++;
+			break;
+		case ScriptStatement::WaitUntil:
+			if (evaluate(statement.expression) == 0.) return true;
+			program.next++;
+			break;
+		case ScriptStatement::JumpUnless:
+			program.next = evaluate(statement.expression) == 0. ? statement.target : program.next + 1;
+			break;
+		case ScriptStatement::Jump:
+			program.next = statement.target;
+			break;
+		}
+	}
+	return !program.finished();
+}
+
+void Simulator::runScriptCommand(const Command &command)
+{
+	// The operands were checked and converted when the script was read (compileCommand)
+	std::pair<double, double> coefficients;
+	switch (command.command) {
+	case setRegulatingRod:
+		cout << "Pushing regulating rod to position" << command.value << endl;
+		regulatingRod()->commandMove((size_t)command.number);
+		break;
+	case setRegulatingSteps:
+		cout << command.strCommand << " " << command.value << endl;
+		regulatingRod()->moveRodToStep((size_t)command.number);
+		break;
+	case moveRegulatingRod: {
+		const size_t position = (size_t)std::max(0., (double)regulatingRod()->getPosition() + command.number);
+		cout << "Pushing regulating rod to position " << position << endl;
+		regulatingRod()->commandMove(position);
+		break;
+	}
+	case setShimRod:
+		cout << "Pushing shim rod to position " << command.value << endl;
+		shimRod()->commandMove((size_t)command.number);
+		break;
+	case setSafetyRod:
+		cout << "Pushing safety rod to position " << command.value << endl;
+		safetyRod()->commandMove((size_t)command.number);
+		break;
+	case commands::setAlpha0:
+		cout << command.strCommand << " " << command.value << endl;
+		setAlpha0(command.number);
+		break;
+	case commands::setAlphaAtT1:
+		cout << command.strCommand << " " << command.value << endl;
+		setAlphaPeak(command.number);
+		break;
+	case commands::setAlphaT1:
+		cout << command.strCommand << " " << command.value << endl;
+		setAlphaTempPeak(command.number);
+		break;
+	case commands::setAlphaK:
+		cout << command.strCommand << " " << command.value << endl;
+		setAlphaSlope(command.number);
+		break;
+	case setStablePower:
+		cout << "Pushing stable state ..." << command.value << endl;
+		pushStableState(command.number);
+		regulatingRod()->setOperationMode(ControlRod::OperationModes::Manual);
+		scram(ScramSignals::None);
+		break;
+	case setSimulationSpeed:
+		cout << "Setting simulation speed to: " << command.value << endl;
+		setSpeedFactor(command.number);
+		break;
+	case setSimulationMode:
+		cout << "Setting simulation mode to: " << command.value << endl;
+		regulatingRod()->setOperationMode((ControlRod::OperationModes)(int)command.number);
+		break;
+	case holdPower:
+		cout << "Holding power at: " << command.value << endl;
+		regulatingRod()->setOperationMode(ControlRod::OperationModes::Automatic);
+		setPowerHold(command.number);
+		break;
+	case saveToFile:
+		std::cout << "Saving data to file: " << command.value << endl;
+		dataToFile(command.value);
+		break;
+	case exitSimulator:
+		std::cout << "Exiting simulator" << endl;
+		// std::exit doesn't destroy the simulator, the exports saved before have to be written first
+		exporter.finish();
+		std::exit(0);
+		break;
+	case firePulse:
+		std::cout << "Fireing pulse rod" << endl;
+		beginPulse();
+		break;
+	case setDataLogDivider:
+		cout << command.strCommand << " " << command.value << endl;
+		data_division = command.number;
+		exportThinning = ExportThinning::Division;
+		break;
+	case setDataLogPoints:
+		cout << command.strCommand << " " << command.value << endl;
+		exportPoints = (size_t)std::max(command.number, 3.);
+		if (exportThinning == ExportThinning::Division) exportThinning = ExportThinning::LTTB;
+		break;
+	case setDataLogMode:
+		cout << command.strCommand << " " << command.value << endl;
+		exportThinning = (ExportThinning)(int)command.number;
+		break;
+	case startTelemetry:
+		cout << command.strCommand << " " << command.value << endl;
+		telemetry.start(command.number > 0. ? (int)command.number : TELEMETRY_PORT_DEFAULT); // 0 for the default port
+		break;
+	case stopTelemetry:
+		cout << command.strCommand << endl;
+		telemetry.stop();
+		break;
+	case startRemoteControl:
+		cout << command.strCommand << " " << command.value << endl;
+		remote.start(command.number > 0. ? (int)command.number : REMOTE_CONTROL_PORT_DEFAULT); // 0 for the default port
+		break;
+	case stopRemoteControl:
+		cout << command.strCommand << endl;
+		remote.stop();
+		break;
+	case commands::saveCheckpoint:
+		cout << command.strCommand << " " << command.value << endl;
+		saveCheckpoint(command.value);
+		break;
+	case commands::saveJournal:
+		cout << command.strCommand << " " << command.value << endl;
+		saveJournal(command.value);
+		break;
+	case commands::runScenario:
+		cout << command.strCommand << " " << command.value << endl;
+		if (ScenarioBody body = findScenario(command.value)) startScenario(command.value, body);
+		break;
+	case commands::loadCheckpoint: {
+		cout << command.strCommand << " " << command.value << endl;
+		// The rest of the script is timed from the restored state
+		const double before = getCurrentTime();
+		if (loadCheckpoint(command.value, appliedSettings)) {
+			for (ScheduledCommand &later : scriptCommands) later.command.timed += getCurrentTime() - before;
+			for (ScriptProgram &program : scriptPrograms) {
+				program.startTime += getCurrentTime() - before;
+				if (program.waitTime >= 0.) program.waitTime += getCurrentTime() - before;
 			}
 		}
+		break;
+	}
+	case setCvCoeffPropA:
+		coefficients = getHeatCpConstants();
+		coefficients.first = command.number;
+		setHeatCpConstants(coefficients);
+		break;
+	case setCvCoeffPropB:
+		coefficients = getHeatCpConstants();
+		coefficients.second = command.number;
+		setHeatCpConstants(coefficients);
+		break;
+	case setCvCoeffC:
+	case unknownCommand:
+		cerr << "Unknown script command " << command.strCommand << endl;
+		break;
 	}
 }
+
 /*
 Processes pulse data and saves the results to a buffer called "powerExtremes
 */
@@ -1471,17 +2555,16 @@ void Simulator::checkPulsingStatus() {
 
 			//tempMode = TemperatureMode::Asymptotic; // Revert from FH to the original model
 
-			if (pulseCallback) { // Call pulse callback method if required
-				PulseData data = PulseData();
-				data.peakPower = pulse_maxP;
-				data.timeAtMax = time_at_peak;
-				data.FWHM = pulse_FWHM;
-				data.releasedEnergy = pulse_energy;
-				data.maxFuelTemp = pulse_maxT;
-				data.powerBeforeSCRAM = powerFromNeutrons(currentPower);
-				data.pulseStartIndex = pulse_start;
-				pulseCallback(data);
-			}
+			lastPulse = PulseData();
+			lastPulse.peakPower = pulse_maxP;
+			lastPulse.timeAtMax = time_at_peak;
+			lastPulse.FWHM = pulse_FWHM;
+			lastPulse.releasedEnergy = pulse_energy;
+			lastPulse.maxFuelTemp = pulse_maxT;
+			lastPulse.powerBeforeSCRAM = powerFromNeutrons(currentPower);
+			lastPulse.pulseStartIndex = pulse_start;
+			pulsesFinished++;
+			if (pulseCallback) pulseCallback(lastPulse); // Call pulse callback method if required
 		}
 	}
 }
@@ -41,7 +41,16 @@
 #include <SerialClass.h>
 #include <Settings.h>
 #include <nanogui/fileDialog.h>
+#include <nanogui/lazyupdate.h>
 #include <Icon.h>
+#include <StartupProfiler.h>
+#include <RunLogView.h>
+#include <ReferenceRun.h>
+#include <Checkpoint.h>
+#include <future>
+#include <chrono>
+#include <thread>
+#include <atomic>
 
 /* Resolution formats supported:
 *	HD 720	(1280 x 720)
@@ -109,6 +118,9 @@ using std::string;
 using std::max;
 using std::to_string;
 
+// Created during static initialization, so it also covers the time before main
+static StartupProfiler startupProfiler;
+
 class SimulatorGUI : public nanogui::Screen {
 private:
 	const string box_auth = BOX_ID;
@@ -121,8 +133,6 @@ private:
 	string saw_settingNames[6] = { "Tooth up start: ","Tooth up peak: ","Tooth up end: ","Tooth down start: ","Tooth down peak: ","Tooth down end: " };
 	double lastBoxCheck;
 	bool layoutStart = false;
-	float fpsSum = 0.f;
-	char fpsCount = 0;
 	const std::string degCelsiusUnit = std::string(utf8(0xBA).data()) + "C";
 	const std::string alpha = std::string(utf8(0x3B1).data());
 	double alphaX[3] = { 0., 0., 0. };
@@ -158,10 +168,16 @@ public:
 	Window* baseWindow;
 	RelativeGridLayout* relativeLayout; // layout for the main window
 	Label* fpsLabel;
+	FramePacer framePacer{ FRAME_RATE_DEFAULT, IDLE_FRAME_RATE_DEFAULT };
+	LazyUpdater lazyUpdates;
 	Plot* reactivityPlot;
 	Plot* rodReactivityPlot;
+	// Reactivity of the inverse kinetics meter, see ReactivityMeter.h
+	Plot* meterReactivityPlot;
 	Plot* powerPlot;
 	Plot* temperaturePlot;
+	// Reference run drawn under power, reactivity and temperature
+	Plot* referencePlots[3];
 	Plot* delayedGroups[6];
 	Plot* pulsePlots[4];
 	ToolButton* slowDown;
@@ -194,6 +210,7 @@ public:
 	IntBox<int>* graphSizeBox;
 	SliderCheckBox* curveFillBox;
 	SliderCheckBox* rodReactivityBox;
+	SliderCheckBox* meterReactivityBox;
 	FloatBox<float>* reactivityLimitBox[2];
 	FloatBox<float>* temperatureLimitBox[2];
 	FloatBox<float>* displayBox;
@@ -212,6 +229,7 @@ public:
 	FloatBox<double>* sourceActivityBox;
 	FloatBox<double>* coolingPowerBox;
 	FloatBox<double>* promptNeutronLifetimeBox;
+	Graph* alphaGraph;
 	Plot* alphaPlot;
 	const size_t sigmaPoints = 3;
 	FloatBox<float>* alpha0Box;
@@ -392,13 +410,24 @@ public:
 			fuelTemperatureScram->setBackgroundColor(Color(120, 120));
 		});
 		reactor->setPulseCallback([this](Simulator::PulseData data) {
+			// The pulse tab shows the reviewed run until the review ends
+			if (reviewing()) {
+				livePulsePerformed = true;
+				liveLastPulseData = data;
+				return;
+			}
 			// Format pulse graph
 			pulsePerformed = true;
-			pulseTimer->setEnabled(true);
-			standInCover->setVisible(false);
-
 			lastPulseData = data;
-			updatePulseTrack(true);
+			if (tabBuilt(PulseTab)) {
+				pulseTimer->setEnabled(true);
+				standInCover->setVisible(false);
+				updatePulseTrack(true);
+			}
+		});
+		// Checkpoints restore the settings as well
+		reactor->setStateRestoredCallback([this] {
+			updateSettings(false);
 		});
 		reactor->setSevereErrorCallback([this](int reason) {
 			toggleBaseWindow(false);
@@ -421,12 +450,12 @@ public:
 	}
 
 	void updatePulseTrack(bool updateData = false) {
-		if (!pulsePerformed) return;
+		if (!pulsePerformed || !tabBuilt(PulseTab)) return;
 		size_t startIdx, endIdx;
-		startIdx = reactor->getIndexFromTime(reactor->time_[lastPulseData.pulseStartIndex] + pulseTimer->value(0) * 5);
-		endIdx = reactor->getIndexFromTime(reactor->time_[lastPulseData.pulseStartIndex] + pulseTimer->value(1) * 5);
+		startIdx = shownIndexFromTime(shownTime(lastPulseData.pulseStartIndex) + pulseTimer->value(0) * 5);
+		endIdx = shownIndexFromTime(shownTime(lastPulseData.pulseStartIndex) + pulseTimer->value(1) * 5);
 
-		double timeLimits[2] = { reactor->time_[startIdx], reactor->time_[endIdx] };
+		double timeLimits[2] = { shownTime(startIdx), shownTime(endIdx) };
 		
 		for (int i = 0; i < 4; i++) {
 			pulsePlots[i]->setPlotRange(startIdx, endIdx);
@@ -444,7 +473,9 @@ public:
 				pulsePlots[i]->setLimitOverride(1, to_string((int)(pulseTimer->value(1) * 5e3)) + "ms");
 			}
 			else if (!(i % 2)) {
-				pulsePlots[i]->setLimits(timeLimits[0], timeLimits[1], std::floor(reactor->reactivity_[startIdx] / 200.) * 200, std::ceil(reactor->rodReactivity_[endIdx] / 200.) * 200);
+				const float startReactivity = reviewing() ? reviewLog.reactivity()[startIdx] : reactor->reactivity_[startIdx];
+				const float endRodReactivity = reviewing() ? reviewLog.rodReactivity()[endIdx] : reactor->rodReactivity_[endIdx];
+				pulsePlots[i]->setLimits(timeLimits[0], timeLimits[1], std::floor(startReactivity / 200.) * 200, std::ceil(endRodReactivity / 200.) * 200);
 			}
 			else {
 				pulsePlots[i]->setLimits(timeLimits[0], timeLimits[1], 0.f, updateData ? (std::ceil(lastPulseData.maxFuelTemp / 200.) * 200) : pulsePlots[i]->limits()[3]);
@@ -467,8 +498,11 @@ public:
 
 	void viewingIntervalChanged(bool firstChanged) {
 		const double timeElapsed = reactor->getCurrentTime();
-		const double range = std::min(timeElapsed, DELETE_OLD_DATA_TIME_DEFAULT);
-		if (firstChanged) {
+		const double range = reviewing() ? reviewLog.endTime() - reviewLog.startTime() : std::min(timeElapsed, DELETE_OLD_DATA_TIME_DEFAULT);
+		if (reviewing()) {
+			if (firstChanged) reviewStart = reviewLog.startTime() + displayTimeSlider->value(0) * range;
+		}
+		else if (firstChanged) {
 			viewStart = std::max(0., timeElapsed - DELETE_OLD_DATA_TIME_DEFAULT) + std::round(1000 * displayTimeSlider->value(0) * range) * 1e-3;
 			timeAtLastChange = timeElapsed;
 		}
@@ -556,14 +590,25 @@ public:
 	// Anti spaghetti machine
 	void initializeGraph() {
 		// Create a graph object
-		canvas = baseWindow->add<Graph>(4, "Main graph");
+		canvas = baseWindow->add<Graph>(7, "Main graph");
 		relativeLayout->setAnchor(canvas, RelativeGridLayout::makeAnchor(0, 0));
 		canvas->setBackgroundColor(Color(250, 255));
 		canvas->setDrawBackground(true);
 		canvas->setPadding(90.f, 25.f, properties->reactivityHardcore ? 120.f : 220.f, 50.f);
 
-		// Create and save the plots
+		// Create and save the plots, the reference is drawn first so the live data covers it
+		for (int i = 0; i < 3; i++) {
+			referencePlots[i] = canvas->addPlot(reactor->getDataLength());
+			referencePlots[i]->setEnabled(false);
+			referencePlots[i]->setPointerShown(false);
+			referencePlots[i]->setStrokeWidth(1.5f);
+			referencePlots[i]->setDrawMode(DrawMode::Smart);
+		}
+		referencePlots[0]->setColor(Color(255, 0, 0, 100));
+		referencePlots[1]->setColor(Color(0, 0, 255, 100));
+		referencePlots[2]->setColor(Color(0, 160, 0, 100));
 		rodReactivityPlot = canvas->addPlot(reactor->getDataLength(), true);
+		meterReactivityPlot = canvas->addPlot(reactor->getDataLength(), true);
 		temperaturePlot = canvas->addPlot(reactor->getDataLength(), true);
 		reactivityPlot = canvas->addPlot(reactor->getDataLength(), true);
 		powerPlot = canvas->addPlot(reactor->getDataLength(), true);
@@ -595,6 +640,13 @@ public:
 		rodReactivityPlot->setAxisPosition(GraphElement::AxisLocation::Right);
 		rodReactivityPlot->setAxisOffset(110.f);
 		rodReactivityPlot->setFill(properties->curveFill);
+		meterReactivityPlot->setEnabled(false);
+		meterReactivityPlot->setName("Reactivity meter");
+		meterReactivityPlot->setColor(Color(255, 140, 0, 255));
+		meterReactivityPlot->setPointerColor(Color(255, 140, 0, 255));
+		meterReactivityPlot->setAxisPosition(GraphElement::AxisLocation::Right);
+		meterReactivityPlot->setAxisOffset(110.f);
+		meterReactivityPlot->setFill(false);
 		powerPlot->setName("Power");
 		powerPlot->setUnits("W");
 		powerPlot->setColor(Color(255, 0, 0, 255));
@@ -627,21 +679,37 @@ public:
 		temperaturePlot->setMajorTickNumber(3);
 		temperaturePlot->setMinorTickNumber(4);
 		temperaturePlot->setFill(properties->curveFill);
-		// Link plots to data
-		reactivityPlot->setXdata(reactor->time_);
-		reactivityPlot->setYdata(reactor->reactivity_);
-		rodReactivityPlot->setXdata(reactor->time_);
-		rodReactivityPlot->setYdata(reactor->rodReactivity_);
-		powerPlot->setXdata(reactor->time_);
-		powerPlot->setYdata(reactor->state_vector_[0]);
-		powerPlot->setValueComputing([this](double* val, const size_t /*index*/) { *val = reactor->powerFromNeutrons(*val); });
-		temperaturePlot->setXdata(reactor->time_);
-		temperaturePlot->setYdata(reactor->temperature_);
+		linkMainPlots();
 		// Link plots to display interval
 		//for (size_t i = 0; i < canvas->graphNumber(); i++) {
 		//	canvas->getPlot(i)->setPlotRange(displayInterval[0], displayInterval[1]);
 		//}
 	}
+
+	// Link plots to data, either the simulator's or the reviewed run's
+	void linkMainPlots() {
+		Plot* plots[5] = { reactivityPlot, rodReactivityPlot, meterReactivityPlot, powerPlot, temperaturePlot };
+		for (Plot* plot : plots) {
+			plot->setArraySize(reviewing() ? reviewLog.size() : reactor->getDataLength());
+			plot->setXdata(reviewing() ? reviewLog.time() : reactor->time_);
+		}
+		if (reviewing()) {
+			reactivityPlot->setYdata(reviewLog.reactivity());
+			rodReactivityPlot->setYdata(reviewLog.rodReactivity());
+			meterReactivityPlot->setYdata(reviewLog.meterReactivity());
+			powerPlot->setYdata(reviewLog.power());
+			powerPlot->setValueComputing(nullptr); // logs store the power in watts
+			temperaturePlot->setYdata(reviewLog.temperature());
+		}
+		else {
+			reactivityPlot->setYdata(reactor->reactivity_);
+			rodReactivityPlot->setYdata(reactor->rodReactivity_);
+			meterReactivityPlot->setYdata(reactor->meterReactivity_);
+			powerPlot->setYdata(reactor->state_vector_[0]);
+			powerPlot->setValueComputing([this](double* val, const size_t /*index*/) { *val = reactor->powerFromNeutrons(*val); });
+			temperaturePlot->setYdata(reactor->temperature_);
+		}
+	}
 	#if defined(_WIN32)
 	vector<string> comPorts;
 	vector<string> lastCOMports;
@@ -728,7 +796,6 @@ public:
 
 		for (int i = 0; i < 4; i++) {
 			pulsePlots[i] = pulseGraph->addPlot(reactor->getDataLength(), true);
-			pulsePlots[i]->setXdata(reactor->time_);
 			pulsePlots[i]->setNumberFormatMode((i < 3) ? GraphElement::FormattingMode::Normal : GraphElement::FormattingMode::Exponential);
 			pulsePlots[i]->setDrawMode(DrawMode::Default);
 			pulsePlots[i]->setAxisShown(i > 0);
@@ -750,13 +817,10 @@ public:
 		pulsePlots[3]->setHorizontalName("Time");
 		pulsePlots[3]->setHorizontalUnits("s");
 		pulsePlots[3]->setHorizontalTextOffset(20.f);
-		pulsePlots[3]->setYdata(reactor->state_vector_[0]);
-		pulsePlots[3]->setValueComputing([this](double* val, const size_t /*index*/) { *val = reactor->powerFromNeutrons(*val); }); // convert neutrons to watts
 
 		pulsePlots[2]->setName("Reactivity");
 		pulsePlots[2]->setUnits("pcm");
 		pulsePlots[2]->setColor(Color(0, 0, 255, 255));
-		pulsePlots[2]->setYdata(reactor->reactivity_);
 		pulsePlots[2]->setAxisShown(true);
 		pulsePlots[2]->setPointerColor(Color(0, 0, 255, 255));
 		pulsePlots[2]->setMainLineShown(true);
@@ -768,12 +832,10 @@ public:
 		pulsePlots[2]->setTextOffset(60.f);
 
 		pulsePlots[0]->setColor(Color(200, 255));
-		pulsePlots[0]->setYdata(reactor->rodReactivity_);
 		pulsePlots[0]->setAxisPosition(GraphElement::AxisLocation::Right);
 		pulsePlots[0]->setAxisOffset(110.f);
 
 		pulsePlots[1]->setColor(Color(0, 255, 0, 255));
-		pulsePlots[1]->setYdata(reactor->temperature_);
 		pulsePlots[1]->setName("Temperature");
 		pulsePlots[1]->setUnits("C");
 		pulsePlots[1]->setPointerColor(Color(0, 255, 0, 255));
@@ -781,9 +843,32 @@ public:
 		pulsePlots[1]->setMainLineShown(true);
 		pulsePlots[1]->setMajorTickNumber(4);
 		pulsePlots[1]->setMinorTickNumber(4);
+		linkPulsePlots();
+	}
+
+	void linkPulsePlots() {
+		for (int i = 0; i < 4; i++) {
+			pulsePlots[i]->setArraySize(reviewing() ? reviewLog.size() : reactor->getDataLength());
+			pulsePlots[i]->setXdata(reviewing() ? reviewLog.time() : reactor->time_);
+		}
+		if (reviewing()) {
+			pulsePlots[3]->setYdata(reviewLog.power());
+			pulsePlots[3]->setValueComputing(nullptr);
+			pulsePlots[2]->setYdata(reviewLog.reactivity());
+			pulsePlots[0]->setYdata(reviewLog.rodReactivity());
+			pulsePlots[1]->setYdata(reviewLog.temperature());
+		}
+		else {
+			pulsePlots[3]->setYdata(reactor->state_vector_[0]);
+			pulsePlots[3]->setValueComputing([this](double* val, const size_t /*index*/) { *val = reactor->powerFromNeutrons(*val); }); // convert neutrons to watts
+			pulsePlots[2]->setYdata(reactor->reactivity_);
+			pulsePlots[0]->setYdata(reactor->rodReactivity_);
+			pulsePlots[1]->setYdata(reactor->temperature_);
+		}
 	}
 
 	SimulatorGUI() : nanogui::Screen(Vector2i(WINDOW_DEFAULT_WIDTH, WINDOW_DEFAULT_HEIGHT), "Research reactor simulator") {
+		startupProfiler.mark("Window, OpenGL context and theme");
 		cout << "======= Research reactor simulator " << version() << " =======" << endl;
 
 		//Load settings
@@ -806,28 +891,37 @@ public:
 		// Set minimum size
 		glfwSetWindowSizeLimits(mGLFWWindow, WINDOW_DEFAULT_WIDTH, WINDOW_DEFAULT_HEIGHT, GLFW_DONT_CARE, GLFW_DONT_CARE);
 
-		// Icon
-		GLFWimage icons[WINDOW_ICON_NUM];
-		int idx = 0;
-		for (int size = 24; size < 12*(2+WINDOW_ICON_NUM); size += 12) {
-			icons[idx].width = size;
-			icons[idx].height = size;
-			icons[idx].pixels = createPixelData(size, size);
-			idx++;
-		}
-		glfwSetWindowIcon(mGLFWWindow, WINDOW_ICON_NUM, icons);
-		
+		// Icon pixels are interpolated on a worker thread, the icon is set once they are ready
+		windowIcons = std::async(std::launch::async, []() {
+			std::vector<GLFWimage> icons(WINDOW_ICON_NUM);
+			int idx = 0;
+			for (int size = 24; size < 12 * (2 + WINDOW_ICON_NUM); size += 12) {
+				icons[idx].width = size;
+				icons[idx].height = size;
+				icons[idx].pixels = createPixelData(size, size);
+				idx++;
+			}
+			return icons;
+		});
+		startupProfiler.mark("Settings and theme setup");
 
 		// Initialize the reactor simulator
 		initializeSimulator();
+		startupProfiler.mark("Simulator");
 
 #if defined(_WIN32)
 		// Initialize THE BOX
+		// Opening a port waits for the board to reset, so the ports are probed on a worker thread
 		memset(btns, false, 11 * sizeof(bool));
-		if (!reactor->scriptCommands.size())
-			initializeSerial();
-		if (boxConnected) {
-			std::cout << "===========The Box Mk. III===========" << std::endl;
+		if (!reactor->getScriptCommandsLeft()) {
+			serialProbing = true;
+			serialProbe = std::thread([this]() {
+				initializeSerial();
+				if (boxConnected) {
+					std::cout << "===========The Box Mk. III===========" << std::endl;
+				}
+				serialProbing = false;
+			});
 		}
 #endif
 		RelativeGridLayout* baseLayout = new RelativeGridLayout();
@@ -859,6 +953,7 @@ public:
 
 		// Create the bottom panel
 		createBottomPanel();
+		startupProfiler.mark("Graph and bottom panel");
 
 		// Create a place for all the other stuff
 		tabControl = baseWindow->add<TabWidget>();
@@ -872,36 +967,44 @@ public:
 
 		// Create graph screen tab
 		createGraphSettingsTab();
+		startupProfiler.mark("Main and graph tabs");
+
+		// The remaining tabs are only built when they are first opened
+		tabBuilders.resize(tabControl->tabCount());
 
 		// Create physics settings tab
-		createPhysicsSettingsTab();
+		addLazyTab("Physics settings", false, [this](Widget* tab) { createPhysicsSettingsTab(tab); });
 
 		// Create rod settings tab
-		createRodSettingsTab();
+		addLazyTab("Control rods", true, [this](Widget* tab) { createRodSettingsTab(tab); });
 
 		//Create delayed groups tab
-		createDelayedGroupsTab();
+		addLazyTab("Delayed neutrons", true, [this](Widget* tab) { createDelayedGroupsTab(tab); });
 
 		//Create data in/out tab
 		//Widget* data_tab = tabControl->createTab("Data tab settings");
 		//data_tab->setLayout(new BoxLayout(Orientation::Vertical, Alignment::Minimum, 10, 10));
 
 		// Create operation modes tab
-		createOperationModesTab();
+		addLazyTab("Operation modes", false, [this](Widget* tab) { createOperationModesTab(tab); });
 
 		// Create operational limits and conditions tab
-		createOperationalLimitsTab();
+		addLazyTab("Operational limits", true, [this](Widget* tab) { createOperationalLimitsTab(tab); });
 
 		// Create pulse tab
-		createPulseTab();
+		addLazyTab("Pulse", true, [this](Widget* tab) { createPulseTab(tab); });
 
 		// Create other tab
-		createOtherTab();
+		addLazyTab("Other", true, [this](Widget* tab) { createOtherTab(tab); });
+
+		tabControl->setActiveTab(MainTab);
 
-		tabControl->setActiveTab(0);
+		// Per-frame updates of widgets that are not always visible
+		registerLazyUpdates();
 
 		// Create layout
 		performLayout();
+		startupProfiler.mark("Remaining tabs and layout");
 	}
 
 	// Bottom panel initialization
@@ -915,7 +1018,7 @@ public:
 		bottomLayout->appendRow(1.f);
 		bottomLayout->appendCol(RelativeGridLayout::Size(120.f, RelativeGridLayout::SizeType::Fixed));	// 0 version label
 		bottomLayout->appendCol(RelativeGridLayout::Size(1.f, RelativeGridLayout::SizeType::Fixed));	// 1 border
-		bottomLayout->appendCol(RelativeGridLayout::Size(100.f, RelativeGridLayout::SizeType::Fixed));	// 2 fps label
+		bottomLayout->appendCol(RelativeGridLayout::Size(240.f, RelativeGridLayout::SizeType::Fixed));	// 2 frame time label
 		bottomLayout->appendCol(RelativeGridLayout::Size(1.f, RelativeGridLayout::SizeType::Fixed));	// 3 border
 		bottomLayout->appendCol(1.f);																	// 4 speed label
 		bottomLayout->appendCol(RelativeGridLayout::Size(1.f, RelativeGridLayout::SizeType::Fixed));	// 5 border
@@ -940,7 +1043,7 @@ public:
 		versionLabel->setColor(Color(255, 255));
 		bottomLayout->setAnchor(versionLabel, RelativeGridLayout::makeAnchor(0, 0));
 
-		fpsLabel = bottomPanel->add<Label>("FPS: ");
+		fpsLabel = bottomPanel->add<Label>("Frame: ");
 		fpsLabel->setTextAlignment(Label::TextAlign::LEFT | Label::TextAlign::VERTICAL_CENTER);
 		fpsLabel->setFontSize(20.f);
 		fpsLabel->setColor(Color(255, 255));
@@ -1223,6 +1326,9 @@ public:
 		graphControlsLayout->appendRow(RelativeGridLayout::Size(2.f, RelativeGridLayout::SizeType::Fixed));
 		graphControlsLayout->appendRow(RelativeGridLayout::Size(30.f, RelativeGridLayout::SizeType::Fixed));
 		graphControlsLayout->appendRow(RelativeGridLayout::Size(20.f, RelativeGridLayout::SizeType::Fixed));
+		graphControlsLayout->appendRow(RelativeGridLayout::Size(45.f, RelativeGridLayout::SizeType::Fixed));
+		graphControlsLayout->appendRow(RelativeGridLayout::Size(2.f, RelativeGridLayout::SizeType::Fixed));
+		graphControlsLayout->appendRow(RelativeGridLayout::Size(40.f, RelativeGridLayout::SizeType::Fixed));
 		graphControlsLayout->appendRow(1.f);
 		graphControlsLayout->appendCol(1.f);
 		graphControlsLayout->appendCol(1.f);
@@ -1276,7 +1382,7 @@ public:
 
 		RelativeGridLayout* sliderLayout = new RelativeGridLayout();
 		for(int i = 0; i < 4; i++) sliderLayout->appendCol((i % 2) ? RelativeGridLayout::Size(10.f, RelativeGridLayout::SizeType::Fixed) : 1.f);
-		for (int i = 0; i < 4; i++) sliderLayout->appendRow(1.f);
+		for (int i = 0; i < 5; i++) sliderLayout->appendRow(1.f);
 		sliderPanel->setLayout(sliderLayout);
 
 		sliderLayout->setAnchor(sliderPanel->add<Label>("Rod reactivity plot:", "sans-bold"), RelativeGridLayout::makeAnchor(0, 0, 1, 1, Alignment::Minimum, Alignment::Middle));
@@ -1316,7 +1422,7 @@ public:
 			properties->displayTime = std::min((float)reactor->getDeleteOldValues(), std::max(a, 0.5f));
 			std::string limit = formatDecimals((double)properties->displayTime, 1) + " seconds ago";
 			powerPlot->setLimitOverride(0, limit);
-			delayedGroups[0]->setLimitOverride(0, limit);
+			if (tabBuilt(DelayedTab)) delayedGroups[0]->setLimitOverride(0, limit);
 		});
 
 		{
@@ -1411,6 +1517,15 @@ public:
 			hardcoreMode(value);
 		});
 
+		sliderLayout->setAnchor(sliderPanel->add<Label>("Reactivity meter plot:", "sans-bold"), RelativeGridLayout::makeAnchor(0, 4, 1, 1, Alignment::Minimum, Alignment::Middle));
+		meterReactivityBox = sliderPanel->add<SliderCheckBox>();
+		sliderLayout->setAnchor(meterReactivityBox, RelativeGridLayout::makeAnchor(2, 4, 1, 1, Alignment::Maximum, Alignment::Middle));
+		meterReactivityBox->setFontSize(16);
+		meterReactivityBox->setChecked(false);
+		meterReactivityBox->setCallback([this](bool value) {
+			meterReactivityPlot->setEnabled(value && !properties->reactivityHardcore);
+		});
+
 		Label* timeAdjLabel = graph_controls->add<Label>("Edit display range", "sans-bold");
 		timeAdjLabel->setFontSize(25);
 		timeAdjLabel->setPadding(0, 15);
@@ -1460,13 +1575,136 @@ public:
 		graphControlsLayout->setAnchor(displayResetBtn, acr2);
 		displayResetBtn->setCallback([this]() { // reset the view to default
 			this->viewStart = -1.;
+			this->reviewStart = -1.;
 			timeLockedBox->setChecked(false);
 			timeLockedBox->callback()(false);
 		});
+		// Go back to the end of the shown interval, drag the slider there first
+		Button* rewindBtn = new Button(graph_controls, "Resume from view end");
+		RelativeGridLayout::Anchor acr4 = RelativeGridLayout::makeAnchor(1, 4, 1, 1, Alignment::Maximum, Alignment::Middle);
+		acr4.padding = Vector4i(0, 0, 10, 0);
+		graphControlsLayout->setAnchor(rewindBtn, acr4);
+		rewindBtn->setFontSize(16);
+		rewindBtn->setFixedHeight(20);
+		rewindBtn->setCallback([this]() {
+			if (reviewing() || !reactor->rewind(reactor->time_[displayInterval[1]])) return;
+			this->viewStart = -1.;
+			timeLockedBox->setChecked(false);
+			timeLockedBox->callback()(false);
+		});
+
+		Widget* border2 = graph_controls->add<Widget>();
+		border2->setBackgroundColor(coolBlue);
+		border2->setDrawBackground(true);
+		graphControlsLayout->setAnchor(border2, RelativeGridLayout::makeAnchor(0, 6, 2, 1));
+
+		// Reference run for training exercises
+		Widget* referencePanel = graph_controls->add<Widget>();
+		RelativeGridLayout::Anchor acr3 = RelativeGridLayout::makeAnchor(0, 7, 2, 1, Alignment::Minimum, Alignment::Middle);
+		acr3.padding = Vector4i(15, 0, 0, 0);
+		graphControlsLayout->setAnchor(referencePanel, acr3);
+		referencePanel->setLayout(new BoxLayout(Orientation::Horizontal, Alignment::Middle, 0, 10));
+		referencePanel->add<Label>("Reference run:", "sans-bold");
+		Button* referenceBtn = referencePanel->add<Button>("Load");
+		referenceBtn->setFixedWidth(80);
+		Button* alignBtn = referencePanel->add<Button>("Align to now");
+		alignBtn->setEnabled(false);
+		Label* deviationLabel = referencePanel->add<Label>("", "sans");
+		referenceBtn->setCallback([this, referenceBtn, alignBtn]() {
+			if (reference.isOpen()) {
+				reference.close();
+			}
+			else {
+				toggleBaseWindow(false);
+				std::string referenceFileName = file_dialog(
+				{ { "rrl", "Binary run log" },{ "dat", "Data file" },{ "txt", "Text file" } }, false);
+				toggleBaseWindow(true);
+				if (referenceFileName.empty()) return;
+				if (!reference.open(referenceFileName, reactor->getCurrentTime())) {
+					cerr << reference.error() << endl;
+					MessageDialog* msg = new MessageDialog(this, MessageDialog::Type::Warning, "Reference run", reference.error());
+					msg->setPosition(Vector2i((this->size().x() - msg->size().x()) / 2, (this->size().y() - msg->size().y()) / 2));
+				}
+				linkReferencePlots();
+			}
+			referenceBtn->setCaption(reference.isOpen() ? "Clear" : "Load");
+			alignBtn->setEnabled(reference.isOpen());
+		});
+		alignBtn->setCallback([this]() {
+			reference.alignTo(reactor->getCurrentTime());
+		});
+		// The deviations change with every compared sample
+		lazyUpdates.add(deviationLabel, {
+			[this]() { return (double)reference.isOpen(); },
+			[this]() { return (double)reference.reactivityDeviation().samples; }
+		}, [this, deviationLabel]() {
+			if (!reference.isOpen()) {
+				deviationLabel->setCaption("");
+				return;
+			}
+			const ReferenceRun::Deviation &p = reference.powerDeviation(), &r = reference.reactivityDeviation(), &t = reference.temperatureDeviation();
+			char text[200];
+			snprintf(text, sizeof(text), "RMS (max) deviation  power: %.1f %% (%.1f %%)  reactivity: %.1f pcm (%.1f pcm)  temperature: %.1f %s (%.1f %s)",
+				p.rms(), p.max, r.rms(), r.max, t.rms(), degCelsiusUnit.c_str(), t.max, degCelsiusUnit.c_str());
+			deviationLabel->setCaption(text);
+		});
+	}
+
+	// Compares the live samples since the last frame to the reference
+	void updateReferenceDeviation() {
+		if (!reference.isOpen()) return;
+		const double now = reactor->getCurrentTime();
+		if (now < reference.lastTime()) reference.resetDeviation(); // the simulator was reset
+		if (now <= reference.lastTime()) return;
+		const size_t current = reactor->getCurrentIndex();
+		size_t idx = reactor->getIndexFromTime(std::max(reference.lastTime(), 0.));
+		if (reference.lastTime() >= 0.) idx = reactor->shiftIndex(idx, 1);
+		while (true) {
+			reference.addSample(reactor->time_[idx], reactor->powerFromNeutrons(reactor->state_vector_[0][idx]),
+				reactor->reactivity_[idx], reactor->temperature_[idx]);
+			if (idx == current) break;
+			idx = reactor->shiftIndex(idx, 1);
+		}
+	}
+
+	// Shows the part of the reference that falls into the time window of the main graph
+	void updateReferencePlots() {
+		bool shown = false;
+		size_t from = 0, to = 0;
+		if (reference.isOpen()) {
+			const RunLogView &log = reference.log();
+			const double start = reference.referenceTime(powerPlot->limits()[0]);
+			const double end = reference.referenceTime(powerPlot->limits()[1]);
+			from = log.indexFromTime(start);
+			if (from) from--;
+			to = log.indexFromTime(end);
+			shown = end > log.startTime() && start < log.endTime() && to > from;
+		}
+		Plot* live[3] = { powerPlot, reactivityPlot, temperaturePlot };
+		for (int i = 0; i < 3; i++) {
+			referencePlots[i]->setEnabled(shown && live[i]->getEnabled());
+			if (!shown) continue;
+			const double* limits = live[i]->limits();
+			referencePlots[i]->setPlotRange(from, to);
+			referencePlots[i]->setLimits(reference.referenceTime(limits[0]), reference.referenceTime(limits[1]), limits[2], limits[3]);
+			referencePlots[i]->setYlog(live[i]->getYlog());
+		}
+	}
+
+	// Link the reference plots to a newly opened reference
+	void linkReferencePlots() {
+		if (!reference.isOpen()) return;
+		const RunLogView &log = reference.log();
+		for (int i = 0; i < 3; i++) {
+			referencePlots[i]->setArraySize(log.size());
+			referencePlots[i]->setXdata(log.time());
+		}
+		referencePlots[0]->setYdata(log.power());
+		referencePlots[1]->setYdata(log.reactivity());
+		referencePlots[2]->setYdata(log.temperature());
 	}
 
-	void createPhysicsSettingsTab() {
-		Widget* physics_settings_base = tabControl->createTab("Physics settings", false);
+	void createPhysicsSettingsTab(Widget* physics_settings_base) {
 		TabWidget* modeTabs = physics_settings_base->add<TabWidget>();
 		modeTabs->header()->setStretch(true);
 		modeTabs->header()->setButtonAlignment(NVGalign::NVG_ALIGN_MIDDLE | NVGalign::NVG_ALIGN_CENTER);
@@ -1613,7 +1851,7 @@ public:
 				properties->squareWave.xIndex[sqw] = val;
 				if (sqw != 3) {
 					neutronSourceSQWBoxes[sqw + 1]->setMinValue(change);
-					if (neutronSourceSQWBoxes[sqw + 1]->value() < change) { squareWaveBoxes[sqw + 1]->setValue(change); }
+					if (neutronSourceSQWBoxes[sqw + 1]->value() < change) { neutronSourceSQWBoxes[sqw + 1]->setValue(change); }
 					else { updateNeutronSourceTab(); }
 				}
 				else {updateNeutronSourceTab();}
@@ -1852,7 +2090,7 @@ public:
 		physicsLayout->setAnchor(alphaPanel, RelativeGridLayout::makeAnchor(2, 3, 1, 1));
 		alphaPanel->setLayout(new BoxLayout(Orientation::Vertical, Alignment::Fill, 0, 10));
 		// Temperature reactivity coef.
-		Graph* alphaGraph = alphaPanel->add<Graph>(1, "Temp. reactivity coef.");
+		alphaGraph = alphaPanel->add<Graph>(1, "Temp. reactivity coef.");
 		alphaGraph->setBackgroundColor(Color(60, 255));
 		alphaGraph->setDrawBackground(true);
 		alphaGraph->setFixedHeight(250);
@@ -1943,11 +2181,25 @@ public:
 			updateAlphaGraph();
 		});
 
+		// Update alpha plot pointers while the tab is shown
+		lazyUpdates.add(alphaGraph, {
+			[this]() { return (double)reactor->getCurrentTemperature(); },
+			[this]() { return alphaPlot->limits()[2]; },
+			[this]() { return alphaPlot->limits()[3]; },
+			[this]() { return (double)properties->alpha0; },
+			[this]() { return (double)properties->alphaAtT1; },
+			[this]() { return (double)properties->alphaT1; },
+			[this]() { return properties->alphaK; }
+		}, [this]() {
+			float tempNow = reactor->getCurrentTemperature();
+			alphaPlot->setHorizontalPointerPosition(tempNow / 1000.f);
+			alphaPlot->setPointerPosition((float)((reactor->getReactivityCoefficient(tempNow) - alphaPlot->limits()[2]) / (alphaPlot->limits()[3] - alphaPlot->limits()[2])));
+		});
+
 		modeTabs->setActiveTab(0);
 	}
 
-	void createRodSettingsTab() {
-		Widget* rod_settings = tabControl->createTab("Control rods");
+	void createRodSettingsTab(Widget* rod_settings) {
 		rod_settings->setId("Rod settings tab");
 		RelativeGridLayout* rod_settings_layout = new RelativeGridLayout();									  /* COLUMNS */
 		for (int i = 0; i < 9; i++) {
@@ -2042,7 +2294,7 @@ public:
 			rodSpeedBox[i]->setCallback([useRod, i, this](float change) {
 				properties->rodSettings[i].rodSpeed = change;
 				useRod->setRodSpeed(change);
-				if(i == 1) reactor->regulatingRod()->sine()->fillXYaxis(operationModesPlots[0][1], operationModesPlots[1][1]); // Update SQW graph
+				if(i == 1 && tabBuilt(ModesTab)) reactor->regulatingRod()->sine()->fillXYaxis(operationModesPlots[0][1], operationModesPlots[1][1]); // Update SQW graph
 			});
 
 			// Display tool
@@ -2148,10 +2400,29 @@ public:
 			});
 		}
 		handleDerivativeChange();
+
+		// Update rod curve and derivative pointers while the tab is shown
+		for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) {
+			ControlRod* rod = reactor->rods[i];
+			lazyUpdates.add(rod_settings, {
+				[rod]() { return (double)*rod->getExactPosition(); },
+				[rod]() { return (double)rod->getRodWorth(); },
+				[rod]() { return (double)*rod->getRodSteps(); },
+				[this, i]() { return rodDerivatives[i]->limits()[3]; }
+			}, [this, rod, i]() {
+				rodCurves[i]->setPointerPosition(rod->getCurrentPCM() / rod->getRodWorth());
+				rodCurves[i]->setRodPosition(*rod->getExactPosition() / *rod->getRodSteps());
+				rodCurves[i]->setHorizontalPointerPosition(*rod->getExactPosition() / *rod->getRodSteps());
+
+				float pointPos = *rod->getExactPosition();
+				pointPos = (float)(rod->derivativeArray()[(int)std::floor(pointPos)] * (std::ceil(pointPos) - pointPos) + (pointPos - std::floor(pointPos))*rod->derivativeArray()[(int)std::ceil(pointPos)]);
+				rodDerivatives[i]->setPointerPosition((float)(rod->getRodWorth() * pointPos / rodDerivatives[i]->limits()[3]));
+				rodDerivatives[i]->setHorizontalPointerPosition(*rod->getExactPosition() / *rod->getRodSteps());
+			});
+		}
 	}
 
-	void createDelayedGroupsTab() {
-		Widget* delayed_tab = tabControl->createTab("Delayed neutrons");
+	void createDelayedGroupsTab(Widget* delayed_tab) {
 		delayed_tab->setId("delayed tab");
 		RelativeGridLayout* delayedLayout = new RelativeGridLayout();
 		delayedLayout->appendCol(1.f);	// graph area
@@ -2245,19 +2516,32 @@ public:
 				delayedGroups[i]->setMajorTickNumber(2);
 				delayedGroups[i]->setMinorTickNumber(3);
 				delayedGroups[i]->setLimitOverride(1, "now");
-				delayedGroups[i]->setLimitOverride(0, "30 seconds ago");
+				delayedGroups[i]->setLimitOverride(0, formatDecimals((double)properties->displayTime, 1) + " seconds ago");
 				delayedGroups[i]->setLimitMultiplier(100.);
 				delayedGroups[i]->setHorizontalName("Time");
 				delayedGroups[i]->setHorizontalUnits("s");
 				delayedGroups[i]->setHorizontalTextOffset(20.f);
 			}
 		};
+
+		// Update the stacked graph while the tab is shown
+		lazyUpdates.add(delayedGroupsGraph, {
+			[this]() { return (double)displayInterval[0]; },
+			[this]() { return (double)displayInterval[1]; },
+			[this]() { return (double)reactor->getTotalIterations(); }
+		}, [this]() {
+			double timeStart = reactor->time_[displayInterval[0]];
+			double timeEnd = reactor->time_[displayInterval[1]];
+			for (int i = 0; i < 6; i++) {
+				delayedGroups[i]->setPlotRange(displayInterval[0], displayInterval[1]);
+				delayedGroups[i]->setLimits(timeStart, timeEnd, 0., 3.);
+			}
+		});
 	}
 
-	double* operationModesPlots[2][3];
+	double* operationModesPlots[2][3] = {};
 	const int simModeFields[3] = { 7, 3, 8 };
-	void createOperationModesTab()  {
-		Widget* modes_base = tabControl->createTab("Operation modes", false);
+	void createOperationModesTab(Widget* modes_base)  {
 		TabWidget* modeTabs = modes_base->add<TabWidget>();
 		modeTabs->header()->setStretch(true);
 		modeTabs->header()->setButtonAlignment(NVGalign::NVG_ALIGN_MIDDLE | NVGalign::NVG_ALIGN_CENTER);
@@ -2513,8 +2797,7 @@ public:
 
 	const std::string labels[5] = { "Period","Power","Fuel temperature","Water temperature","Water level" };
 	const Simulator::ScramSignals reasons[5] = { Simulator::ScramSignals::Period, Simulator::ScramSignals::Power, Simulator::ScramSignals::FuelTemperature, Simulator::ScramSignals::WaterTemperature, Simulator::ScramSignals::WaterLevel };
-	void createOperationalLimitsTab() {
-		Widget* limits_tab = tabControl->createTab("Operational limits");
+	void createOperationalLimitsTab(Widget* limits_tab) {
 		limits_tab->setId("op. limits tab");
 		RelativeGridLayout* rel = new RelativeGridLayout();
 		rel->appendCol(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// left border
@@ -2651,8 +2934,7 @@ public:
 		});
 	}
 
-	void createPulseTab() {
-		Widget* pulse_tab = tabControl->createTab("Pulse");
+	void createPulseTab(Widget* pulse_tab) {
 		pulse_tab->setId("pulse tab");
 		RelativeGridLayout* rel = new RelativeGridLayout();
 		rel->appendCol(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// 0 left border
@@ -2673,7 +2955,7 @@ public:
 		standInCover->setDrawBackground(true);
 		standInCover->setBackgroundColor(Color(60, 255));
 		standInCover->setColor(Color(255, 255));
-		standInCover->setVisible(true);
+		standInCover->setVisible(!pulsePerformed);
 
 		Widget* dataSheet = pulse_tab->add<Widget>();
 		rel->setAnchor(dataSheet, RelativeGridLayout::makeAnchor(2, 1));
@@ -2761,10 +3043,15 @@ public:
 			pulseDisplayLabels[i]->setColor(Color(255, 255));
 			pulseDisplayLabels[i]->setTextAlignment((i % 2) ? (Label::TextAlign::TOP | Label::TextAlign::LEFT) : (Label::TextAlign::VERTICAL_CENTER | Label::TextAlign::HORIZONTAL_CENTER));
 		}
+
+		// A pulse may have been performed before the tab was first opened
+		if (pulsePerformed) {
+			pulseTimer->setEnabled(true);
+			updatePulseTrack(true);
+		}
 	}
 
-	void createOtherTab() {
-		Widget* other_tab = tabControl->createTab("Other");
+	void createOtherTab(Widget* other_tab) {
 		other_tab->setId("other tab");
 		RelativeGridLayout* rel = new RelativeGridLayout();
 		rel->appendCol(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// 0 left border
@@ -2773,6 +3060,10 @@ public:
 		rel->appendCol(RelativeGridLayout::Size(120.f, RelativeGridLayout::SizeType::Fixed));		// 3 load button
 		rel->appendCol(RelativeGridLayout::Size(10.f, RelativeGridLayout::SizeType::Fixed));		// 2 border
 		rel->appendCol(RelativeGridLayout::Size(120.f, RelativeGridLayout::SizeType::Fixed));		// 5 division thing
+		rel->appendCol(RelativeGridLayout::Size(10.f, RelativeGridLayout::SizeType::Fixed));		// 6 border
+		rel->appendCol(RelativeGridLayout::Size(150.f, RelativeGridLayout::SizeType::Fixed));		// 7 export thinning mode
+		rel->appendCol(RelativeGridLayout::Size(10.f, RelativeGridLayout::SizeType::Fixed));		// 8 border
+		rel->appendCol(RelativeGridLayout::Size(120.f, RelativeGridLayout::SizeType::Fixed));		// 9 export points
 		rel->appendRow(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// 0 top border
 		rel->appendRow(RelativeGridLayout::Size(30.f, RelativeGridLayout::SizeType::Fixed));		// 1 Load and save settings
 		rel->appendRow(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// 2 Seperating space
@@ -2783,6 +3074,14 @@ public:
 		rel->appendRow(RelativeGridLayout::Size(30.f, RelativeGridLayout::SizeType::Fixed));		// 7 Reset simulator
 		rel->appendRow(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// 8 Seperating space
 		rel->appendRow(RelativeGridLayout::Size(30.f, RelativeGridLayout::SizeType::Fixed));		// 9 Load script
+		rel->appendRow(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// 10 Seperating space
+		rel->appendRow(RelativeGridLayout::Size(30.f, RelativeGridLayout::SizeType::Fixed));		// 11 Frame rate
+		rel->appendRow(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// 12 Seperating space
+		rel->appendRow(RelativeGridLayout::Size(30.f, RelativeGridLayout::SizeType::Fixed));		// 13 Review data
+		rel->appendRow(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// 14 Seperating space
+		rel->appendRow(RelativeGridLayout::Size(30.f, RelativeGridLayout::SizeType::Fixed));		// 15 Telemetry
+		rel->appendRow(RelativeGridLayout::Size(15.f, RelativeGridLayout::SizeType::Fixed));		// 16 Seperating space
+		rel->appendRow(RelativeGridLayout::Size(30.f, RelativeGridLayout::SizeType::Fixed));		// 17 Remote control
 
 		other_tab->setLayout(rel);
 
@@ -2812,10 +3111,25 @@ public:
 		Button* saveLogBtn = other_tab->add<Button>("Save data");
 		rel->setAnchor(saveLogBtn, RelativeGridLayout::makeAnchor(1, 3));
 		saveLogBtn->setCallback([this]() {
+			// Names ending with .rrl are saved as a binary run log
 			std::string logFileName = file_dialog(
-			{ { "dat", "Data file" },{ "txt", "Text file" } }, true);
+			{ { "dat", "Data file" },{ "txt", "Text file" },{ "rrl", "Binary run log" } }, true);
 			reactor->dataToFile(logFileName);
 		});
+		// The data is written in the background, show its progress on the button
+		lazyUpdates.add(saveLogBtn, {
+			[this]() { return (double)reactor->exporter.progress(); },
+			[this]() { return (double)reactor->exporter.pending(); }
+		}, [this, saveLogBtn]() {
+			size_t pending = reactor->exporter.pending();
+			if (!pending) {
+				saveLogBtn->setCaption("Save data");
+				return;
+			}
+			char caption[48];
+			snprintf(caption, sizeof(caption), "Saving... %d%%%s", (int)(reactor->exporter.progress() * 100), pending > 1 ? " (+)" : "");
+			saveLogBtn->setCaption(caption);
+		});
 
 		Label* divisionLabel = other_tab->add<Label>("Save each steps:");
 		rel->setAnchor(divisionLabel, RelativeGridLayout::makeAnchor(3, 3));
@@ -2834,6 +3148,47 @@ public:
 			reactor->data_division = a;
 			});
 
+		// Shape-preserving exports keep a fixed number of points instead of every n-th step
+		ComboBox* thinningBox = other_tab->add<ComboBox>(std::vector<std::string>{ "Every n-th step", "LTTB", "Min/max" });
+		rel->setAnchor(thinningBox, RelativeGridLayout::makeAnchor(7, 3));
+		thinningBox->setSelectedIndex((int)reactor->exportThinning);
+
+		IntBox<int>* pointsBox = other_tab->add<IntBox<int>>((int)reactor->exportPoints);
+		rel->setAnchor(pointsBox, RelativeGridLayout::makeAnchor(9, 3));
+		pointsBox->setUnits("pts");
+		pointsBox->setDefaultValue(to_string(DEFAULT_EXPORT_POINTS));
+		pointsBox->setFontSize(16);
+		pointsBox->setFormat("[0-9]+");
+		pointsBox->setSpinnable(true);
+		pointsBox->setMinValue(100);
+		pointsBox->setMaxValue(1000000);
+		pointsBox->setValueIncrement(1000);
+		pointsBox->setCallback([this](int a) {
+			reactor->exportPoints = (size_t)a;
+		});
+		pointsBox->setEnabled(reactor->exportThinning != Simulator::ExportThinning::Division);
+		divisionBox->setEnabled(reactor->exportThinning == Simulator::ExportThinning::Division);
+		thinningBox->setCallback([this, divisionBox, pointsBox](int index) {
+			reactor->exportThinning = (Simulator::ExportThinning)index;
+			divisionBox->setEnabled(index == 0);
+			pointsBox->setEnabled(index != 0);
+		});
+
+		// Browse an exported run in the main graph and the pulse tab
+		reviewBtn = other_tab->add<Button>(reviewing() ? "Back to live" : "Review data");
+		rel->setAnchor(reviewBtn, RelativeGridLayout::makeAnchor(1, 13));
+		reviewBtn->setCallback([this]() {
+			if (reviewing()) {
+				stopReview();
+				return;
+			}
+			toggleBaseWindow(false);
+			std::string reviewFileName = file_dialog(
+			{ { "rrl", "Binary run log" },{ "dat", "Data file" },{ "txt", "Text file" } }, false);
+			if (reviewFileName.empty()) toggleBaseWindow(true);
+			else startReview(reviewFileName);
+		});
+
 		Button* saveRodCurves = other_tab->add<Button>("Rod curves");
 		rel->setAnchor(saveRodCurves, RelativeGridLayout::makeAnchor(1, 5));
 		saveRodCurves->setCallback([this]() {
@@ -2842,6 +3197,41 @@ public:
 			reactor->rodsToFile(logFileName);
 		});
 
+		// Checkpoints of the complete state, lessons can start from a prepared one
+		SliderCheckBox* historyBox = other_tab->add<SliderCheckBox>();
+		Button* saveStateBtn = other_tab->add<Button>("Save state");
+		rel->setAnchor(saveStateBtn, RelativeGridLayout::makeAnchor(3, 5));
+		saveStateBtn->setCallback([this, historyBox]() {
+			std::string stateFileName = file_dialog({ { "rrc", "Simulator checkpoint" } }, true);
+			if (stateFileName.empty()) return;
+			const std::string extension = CHECKPOINT_EXTENSION;
+			if (stateFileName.length() < extension.length() || stateFileName.compare(stateFileName.length() - extension.length(), extension.length(), extension) != 0)
+				stateFileName += extension;
+			reactor->saveCheckpoint(stateFileName, historyBox->checked());
+		});
+
+		Button* loadStateBtn = other_tab->add<Button>("Load state");
+		rel->setAnchor(loadStateBtn, RelativeGridLayout::makeAnchor(5, 5));
+		loadStateBtn->setCallback([this]() {
+			toggleBaseWindow(false);
+			std::string stateFileName = file_dialog({ { "rrc", "Simulator checkpoint" } }, false);
+			if (stateFileName.empty() || reactor->loadCheckpoint(stateFileName, properties)) {
+				toggleBaseWindow(true);
+				return;
+			}
+			MessageDialog* msg = new MessageDialog(this, MessageDialog::Type::Warning, "Load state", "The checkpoint could not be restored, see the console for details.");
+			msg->setPosition(Vector2i((this->size().x() - msg->size().x()) / 2, (this->size().y() - msg->size().y()) / 2));
+			msg->setCallback([this](int /*choice*/) {
+				toggleBaseWindow(true);
+			});
+		});
+
+		Label* historyLabel = other_tab->add<Label>("Save with history:");
+		rel->setAnchor(historyLabel, RelativeGridLayout::makeAnchor(7, 5));
+		rel->setAnchor(historyBox, RelativeGridLayout::makeAnchor(9, 5, 1, 1, Alignment::Minimum, Alignment::Middle));
+		historyBox->setFontSize(16);
+		historyBox->setChecked(false);
+
 		Button* loadScriptBtn = other_tab->add<Button>("Load script");
 		rel->setAnchor(loadScriptBtn, RelativeGridLayout::makeAnchor(1, 9));
 		loadScriptBtn->setCallback([this]() {
@@ -2855,6 +3245,106 @@ public:
 		resetBtn->setCallback([this]() {
 			this->resetSimToStart();
 		});
+
+		// Every input since the start is journaled, a saved journal can be replayed with --replay
+		Button* saveJournalBtn = other_tab->add<Button>("Save journal");
+		rel->setAnchor(saveJournalBtn, RelativeGridLayout::makeAnchor(3, 7));
+		saveJournalBtn->setCallback([this]() {
+			std::string journalFileName = file_dialog({ { "rrj", "Simulator input journal" } }, true);
+			if (journalFileName.empty()) return;
+			const std::string extension = JOURNAL_EXTENSION;
+			if (journalFileName.length() < extension.length() || journalFileName.compare(journalFileName.length() - extension.length(), extension.length(), extension) != 0)
+				journalFileName += extension;
+			reactor->saveJournal(journalFileName);
+		});
+
+		Label* journalLabel = other_tab->add<Label>("");
+		rel->setAnchor(journalLabel, RelativeGridLayout::makeAnchor(5, 7, 5, 1));
+		lazyUpdates.add(journalLabel, {
+			[this]() { return (double)reactor->journal.isRecording(); },
+			[this]() { return (double)(reactor->journal.size() >> 10); }
+		}, [this, journalLabel]() {
+			journalLabel->setCaption((reactor->journal.isRecording() ? "Journal: " : "Journal stopped: ") + to_string(reactor->journal.size() >> 10) + " kB");
+		});
+
+		Label* frameRateLabel = other_tab->add<Label>("Frame rate:");
+		rel->setAnchor(frameRateLabel, RelativeGridLayout::makeAnchor(1, 11));
+
+		IntBox<int>* frameRateBox = other_tab->add<IntBox<int>>((int)framePacer.targetRate());
+		rel->setAnchor(frameRateBox, RelativeGridLayout::makeAnchor(3, 11));
+		frameRateBox->setUnits("fps");
+		frameRateBox->setDefaultValue(to_string((int)FRAME_RATE_DEFAULT));
+		frameRateBox->setFontSize(16);
+		frameRateBox->setFormat("[0-9]+");
+		frameRateBox->setSpinnable(true);
+		frameRateBox->setMinMaxValues(10, 240);
+		frameRateBox->setValueIncrement(5);
+		frameRateBox->setCallback([this](int a) {
+			framePacer.setTargetRate(a);
+		});
+
+		// Telemetry stream for external displays
+		Label* telemetryLabel = other_tab->add<Label>("Telemetry port:");
+		rel->setAnchor(telemetryLabel, RelativeGridLayout::makeAnchor(1, 15));
+
+		IntBox<int>* telemetryPortBox = other_tab->add<IntBox<int>>(TELEMETRY_PORT_DEFAULT);
+		rel->setAnchor(telemetryPortBox, RelativeGridLayout::makeAnchor(3, 15));
+		telemetryPortBox->setDefaultValue(to_string(TELEMETRY_PORT_DEFAULT));
+		telemetryPortBox->setFontSize(16);
+		telemetryPortBox->setFormat("[0-9]+");
+		telemetryPortBox->setMinMaxValues(1024, 65535);
+
+		SliderCheckBox* telemetryBox = other_tab->add<SliderCheckBox>();
+		rel->setAnchor(telemetryBox, RelativeGridLayout::makeAnchor(5, 15, 1, 1, Alignment::Minimum, Alignment::Middle));
+		telemetryBox->setFontSize(16);
+		telemetryBox->setChecked(reactor->telemetry.isRunning());
+		telemetryBox->setCallback([this, telemetryBox, telemetryPortBox](bool value) {
+			if (value) telemetryBox->setChecked(reactor->telemetry.start(telemetryPortBox->value()));
+			else reactor->telemetry.stop();
+		});
+
+		Label* subscribersLabel = other_tab->add<Label>("");
+		rel->setAnchor(subscribersLabel, RelativeGridLayout::makeAnchor(7, 15, 3, 1));
+		// Scripts can start and stop the telemetry as well
+		lazyUpdates.add(subscribersLabel, {
+			[this]() { return (double)reactor->telemetry.isRunning(); },
+			[this]() { return (double)reactor->telemetry.subscribers(); }
+		}, [this, telemetryBox, subscribersLabel]() {
+			telemetryBox->setChecked(reactor->telemetry.isRunning());
+			size_t subscribers = reactor->telemetry.subscribers();
+			subscribersLabel->setCaption(reactor->telemetry.isRunning() ? to_string(subscribers) + (subscribers == 1 ? " subscriber" : " subscribers") : "");
+		});
+
+		// JSON-RPC remote control for exam checkers and test harnesses
+		Label* remoteLabel = other_tab->add<Label>("Remote port:");
+		rel->setAnchor(remoteLabel, RelativeGridLayout::makeAnchor(1, 17));
+
+		IntBox<int>* remotePortBox = other_tab->add<IntBox<int>>(REMOTE_CONTROL_PORT_DEFAULT);
+		rel->setAnchor(remotePortBox, RelativeGridLayout::makeAnchor(3, 17));
+		remotePortBox->setDefaultValue(to_string(REMOTE_CONTROL_PORT_DEFAULT));
+		remotePortBox->setFontSize(16);
+		remotePortBox->setFormat("[0-9]+");
+		remotePortBox->setMinMaxValues(1024, 65535);
+
+		SliderCheckBox* remoteBox = other_tab->add<SliderCheckBox>();
+		rel->setAnchor(remoteBox, RelativeGridLayout::makeAnchor(5, 17, 1, 1, Alignment::Minimum, Alignment::Middle));
+		remoteBox->setFontSize(16);
+		remoteBox->setChecked(reactor->remote.isRunning());
+		remoteBox->setCallback([this, remoteBox, remotePortBox](bool value) {
+			if (value) remoteBox->setChecked(reactor->remote.start(remotePortBox->value()));
+			else reactor->remote.stop();
+		});
+
+		Label* clientsLabel = other_tab->add<Label>("");
+		rel->setAnchor(clientsLabel, RelativeGridLayout::makeAnchor(7, 17, 3, 1));
+		lazyUpdates.add(clientsLabel, {
+			[this]() { return (double)reactor->remote.isRunning(); },
+			[this]() { return (double)reactor->remote.clients(); }
+		}, [this, remoteBox, clientsLabel]() {
+			remoteBox->setChecked(reactor->remote.isRunning());
+			size_t clients = reactor->remote.clients();
+			clientsLabel->setCaption(reactor->remote.isRunning() ? to_string(clients) + (clients == 1 ? " client" : " clients") : "");
+		});
 	}
 
 	double trackerY[2] = { 0.,1. };
@@ -2868,6 +3358,7 @@ public:
 	}
 
 	void handleDerivativeChange() {
+		if (!tabBuilt(RodsTab)) return;
 		for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) {
 			rodDerivatives[i]->setYdata(reactor->rods[i]->derivativeArray());
 			double avg = reactor->rods[i]->getRodWorth() / *reactor->rods[i]->getRodSteps();
@@ -2879,6 +3370,7 @@ public:
 	void hardcoreMode(bool value) {
 		reactivityPlot->setEnabled(!value);
 		rodReactivityPlot->setEnabled(properties->rodReactivityPlot && !value);
+		meterReactivityPlot->setEnabled(meterReactivityBox->checked() && !value);
 
 		reactivityShow->setVisible(!value);
 		rodReactivityShow->setVisible(!value);
@@ -2931,8 +3423,19 @@ public:
 			}
 		}
 #if defined(_WIN32)
+		if (serialProbe.joinable()) serialProbe.join();
 		if (boxConnected) delete theBox;
 #endif
+		if (windowIcons.valid()) {
+			for (GLFWimage &icon : windowIcons.get()) delete[] icon.pixels;
+		}
+	}
+
+	// Sets the window icon once its pixels were created
+	void setWindowIcons() {
+		std::vector<GLFWimage> icons = windowIcons.get();
+		glfwSetWindowIcon(mGLFWWindow, (int)icons.size(), icons.data());
+		for (GLFWimage &icon : icons) delete[] icon.pixels;
 	}
 
 	virtual bool keyboardEvent(int key, int scancode, int action, int modifiers) {
@@ -3135,6 +3638,14 @@ private:
 	bool debugMode = false;
 	deque<int> last10keys = deque<int>();
 	size_t displayInterval[2] = { 0,0 };
+	// Review mode: an exported run is shown instead of the live data
+	RunLogView reviewLog;
+	ReferenceRun reference;
+	double reviewStart = -1.;
+	size_t reviewInterval[2] = { 0,0 };
+	Button* reviewBtn = nullptr;
+	bool livePulsePerformed = false;
+	Simulator::PulseData liveLastPulseData;
 	bool btns[11];
 	int lastModeState = 0;
 
@@ -3169,10 +3680,90 @@ private:
 		return ret[0] + ":" + ret[1] + ":" + ret[2];
 	}
 
+	enum TabIndex { MainTab = 0, GraphTab, PhysicsTab, RodsTab, DelayedTab, ModesTab, LimitsTab, PulseTab, OtherTab };
+
+	struct TabBuilder {
+		std::string name;
+		Widget* host = nullptr;
+		std::function<void(Widget*)> build;
+		bool built = true;
+	};
+	std::vector<TabBuilder> tabBuilders;
+
+	// Adds an empty tab whose content is created the first time it is shown
+	void addLazyTab(const std::string &name, bool scrolling, const std::function<void(Widget*)> &build) {
+		TabBuilder tab;
+		tab.name = name;
+		tab.host = tabControl->createTab(name, scrolling);
+		tab.build = build;
+		tab.built = false;
+		tabBuilders.push_back(tab);
+	}
+
+	bool tabBuilt(int index) const {
+		return index < 0 || index >= (int)tabBuilders.size() || tabBuilders[index].built;
+	}
+
+	void buildTab(int index) {
+		if (tabBuilt(index)) return;
+		double start = nanogui::get_seconds_since_epoch();
+		TabBuilder &tab = tabBuilders[index];
+		tab.built = true;
+		tab.build(tab.host);
+		performLayout();
+		cout << "Built tab \"" << tab.name << "\" in " << formatDecimals((nanogui::get_seconds_since_epoch() - start) * 1e3, 1) << " ms" << endl;
+	}
+
+	/*
+	Registers the per-frame updates of main tab widgets which only need to be refreshed while they are shown.
+	Every update lists the values it depends on and is skipped when none of them changed.
+	Widgets of the other tabs register their updates when the tab is built.
+	*/
+	void registerLazyUpdates() {
+		auto iterations = [this]() { return (double)reactor->getTotalIterations(); };
+
+		// Rod position boxes
+		for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) {
+			ControlRod* rod = reactor->rods[i];
+			lazyUpdates.add(rodBox[i], {
+				[rod]() { return std::ceil(*rod->getExactPosition()); },
+				[this, i]() { return (double)rodBox[i]->focused(); }
+			}, [this, rod, i]() {
+				rodBox[i]->setText((int)std::ceil(*rod->getExactPosition()));
+			});
+		}
+
+		// SCRAM warning colours
+		lazyUpdates.add(periodScram, {
+			iterations,
+			[this]() { return (double)reactor->getScramStatus(); },
+			[this]() { return properties->periodLimit; },
+			[this]() { return (double)properties->tempLimit; },
+			[this]() { return (double)properties->waterTempLimit; },
+			[this]() { return properties->powerLimit; }
+		}, [this]() {
+			if (reactor->getScramStatus()) return;
+			const Color warning(175, 100, 0, 255), normal(120, 120);
+			double period = *reactor->getReactorPeriod();
+			periodScram->setBackgroundColor(((period < 1.1 * properties->periodLimit) && (period > 0.)) ? warning : normal);
+			fuelTemperatureScram->setBackgroundColor((reactor->getCurrentTemperature() > 0.9 * properties->tempLimit) ? warning : normal);
+			waterTemperatureScram->setBackgroundColor((*reactor->getWaterTemperature() > 0.9 * properties->waterTempLimit) ? warning : normal);
+			powerScram->setBackgroundColor((reactor->getCurrentPower() > 0.9 * properties->powerLimit) ? warning : normal);
+		});
+	}
+
 public:
 	double lastTime = nanogui::get_seconds_since_epoch();
+	std::future<std::vector<GLFWimage>> windowIcons;
+#if defined(_WIN32)
+	std::thread serialProbe;
+	std::atomic<bool> serialProbing{ false };
+#endif
 
 	virtual void draw(NVGcontext *ctx) {
+		// Build the content of a tab the first time it is shown
+		buildTab(tabControl->activeTab());
+
 		double reactorElapsed = reactor->getCurrentTime();
 		if (startScript.size()) {
 			loadScriptFromFile(startScript);
@@ -3181,12 +3772,16 @@ public:
 			
 		// Run new calculation
 		reactor->runLoop();
+		updateReferenceDeviation();
 
 
 		// Get from which index to which index the data will be drawn and update view slider
 		const double sliderRange = std::min(DELETE_OLD_DATA_TIME_DEFAULT, reactorElapsed);
 		double sliderStart = displayTimeSlider->value(0) * sliderRange;
-		if (viewStart >= 0.) {
+		if (reviewing()) {
+			updateReviewInterval();
+		}
+		else if (viewStart >= 0.) {
 			if (!timeLockedBox->checked()) {
 				double diff = reactorElapsed - timeAtLastChange;
 				sliderStart = viewStart + diff - max(0., reactorElapsed - DELETE_OLD_DATA_TIME_DEFAULT);
@@ -3201,27 +3796,29 @@ public:
 			sliderStart = max(reactorElapsed - properties->displayTime, 0.);
 			reculculateDisplayInterval(sliderStart, reactorElapsed);
 		}
-		displayTimeSlider->setValue(0, (float)(sliderStart / sliderRange));
-		displayTimeSlider->setValue(1, (float)min(1., (sliderStart + properties->displayTime)/sliderRange));
+		if (!reviewing()) {
+			displayTimeSlider->setValue(0, (float)(sliderStart / sliderRange));
+			displayTimeSlider->setValue(1, (float)min(1., (sliderStart + properties->displayTime)/sliderRange));
+		}
 
 		// Link plots to display interval
-		reactivityPlot->setPlotRange(displayInterval[0], displayInterval[1]);
-		rodReactivityPlot->setPlotRange(displayInterval[0], displayInterval[1]);
-		temperaturePlot->setPlotRange(displayInterval[0], displayInterval[1]);
-		powerPlot->setPlotRange(displayInterval[0], displayInterval[1]);
-		for (size_t i = 0; i < 6; i++) {
-			delayedGroups[i]->setPlotRange(displayInterval[0], displayInterval[1]);
-		}
+		const size_t* shownInterval = reviewing() ? reviewInterval : displayInterval;
+		reactivityPlot->setPlotRange(shownInterval[0], shownInterval[1]);
+		rodReactivityPlot->setPlotRange(shownInterval[0], shownInterval[1]);
+		meterReactivityPlot->setPlotRange(shownInterval[0], shownInterval[1]);
+		temperaturePlot->setPlotRange(shownInterval[0], shownInterval[1]);
+		powerPlot->setPlotRange(shownInterval[0], shownInterval[1]);
 
 		try {
 			// Save times for better performance
-			double timeStart = reactor->time_[displayInterval[0]];
-			double timeEnd = reactor->time_[displayInterval[1]];
+			double timeStart = shownTime(shownInterval[0]);
+			double timeEnd = shownTime(shownInterval[1]);
 			// Set reactivity scaling
 			reactivityPlot->setLimits(timeStart, timeEnd, properties->reactivityGraphLimits[0], properties->reactivityGraphLimits[1]);
 			rodReactivityPlot->setLimits(timeStart, timeEnd, properties->reactivityGraphLimits[0], properties->reactivityGraphLimits[1]);
+			meterReactivityPlot->setLimits(timeStart, timeEnd, properties->reactivityGraphLimits[0], properties->reactivityGraphLimits[1]);
 			// Set power plot scaling
-			pair<int, int> newExtremes = recalculatePowerExtremes();
+			pair<int, int> newExtremes = recalculatePowerExtremes(timeStart, timeEnd);
 			if (isZero.first || isZero.second) {
 				if (isZero.first && isZero.second) {
 					powerPlot->setLimits(timeStart, timeEnd,
@@ -3238,33 +3835,12 @@ public:
 			}
 			// Set temperature scaling
 			temperaturePlot->setLimits(timeStart, timeEnd, properties->temperatureGraphLimits[0], properties->temperatureGraphLimits[1]);
-
-			// Set stacked graph scaling
-			if (tabControl->activeTab() == 4) {
-				for (int i = 0; i < 6; i++) {
-					delayedGroups[i]->setLimits(timeStart, timeEnd, 0., 3.);
-				}
-			}
+			updateReferencePlots();
 		}
 		catch (exception e) {
 			cerr << "Index out of bounds: SimulatorGUI.draw" << "\n" << e.what() << endl;
 		}
 
-		// re-draw control rods
-		if (tabControl->activeTab() == 3) {
-			float pointPos;
-			for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) {
-				rodCurves[i]->setPointerPosition(reactor->rods[i]->getCurrentPCM() / reactor->rods[i]->getRodWorth());
-				rodCurves[i]->setRodPosition(*reactor->rods[i]->getExactPosition() / *reactor->rods[i]->getRodSteps());
-				rodCurves[i]->setHorizontalPointerPosition(*reactor->rods[i]->getExactPosition() / *reactor->rods[i]->getRodSteps());
-
-				pointPos = *reactor->rods[i]->getExactPosition();
-				pointPos = (float)(reactor->rods[i]->derivativeArray()[(int)std::floor(pointPos)] * (std::ceil(pointPos) - pointPos) + (pointPos - std::floor(pointPos))*reactor->rods[i]->derivativeArray()[(int)std::ceil(pointPos)]);
-				rodDerivatives[i]->setPointerPosition((float)(reactor->rods[i]->getRodWorth() * pointPos / rodDerivatives[i]->limits()[3]));
-				rodDerivatives[i]->setHorizontalPointerPosition(*reactor->rods[i]->getExactPosition() / *reactor->rods[i]->getRodSteps());
-			}
-		}
-
 		// Show data
 		powerShow->setData(reactor->getCurrentPower());
 		size_t curIndx = reactor->getCurrentIndex();
@@ -3278,53 +3854,21 @@ public:
 		//Data for graphical reactor period display
 		periodDisplay->setPeriod(*reactor->getReactorPeriod());
 
-		double newTime = nanogui::get_seconds_since_epoch();
-		float thisFps = powf((float)(newTime - lastTime), -1.f);
-		fpsSum += thisFps;
-		if (fpsCount == 0 || fpsCount == 20) {
-			fpsLabel->setCaption("FPS: " + to_string((int)roundf(fpsCount ? (fpsSum / fpsCount) : thisFps)));
-			fpsSum = thisFps;
-			fpsCount %= 20;
-		}
-		fpsCount++;
-		lastTime = newTime;
-
-		// Update alpha plot
-		float tempNow = reactor->getCurrentTemperature();
-		alphaPlot->setHorizontalPointerPosition(tempNow / 1000.f);
-		alphaPlot->setPointerPosition((float)((reactor->getReactivityCoefficient(tempNow) - alphaPlot->limits()[2]) / (alphaPlot->limits()[3] -  alphaPlot->limits()[2])));
-
-		// Update the text
-		for (int i = 0; i < NUMBER_OF_CONTROL_RODS; i++) rodBox[i]->setText((int)std::ceil(*reactor->rods[i]->getExactPosition()));
+		// Update widgets of the visible tabs whose data changed
+		lazyUpdates.update();
 
 		// Update time
 		timeLabel->setCaption(getTimeSinceStart());
 
-		if (!reactor->getScramStatus()) {
-			if ((*reactor->getReactorPeriod() < 1.1 * properties->periodLimit) && (*reactor->getReactorPeriod() > 0.)) {
-				periodScram->setBackgroundColor(Color(175, 100, 0, 255));
-			}
-			else {
-				periodScram->setBackgroundColor(Color(120, 120));
-			}
-			if (tempNow > 0.9 * properties->tempLimit) {
-				fuelTemperatureScram->setBackgroundColor(Color(175, 100, 0, 255));
-			}
-			else {
-				fuelTemperatureScram->setBackgroundColor(Color(120, 120));
-			}
-			if (*reactor->getWaterTemperature() > 0.9 * properties->waterTempLimit) {
-				waterTemperatureScram->setBackgroundColor(Color(175, 100, 0, 255));
-			}
-			else {
-				waterTemperatureScram->setBackgroundColor(Color(120, 120));
-			}
-			if (reactor->getCurrentPower() > 0.9 * properties->powerLimit) {
-				powerScram->setBackgroundColor(Color(175, 100, 0, 255));
-			}
-			else {
-				powerScram->setBackgroundColor(Color(120, 120));
-			}
+		// Drop to the idle frame rate while paused, show frame times twice a second
+		framePacer.setIdle(reactor->getSpeedFactor() == 0.);
+		double newTime = nanogui::get_seconds_since_epoch();
+		if (newTime - lastTime > 0.5) {
+			FramePacer::Statistics stats = framePacer.statistics();
+			char frameText[64];
+			snprintf(frameText, sizeof(frameText), "Frame: %.1f ms (p50 %.1f, p99 %.1f)", stats.last * 1e3f, stats.p50 * 1e3f, stats.p99 * 1e3f);
+			fpsLabel->setCaption(frameText);
+			lastTime = newTime;
 		}
 
 		if (shouldUpdateNeutronSource) {
@@ -3334,14 +3878,25 @@ public:
 		
 		/* Draw the user interface */
 		Screen::draw(ctx);
+
+		if (!startupProfiler.done()) {
+			startupProfiler.mark("First frame");
+			startupProfiler.report(cout);
+		}
+		if (windowIcons.valid() && windowIcons.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			setWindowIcons();
+		}
 		
 		// Send dickbut PNG bits over serial
 #if defined(_WIN32)
-		if (boxConnected) {
-			if (theBox->IsConnected()) handleBox();
-		}
-		else {
-			updateCOMports();
+		// The startup probe of the ports runs on its own thread
+		if (!serialProbing) {
+			if (boxConnected) {
+				if (theBox->IsConnected()) handleBox();
+			}
+			else {
+				updateCOMports();
+			}
 		}
 #endif
 	}
@@ -3595,6 +4150,92 @@ public:
 		return res;
 	}
 
+	bool reviewing() const { return reviewLog.isOpen(); }
+	// Time and index lookups of the data the graphs show
+	double shownTime(size_t index) const { return reviewing() ? reviewLog.time()[index] : reactor->time_[index]; }
+	size_t shownIndexFromTime(double time) const { return reviewing() ? reviewLog.indexFromTime(time) : reactor->getIndexFromTime(time); }
+
+	// Shows an exported run in the main graph and the pulse tab, the simulation keeps running
+	void startReview(const std::string &fileName) {
+		if (reviewing()) stopReview();
+		auto start = std::chrono::steady_clock::now();
+		if (!reviewLog.open(fileName)) {
+			cerr << reviewLog.error() << endl;
+			MessageDialog* msg = new MessageDialog(this, MessageDialog::Type::Warning, "Review data", reviewLog.error());
+			msg->setPosition(Vector2i((this->size().x() - msg->size().x()) / 2, (this->size().y() - msg->size().y()) / 2));
+			msg->setCallback([this](int /*choice*/) {
+				toggleBaseWindow(true);
+			});
+			return;
+		}
+		// Measured logs have no reconstructed reactivity, the meter gets it from their power
+		reviewLog.computeMeterReactivity(reactor->reactivityMeter);
+		cout << "Reviewing " << reviewLog.size() << " rows of " << fileName << ", opened in "
+			<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << endl;
+
+		livePulsePerformed = pulsePerformed;
+		liveLastPulseData = lastPulseData;
+		RunLogView::Pulse pulse;
+		pulsePerformed = reviewLog.findPulse(pulse);
+		if (pulsePerformed) {
+			lastPulseData = Simulator::PulseData();
+			lastPulseData.peakPower = pulse.peakPower;
+			lastPulseData.timeAtMax = pulse.timeAtMax;
+			lastPulseData.FWHM = pulse.FWHM;
+			lastPulseData.releasedEnergy = pulse.releasedEnergy;
+			lastPulseData.maxFuelTemp = pulse.maxFuelTemp;
+			lastPulseData.pulseStartIndex = pulse.startIndex;
+		}
+
+		reviewStart = -1.;
+		displayTimeSlider->setSteps((unsigned int)std::max(std::round(1000. * (reviewLog.endTime() - reviewLog.startTime())), 1.));
+		linkMainPlots();
+		refreshPulseTab();
+		if (reviewBtn) reviewBtn->setCaption("Back to live");
+		toggleBaseWindow(true);
+	}
+
+	void stopReview() {
+		if (!reviewing()) return;
+		reviewLog.close();
+		pulsePerformed = livePulsePerformed;
+		lastPulseData = liveLastPulseData;
+		displayTimeSlider->setSteps((unsigned int)DELETE_OLD_DATA_TIME_DEFAULT * 1000U);
+		linkMainPlots();
+		powerPlot->setLimitOverride(0, formatDecimals((double)properties->displayTime, 1) + " seconds ago");
+		powerPlot->setLimitOverride(1, "now");
+		refreshPulseTab();
+		if (reviewBtn) reviewBtn->setCaption("Review data");
+	}
+
+	void refreshPulseTab() {
+		if (!tabBuilt(PulseTab)) return;
+		linkPulsePlots();
+		standInCover->setVisible(!pulsePerformed);
+		pulseTimer->setEnabled(pulsePerformed);
+		updatePulseTrack(true);
+	}
+
+	// Keeps the reviewed window inside the run and moves the view slider with it
+	void updateReviewInterval() {
+		const double first = reviewLog.startTime();
+		const double duration = std::max(reviewLog.endTime() - first, 1e-3);
+		const double width = std::min((double)properties->displayTime, duration);
+		if (reviewStart < 0.) reviewStart = first + duration - width;
+		reviewStart = std::min(std::max(reviewStart, first), first + duration - width);
+		reviewInterval[0] = reviewLog.indexFromTime(reviewStart);
+		reviewInterval[1] = reviewLog.indexFromTime(reviewStart + width);
+		displayTimeSlider->setValue(0, (float)((reviewStart - first) / duration));
+		displayTimeSlider->setValue(1, (float)((reviewStart - first + width) / duration));
+
+		// Times of the window edges instead of "seconds ago" and "now"
+		char edge[32];
+		DataExporter::formatTime(edge, sizeof(edge), shownTime(reviewInterval[0]));
+		powerPlot->setLimitOverride(0, edge);
+		DataExporter::formatTime(edge, sizeof(edge), shownTime(reviewInterval[1]));
+		powerPlot->setLimitOverride(1, edge);
+	}
+
 	void reculculateDisplayInterval(double fromTime, double toTime) {
 		fromTime = std::max(fromTime, 0.);
 		toTime = std::min(toTime, reactor->getCurrentTime());
@@ -3605,6 +4246,18 @@ public:
 	// Method for calculating autoscale factors
 	pair<int, int> recalculatePowerExtremes(double fromTime = 0., double toTime = 0.) {
 		int err = 0;
+		if (reviewing()) {
+			if (fromTime + toTime == 0.) {
+				fromTime = shownTime(reviewInterval[0]);
+				toTime = shownTime(reviewInterval[1]);
+			}
+			int orders[2] = { 0, 1 };
+			bool hasZero;
+			bool positive = reviewLog.powerOrders(reviewLog.indexFromTime(fromTime), reviewLog.indexFromTime(toTime), orders[0], orders[1], hasZero);
+			isZero.first = !positive || hasZero || orders[0] < -7;
+			isZero.second = !positive;
+			return pair<int, int>(orders[0], orders[1]);
+		}
 		if (fromTime + toTime == 0.) {
 			fromTime = reactor->time_[displayInterval[0]];
 			toTime = reactor->time_[displayInterval[1]];
@@ -3715,15 +4368,25 @@ public:
 				std::cerr << "Error opening input file: " << path << std::endl;
 				return;
 			}
-			std::istream& is = static_cast<std::istream&>(ifs);
-
-			Command cmd;
-
-			while (is >> cmd) {
+			// The whole script is checked before anything runs
+			Script script;
+			std::string error;
+			if (!compileScript(ifs, script, error)) {
+				std::cerr << path << ", " << error << std::endl;
+				MessageDialog* msg = new MessageDialog(this, MessageDialog::Type::Warning, "Load script", error);
+				msg->setPosition(Vector2i((this->size().x() - msg->size().x()) / 2, (this->size().y() - msg->size().y()) / 2));
+				msg->setCallback([this](int /*choice*/) {
+					toggleBaseWindow(true);
+					});
+				return;
+			}
+			for (Command &cmd : script.timed) {
 				cmd.timed += time0;
-				cout << cmd;
-				reactor->scriptCommands.push_back(cmd);
+				reactor->addScriptCommand(cmd);
 			}
+			const size_t statements = script.program.statements.size();
+			if (!script.program.empty()) reactor->addScriptProgram(std::move(script.program));
+			cout << "Loaded " << script.timed.size() << " timed commands and " << statements << " program statements from " << path << endl;
 
 
 			MessageDialog* msg = new MessageDialog(this, MessageDialog::Type::Warning, "Load script", "Loaded.");
@@ -3741,103 +4404,125 @@ public:
 	}
 
 	void updateSettings(bool updateReactor = true) {
+		lazyUpdates.invalidate();
+		// Main and graph tabs
 		curveFillBox->setChecked(properties->curveFill);
 		curveFillBox->callback()(properties->curveFill);
-		avoidPeriodScramBox->setChecked(properties->avoidPeriodScram);
-		avoidPeriodScramBox->callback()(properties->avoidPeriodScram);
-		for (int i = 0; i < 6; i++) {
-			delayedGroupBoxes[i]->setValue(properties->betas[i]);
-			delayedGroupBoxes[6 + i]->setValue(properties->lambdas[i]);
-			delayedGroupsEnabledBoxes[i]->setChecked(properties->groupsEnabled[i]);
-			delayedGroupsEnabledBoxes[i]->callback()(properties->groupsEnabled[i]);
-		}
-		coreVolumeBox->setValue(properties->coreVolume * 1e3); // Convert from m3 to L
-		alpha0Box->setValue(properties->alpha0);
-		alphaPeakBox->setValue(properties->alphaAtT1);
-		alphaSlopeBox->setValue((float)properties->alphaK);
-		tempPeakBox->setValue(properties->alphaT1);
 		displayBox->setValue(properties->displayTime);
-		excessReactivityBox->setValue(properties->excessReactivity);
-		fissionProductsBox->setChecked(properties->fissionPoisons);
-		fissionProductsBox->callback()(properties->fissionPoisons);
 		graphSizeBox->setValue((int)(properties->graphSize * 100));
-		sourceActivityBox->setValue(properties->neutronSourceActivity);
 		neutronSourceCB->setChecked(properties->neutronSourceInserted);
 		neutronSourceCB->callback()(properties->neutronSourceInserted);
-		neutronSourceModeBox->setSelectedIndex(properties->ns_mode);
-		neutronSourcePeriodBoxes[0]->setValue(properties->ns_squareWave.period);
-		neutronSourcePeriodBoxes[1]->setValue(properties->ns_sineMode.period);
-		neutronSourcePeriodBoxes[2]->setValue(properties->ns_sawToothMode.period);
-		neutronSourceAmplitudeBoxes[0]->setValue(properties->ns_squareWave.amplitude);
-		neutronSourceAmplitudeBoxes[1]->setValue(properties->ns_sineMode.amplitude);
-		neutronSourceAmplitudeBoxes[2]->setValue(properties->ns_sawToothMode.amplitude);
-		for (int i = 0; i < 4; i++)	neutronSourceSQWBoxes[i]->setValue((int)(properties->ns_squareWave.xIndex[i] * 100));
-		neutronSourceSINEModeBox->setSelectedIndex((int)properties->ns_sineMode.mode);
-		for (int i = 0; i < 6; i++)	neutronSourceSAWBoxes[i]->setValue((int)(properties->ns_sawToothMode.xIndex[i] * 100));
-		periodLimBox->setValue((float)properties->periodLimit);
-		powerLimBox->setValue(properties->powerLimit * 1e-03);
-		fuel_tempLimBox->setValue(properties->tempLimit);
-		water_tempLimBox->setValue(properties->waterTempLimit);
-		//water_levelLimBox->setValue(properties->waterLevelLimit);
-		for (int i = 0; i < 4; i++) {
-			bool value = false;
-			switch (i) {
-			case 0: value = properties->periodScram; break;
-			case 1: value = properties->powerScram; break;
-			case 2: value = properties->tempScram; break;
-			case 3: value = properties->waterTempScram; break;
-			case 4: value = properties->waterLevelScram; break;
-			}
-			scramEnabledBoxes[i]->setChecked(value);
-			scramEnabledBoxes[i]->callback()(value);
-		}
-
-		promptNeutronLifetimeBox->setValue(properties->promptNeutronLifetime);
 		for (int i = 0; i < 2; i++) {
 			reactivityLimitBox[i]->setValue(properties->reactivityGraphLimits[i]);
 			temperatureLimitBox[i]->setValue(properties->temperatureGraphLimits[i]);
 		}
 		rodReactivityBox->setChecked(properties->rodReactivityPlot);
 		rodReactivityBox->callback()(properties->rodReactivityPlot);
-		for (int i = 0; i < 3; i++) {
-			rodStepsBox[i]->setValue((int)properties->rodSettings[i].rodSteps);
-			rodWorthBox[i]->setValue(properties->rodSettings[i].rodWorth);
-			rodSpeedBox[i]->setValue(properties->rodSettings[i].rodSpeed);
-			for (int j = 0; j < 2; j++) {
-				rodCurveSliders[i * 2 + j]->setValue(properties->rodSettings[i].rodCurve[j]);
-				rodCurveSliders[i * 2 + j]->finalCallback()(properties->rodSettings[i].rodCurve[j]);
-				rodCurves[i]->setParameter(j * 2, properties->rodSettings[i].rodCurve[j]);
-			}
-		}
-		periodBoxes[0]->setValue(properties->squareWave.period);
-		amplitudeBoxes[0]->setValue(properties->squareWave.amplitude);
-		for(int i = 0; i < 4; i++)	squareWaveBoxes[i]->setValue((int)(properties->squareWave.xIndex[i] * 100));
-		periodBoxes[1]->setValue(properties->sineMode.period);
-		amplitudeBoxes[1]->setValue(properties->sineMode.amplitude);
-		sineModeBox->setSelectedIndex(properties->sineMode.mode);
-		periodBoxes[2]->setValue(properties->sawToothMode.period);
-		amplitudeBoxes[2]->setValue(properties->sawToothMode.amplitude);
-		for(int i = 0; i < 6; i++)	sawToothBoxes[i]->setValue((int)(properties->sawToothMode.xIndex[i] * 100));
-		keepCurrentPowerBox->setChecked(properties->steadyCurrentPower);
-		keepCurrentPowerBox->callback()(properties->steadyCurrentPower);
-		steadyPowerBox->setValue(properties->steadyGoalPower);
-		automaticMarginBox->setValue(properties->steadyMargin * 100);
-		tempEffectsBox->setChecked(properties->temperatureEffects);
-		tempEffectsBox->callback()(properties->temperatureEffects);
 		cooling->setChecked(properties->waterCooling);
 		cooling->callback()(properties->waterCooling);
-		coolingPowerBox->setValue(properties->waterCoolingPower);
-		waterVolumeInput->setValue(properties->waterVolume);
-		allRodsBox->setChecked(properties->allRodsAtOnce);
-		allRodsBox->callback()(properties->allRodsAtOnce);
 		logScaleBox->setChecked(properties->yAxisLog);
 		logScaleBox->callback()(properties->yAxisLog);
-		autoScramBox->setChecked(properties->automaticPulseScram);
-		autoScramBox->callback()(properties->automaticPulseScram);
 		hardcoreBox->setChecked(properties->reactivityHardcore);
 		hardcoreBox->callback()(properties->reactivityHardcore);
-		squareWaveSpeedBox->setChecked(properties->squareWaveUsesRodSpeed);
-		squareWaveSpeedBox->callback()(properties->squareWaveUsesRodSpeed);
+
+		// Tabs which were not opened yet read the settings when they are built
+		if (tabBuilt(PhysicsTab)) {
+			for (int i = 0; i < 6; i++) {
+				delayedGroupBoxes[i]->setValue(properties->betas[i]);
+				delayedGroupBoxes[6 + i]->setValue(properties->lambdas[i]);
+				delayedGroupsEnabledBoxes[i]->setChecked(properties->groupsEnabled[i]);
+				delayedGroupsEnabledBoxes[i]->callback()(properties->groupsEnabled[i]);
+			}
+			coreVolumeBox->setValue(properties->coreVolume * 1e3); // Convert from m3 to L
+			alpha0Box->setValue(properties->alpha0);
+			alphaPeakBox->setValue(properties->alphaAtT1);
+			alphaSlopeBox->setValue((float)properties->alphaK);
+			tempPeakBox->setValue(properties->alphaT1);
+			excessReactivityBox->setValue(properties->excessReactivity);
+			fissionProductsBox->setChecked(properties->fissionPoisons);
+			fissionProductsBox->callback()(properties->fissionPoisons);
+			sourceActivityBox->setValue(properties->neutronSourceActivity);
+			neutronSourceModeBox->setSelectedIndex(properties->ns_mode);
+			neutronSourcePeriodBoxes[0]->setValue(properties->ns_squareWave.period);
+			neutronSourcePeriodBoxes[1]->setValue(properties->ns_sineMode.period);
+			neutronSourcePeriodBoxes[2]->setValue(properties->ns_sawToothMode.period);
+			neutronSourceAmplitudeBoxes[0]->setValue(properties->ns_squareWave.amplitude);
+			neutronSourceAmplitudeBoxes[1]->setValue(properties->ns_sineMode.amplitude);
+			neutronSourceAmplitudeBoxes[2]->setValue(properties->ns_sawToothMode.amplitude);
+			for (int i = 0; i < 4; i++)	neutronSourceSQWBoxes[i]->setValue((int)(properties->ns_squareWave.xIndex[i] * 100));
+			neutronSourceSINEModeBox->setSelectedIndex((int)properties->ns_sineMode.mode);
+			for (int i = 0; i < 6; i++)	neutronSourceSAWBoxes[i]->setValue((int)(properties->ns_sawToothMode.xIndex[i] * 100));
+			promptNeutronLifetimeBox->setValue(properties->promptNeutronLifetime);
+			tempEffectsBox->setChecked(properties->temperatureEffects);
+			tempEffectsBox->callback()(properties->temperatureEffects);
+			coolingPowerBox->setValue(properties->waterCoolingPower);
+			waterVolumeInput->setValue(properties->waterVolume);
+		}
+		else {
+			// Not part of setProperties
+			reactor->setFissionPoisoningEffectsEnabled(properties->fissionPoisons);
+		}
+
+		if (tabBuilt(RodsTab)) {
+			for (int i = 0; i < 3; i++) {
+				rodStepsBox[i]->setValue((int)properties->rodSettings[i].rodSteps);
+				rodWorthBox[i]->setValue(properties->rodSettings[i].rodWorth);
+				rodSpeedBox[i]->setValue(properties->rodSettings[i].rodSpeed);
+				for (int j = 0; j < 2; j++) {
+					rodCurveSliders[i * 2 + j]->setValue(properties->rodSettings[i].rodCurve[j]);
+					rodCurveSliders[i * 2 + j]->finalCallback()(properties->rodSettings[i].rodCurve[j]);
+					rodCurves[i]->setParameter(j * 2, properties->rodSettings[i].rodCurve[j]);
+				}
+			}
+		}
+
+		if (tabBuilt(ModesTab)) {
+			periodBoxes[0]->setValue(properties->squareWave.period);
+			amplitudeBoxes[0]->setValue(properties->squareWave.amplitude);
+			for(int i = 0; i < 4; i++)	squareWaveBoxes[i]->setValue((int)(properties->squareWave.xIndex[i] * 100));
+			periodBoxes[1]->setValue(properties->sineMode.period);
+			amplitudeBoxes[1]->setValue(properties->sineMode.amplitude);
+			sineModeBox->setSelectedIndex(properties->sineMode.mode);
+			periodBoxes[2]->setValue(properties->sawToothMode.period);
+			amplitudeBoxes[2]->setValue(properties->sawToothMode.amplitude);
+			for(int i = 0; i < 6; i++)	sawToothBoxes[i]->setValue((int)(properties->sawToothMode.xIndex[i] * 100));
+			keepCurrentPowerBox->setChecked(properties->steadyCurrentPower);
+			keepCurrentPowerBox->callback()(properties->steadyCurrentPower);
+			steadyPowerBox->setValue(properties->steadyGoalPower);
+			automaticMarginBox->setValue(properties->steadyMargin * 100);
+			avoidPeriodScramBox->setChecked(properties->avoidPeriodScram);
+			avoidPeriodScramBox->callback()(properties->avoidPeriodScram);
+			squareWaveSpeedBox->setChecked(properties->squareWaveUsesRodSpeed);
+			squareWaveSpeedBox->callback()(properties->squareWaveUsesRodSpeed);
+		}
+		else {
+			// setProperties only sets the square wave rod speed when it is used
+			if (!properties->squareWaveUsesRodSpeed) reactor->regulatingRod()->squareWave()->rodSpeed = 0.f;
+		}
+
+		if (tabBuilt(LimitsTab)) {
+			periodLimBox->setValue((float)properties->periodLimit);
+			powerLimBox->setValue(properties->powerLimit * 1e-03);
+			fuel_tempLimBox->setValue(properties->tempLimit);
+			water_tempLimBox->setValue(properties->waterTempLimit);
+			//water_levelLimBox->setValue(properties->waterLevelLimit);
+			for (int i = 0; i < 4; i++) {
+				bool value = false;
+				switch (i) {
+				case 0: value = properties->periodScram; break;
+				case 1: value = properties->powerScram; break;
+				case 2: value = properties->tempScram; break;
+				case 3: value = properties->waterTempScram; break;
+				case 4: value = properties->waterLevelScram; break;
+				}
+				scramEnabledBoxes[i]->setChecked(value);
+				scramEnabledBoxes[i]->callback()(value);
+			}
+			allRodsBox->setChecked(properties->allRodsAtOnce);
+			allRodsBox->callback()(properties->allRodsAtOnce);
+			autoScramBox->setChecked(properties->automaticPulseScram);
+			autoScramBox->callback()(properties->automaticPulseScram);
+		}
 
 		if (updateReactor) reactor->setProperties(properties);
 	}
@@ -3852,20 +4537,30 @@ public:
 
 };
 
+// Repeats a saved journal without the GUI, the exit code tells if it ended in the recorded state
+int replayJournal(const char* fileName) {
+	Settings settings;
+	Simulator simulator(&settings);
+	return simulator.replayJournal(fileName, &settings) ? 0 : 1;
+}
+
 int main(int argc, char **  argv ) {
+	if (argc == 3 && std::string(argv[1]) == "--replay")
+		return replayJournal(argv[2]);
 	try {
 #if defined(_WIN32)
 		ShowWindow(GetConsoleWindow(), SW_HIDE);
 #endif
 		nanogui::init();
 		{
+			startupProfiler.mark("Static initialization and GLFW");
 			nanogui::ref<SimulatorGUI> app = new SimulatorGUI();
 			app->handleDebugChanged();
 			app->drawAll();
 			app->setVisible(true);
 			if (argc == 2)
 				app->startScript = argv[1];
-			nanogui::mainloop(10);
+			nanogui::mainloop(app->framePacer);
 		}
 
 		nanogui::shutdown();
@@ -0,0 +1,185 @@
+#include <Telemetry.h>
+#include <LocalSocket.h>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+
+const char* TelemetryServer::channelName(int channel)
+{
+	static const char* names[ChannelCount] = {
+		"time", "power", "reactivity", "rodReactivity", "temperature", "xenon", "iodine",
+		"delayed1", "delayed2", "delayed3", "delayed4", "delayed5", "delayed6"
+	};
+	return (channel >= 0 && channel < ChannelCount) ? names[channel] : "";
+}
+
+bool TelemetryServer::start(int port)
+{
+	stop();
+	intptr_t listener = LocalSocket::listen(port);
+	if (listener == INVALID) {
+		std::cerr << "Telemetry: could not listen on port " << port << std::endl;
+		return false;
+	}
+	mListener = listener;
+	mPort = port;
+	std::cout << "Telemetry: listening on 127.0.0.1:" << port << std::endl;
+	return true;
+}
+
+void TelemetryServer::stop()
+{
+	if (!isRunning()) return;
+	for (Subscriber &subscriber : mSubscribers) LocalSocket::close(subscriber.socket);
+	mSubscribers.clear();
+	LocalSocket::close(mListener);
+	mListener = INVALID;
+	LocalSocket::release();
+	std::cout << "Telemetry: stopped" << std::endl;
+}
+
+void TelemetryServer::queue(Subscriber &subscriber, TelemetryFrame type, const void* payload, size_t size, const void* rows, size_t rowsSize)
+{
+	TelemetryFrameHeader header;
+	memcpy(header.magic, "RRST", 4);
+	header.version = TELEMETRY_VERSION;
+	header.type = (uint16_t)type;
+	header.sequence = subscriber.sequence++;
+	header.size = (uint32_t)(size + rowsSize);
+	header.reserved = 0;
+	std::vector<char> &out = subscriber.out;
+	out.insert(out.end(), (const char*)&header, (const char*)&header + sizeof(header));
+	out.insert(out.end(), (const char*)payload, (const char*)payload + size);
+	if (rowsSize) out.insert(out.end(), (const char*)rows, (const char*)rows + rowsSize);
+}
+
+void TelemetryServer::publish(uint64_t firstStep, size_t count, const double* rows)
+{
+	for (Subscriber &subscriber : mSubscribers) {
+		// Only the selected channels of every decimation-th step, the rows keep a fixed step
+		const uint64_t d = subscriber.decimation;
+		size_t first = (size_t)((d - firstStep % d) % d);
+		size_t selected = 0;
+		for (int c = 0; c < ChannelCount; c++) {
+			if (subscriber.channels & (1u << c)) selected++;
+		}
+		while (first < count) {
+			const size_t rowCount = std::min((count - first + d - 1) / d, TELEMETRY_MAX_ROWS);
+			mScratch.resize(rowCount * selected);
+			double* value = mScratch.data();
+			for (size_t r = 0; r < rowCount; r++) {
+				const double* row = rows + (first + r * d) * ChannelCount;
+				for (int c = 0; c < ChannelCount; c++) {
+					if (subscriber.channels & (1u << c)) *value++ = row[c];
+				}
+			}
+			TelemetrySamples samples;
+			samples.firstStep = firstStep + first;
+			samples.decimation = subscriber.decimation;
+			samples.channels = subscriber.channels;
+			samples.count = (uint32_t)rowCount;
+			samples.reserved = 0;
+			queue(subscriber, TelemetryFrame::Samples, &samples, sizeof(samples), mScratch.data(), mScratch.size() * sizeof(double));
+			first += rowCount * d;
+		}
+	}
+}
+
+void TelemetryServer::publishState(const TelemetryState &state)
+{
+	for (Subscriber &subscriber : mSubscribers) queue(subscriber, TelemetryFrame::State, &state, sizeof(state));
+}
+
+void TelemetryServer::publishScram(const TelemetryScram &scram)
+{
+	for (Subscriber &subscriber : mSubscribers) queue(subscriber, TelemetryFrame::Scram, &scram, sizeof(scram));
+}
+
+void TelemetryServer::poll()
+{
+	if (!isRunning()) return;
+	// New subscribers
+	intptr_t socket;
+	while ((socket = LocalSocket::accept(mListener)) != INVALID) {
+		Subscriber subscriber;
+		subscriber.socket = socket;
+		std::string names;
+		for (int c = 0; c < ChannelCount; c++) names += std::string(c ? "\n" : "") + channelName(c);
+		queue(subscriber, TelemetryFrame::Hello, names.data(), names.size());
+		mSubscribers.push_back(std::move(subscriber));
+		std::cout << "Telemetry: subscriber connected (" << mSubscribers.size() << " total)" << std::endl;
+	}
+	// Requests and queued frames, from the back so dropping keeps the indices valid
+	for (size_t i = mSubscribers.size(); i-- > 0;) {
+		Subscriber &subscriber = mSubscribers[i];
+		if (!receive(subscriber)) drop(i, "disconnected");
+		else if (subscriber.out.size() - subscriber.sent > TELEMETRY_MAX_BACKLOG) drop(i, "dropped, it could not keep up");
+		else if (!flush(subscriber)) drop(i, "disconnected");
+	}
+}
+
+bool TelemetryServer::receive(Subscriber &subscriber)
+{
+	char buffer[512];
+	while (true) {
+		int received = LocalSocket::receive(subscriber.socket, buffer, sizeof(buffer));
+		if (received <= 0) return received == 0;
+		subscriber.in.append(buffer, received);
+		size_t end;
+		while ((end = subscriber.in.find('\n')) != std::string::npos) {
+			request(subscriber, subscriber.in.substr(0, end));
+			subscriber.in.erase(0, end + 1);
+		}
+		if (subscriber.in.size() > sizeof(buffer)) subscriber.in.clear(); // not a request
+	}
+}
+
+void TelemetryServer::request(Subscriber &subscriber, const std::string &line)
+{
+	std::istringstream words(line);
+	std::string command;
+	words >> command;
+	if (command == "channels") {
+		uint32_t channels = 0;
+		std::string name;
+		while (words >> name) {
+			for (int c = 0; c < ChannelCount; c++) {
+				if (name == channelName(c)) channels |= 1u << c;
+			}
+		}
+		if (channels) subscriber.channels = channels;
+	}
+	else if (command == "decimation") {
+		long decimation = 1;
+		if (words >> decimation) subscriber.decimation = (uint32_t)std::max(decimation, 1L);
+	}
+}
+
+bool TelemetryServer::flush(Subscriber &subscriber)
+{
+	std::vector<char> &out = subscriber.out;
+	while (subscriber.sent < out.size()) {
+		int sent = LocalSocket::send(subscriber.socket, out.data() + subscriber.sent, std::min(out.size() - subscriber.sent, (size_t)1 << 20));
+		if (sent > 0) subscriber.sent += sent;
+		else if (sent == 0) break;
+		else return false;
+	}
+	// Keep the buffer from growing with data that was already sent
+	if (subscriber.sent == out.size()) {
+		out.clear();
+		subscriber.sent = 0;
+	}
+	else if (subscriber.sent > out.size() / 2) {
+		out.erase(out.begin(), out.begin() + subscriber.sent);
+		subscriber.sent = 0;
+	}
+	return true;
+}
+
+void TelemetryServer::drop(size_t index, const char* reason)
+{
+	LocalSocket::close(mSubscribers[index].socket);
+	mSubscribers.erase(mSubscribers.begin() + index);
+	std::cout << "Telemetry: subscriber " << reason << " (" << mSubscribers.size() << " left)" << std::endl;
+}
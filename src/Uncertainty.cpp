@@ -0,0 +1,176 @@
+#include <Uncertainty.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <chrono>
+#include <limits>
+#include <cmath>
+
+void QuantileEstimator::add(double x)
+{
+	if (n < 5) {
+		heights[n++] = x;
+		if (n == 5) {
+			std::sort(heights, heights + 5);
+			for (int i = 0; i < 5; i++) positions[i] = i + 1;
+			desired[0] = 1.;
+			desired[1] = 1. + 2. * p;
+			desired[2] = 1. + 4. * p;
+			desired[3] = 3. + 2. * p;
+			desired[4] = 5.;
+		}
+		return;
+	}
+
+	// The cell of x, the extremes move out to it
+	int k = 0;
+	if (x < heights[0]) heights[0] = x;
+	else if (x >= heights[4]) {
+		heights[4] = x;
+		k = 3;
+	}
+	else {
+		while (x >= heights[k + 1]) k++;
+	}
+	for (int i = k + 1; i < 5; i++) positions[i] += 1.;
+	desired[1] += p / 2.;
+	desired[2] += p;
+	desired[3] += (1. + p) / 2.;
+	desired[4] += 1.;
+	n++;
+
+	// The middle markers move towards their desired positions on a parabola through their neighbours
+	for (int i = 1; i < 4; i++) {
+		const double d = desired[i] - positions[i];
+		if ((d >= 1. && positions[i + 1] - positions[i] > 1.) || (d <= -1. && positions[i - 1] - positions[i] < -1.)) {
+			const int s = d > 0. ? 1 : -1;
+			const double parabolic = heights[i] + s / (positions[i + 1] - positions[i - 1]) *
+				((positions[i] - positions[i - 1] + s) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+				(positions[i + 1] - positions[i] - s) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+			if (heights[i - 1] < parabolic && parabolic < heights[i + 1]) heights[i] = parabolic;
+			else heights[i] += s * (heights[i + s] - heights[i]) / (positions[i + s] - positions[i]);
+			positions[i] += s;
+		}
+	}
+}
+
+double QuantileEstimator::value() const
+{
+	if (n == 0) return std::numeric_limits<double>::quiet_NaN();
+	if (n >= 5) return heights[2];
+	// Too few for the markers, the nearest of the sorted values
+	double sorted[5];
+	std::copy(heights, heights + n, sorted);
+	std::sort(sorted, sorted + n);
+	return sorted[(size_t)std::round(p * (n - 1))];
+}
+
+UncertaintyEnvelope::UncertaintyEnvelope(size_t points, double interval, const std::vector<double> &quantiles)
+	: mPoints(points), mInterval(interval), mQuantiles(quantiles), mMean(ChannelCount * points, 0.)
+{
+	mEstimators.reserve(ChannelCount * points * quantiles.size());
+	for (size_t i = 0; i < ChannelCount * points; i++) {
+		for (double quantile : quantiles) mEstimators.emplace_back(quantile);
+	}
+}
+
+void UncertaintyEnvelope::add(const std::vector<float> &values)
+{
+	mRealisations++;
+	for (size_t i = 0; i < ChannelCount * mPoints; i++) {
+		mMean[i] += (values[i] - mMean[i]) / mRealisations;
+		for (size_t q = 0; q < mQuantiles.size(); q++) mEstimators[i * mQuantiles.size() + q].add(values[i]);
+	}
+}
+
+bool UncertaintyEnvelope::save(const std::string &fileName) const
+{
+	const char* names[ChannelCount] = { "power", "temperature" };
+	const char* units[ChannelCount] = { "W", "C" };
+	std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+	file << "# " << mRealisations << " realisations" << std::endl << "time (s)";
+	for (int c = 0; c < ChannelCount; c++) {
+		file << '\t' << names[c] << " mean (" << units[c] << ")";
+		for (double quantile : mQuantiles) file << '\t' << names[c] << " q" << quantile << " (" << units[c] << ")";
+	}
+	file << std::endl;
+	file.precision(7);
+	for (size_t point = 0; point < mPoints; point++) {
+		file << point * mInterval;
+		for (int c = 0; c < ChannelCount; c++) {
+			file << '\t' << mean((Channel)c, point);
+			for (size_t q = 0; q < mQuantiles.size(); q++) file << '\t' << quantile((Channel)c, point, q);
+		}
+		file << '\n';
+	}
+	if (!file) {
+		std::cerr << "Could not write the envelopes to " << fileName << std::endl;
+		return false;
+	}
+	return true;
+}
+
+SweepVariation sampleVariation(const std::vector<ParameterDistribution> &distributions, std::mt19937_64 &random)
+{
+	SweepVariation variation;
+	for (const ParameterDistribution &distribution : distributions) {
+		double value = distribution.a;
+		switch (distribution.kind) {
+		case ParameterDistribution::Normal:
+			if (distribution.b > 0.) value = std::normal_distribution<double>(distribution.a, distribution.b)(random);
+			break;
+		case ParameterDistribution::LogNormal:
+			if (distribution.b > 0.) value = distribution.a * std::exp(std::normal_distribution<double>(0., distribution.b)(random));
+			break;
+		case ParameterDistribution::Uniform:
+			value = std::uniform_real_distribution<double>(distribution.a, distribution.b)(random);
+			break;
+		}
+		variation.push_back(SweepChange{ distribution.parameter, distribution.index, value });
+	}
+	return variation;
+}
+
+UncertaintyEnvelope runUncertainty(const Settings &base, const std::vector<ParameterDistribution> &distributions,
+	const Script &script, const UncertaintyOptions &options, const std::string &fileName)
+{
+	const size_t intervalSteps = std::max((size_t)std::llround(options.interval / DT_STEP), (size_t)1);
+	const size_t points = (size_t)std::llround(std::max(options.duration, 0.) / DT_STEP) / intervalSteps + 1;
+	UncertaintyEnvelope envelope(points, intervalSteps * DT_STEP, options.quantiles);
+	const auto start = std::chrono::steady_clock::now();
+	std::mutex lock;
+	size_t failed = 0;
+
+	runParallel(options.realisations, options.threads, [&](size_t i) {
+		std::seed_seq seeds{ (uint32_t)options.seed, (uint32_t)(options.seed >> 32), (uint32_t)i, (uint32_t)((uint64_t)i >> 32) };
+		std::mt19937_64 random(seeds);
+		std::vector<float> values(UncertaintyEnvelope::ChannelCount * points);
+		size_t point = 0;
+		const SweepResult result = runSweepVariation(base, sampleVariation(distributions, random), script, options.duration,
+			[&](Simulator &simulator) {
+				// The points reached in the frame, step s is in the data at s % getDataLength()
+				const size_t newest = simulator.getTotalIterations() - 1;
+				for (; point < points && point * intervalSteps <= newest; point++) {
+					const size_t index = (point * intervalSteps) % simulator.getDataLength();
+					values[UncertaintyEnvelope::Power * points + point] = (float)simulator.powerFromNeutrons(simulator.state_vector_[0][index]);
+					values[UncertaintyEnvelope::Temperature * points + point] = simulator.temperature_[index];
+				}
+			});
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (!result.error.empty() || point < points) {
+			failed++;
+			std::cerr << "Realisation " << i << " failed: " << (result.error.empty() ? "it ended early" : result.error) << std::endl;
+			return;
+		}
+		envelope.add(values);
+		std::cout << "Uncertainty: " << envelope.realisations() << " of " << options.realisations << " realisations" << std::endl;
+		if (!fileName.empty() && options.writeEvery && envelope.realisations() % options.writeEvery == 0) envelope.save(fileName);
+	});
+
+	if (!fileName.empty()) envelope.save(fileName);
+	std::cout << "Uncertainty of " << envelope.realisations() << " realisations (" << failed << " failed) took "
+		<< std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+	return envelope;
+}
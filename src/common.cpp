@@ -10,6 +10,7 @@
 */
 
 #include <nanogui/screen.h>
+#include <nanogui/framepacer.h>
 
 #if defined(_WIN32)
 #define NOMINMAX
@@ -18,6 +19,7 @@
 
 #include <nanogui/opengl.h>
 #include <map>
+#include <cstdio>
 #include <thread>
 #include <chrono>
 #include <iostream>
@@ -114,6 +116,50 @@ void mainloop(int refresh) {
         refresh_thread.join();
 }
 
+void mainloop(FramePacer &pacer) {
+    if (mainloop_active)
+        throw std::runtime_error("Main loop is already running!");
+
+    mainloop_active = true;
+    pacer.start();
+
+    try {
+        while (mainloop_active) {
+            int numScreens = 0;
+            pacer.frameStarted();
+            for (auto kv : __nanogui_screens) {
+                Screen *screen = kv.second;
+                if (!screen->visible()) {
+                    continue;
+                } else if (glfwWindowShouldClose(screen->glfwWindow())) {
+                    screen->setVisible(false);
+                    continue;
+                }
+                screen->drawAll();
+                numScreens++;
+            }
+            pacer.frameFinished();
+
+            if (numScreens == 0) {
+                /* Give up if there was nothing to draw */
+                mainloop_active = false;
+                break;
+            }
+
+            /* Wait for mouse/keyboard events or the pacer's refresh event */
+            glfwWaitEvents();
+        }
+
+        /* Process events once more */
+        glfwPollEvents();
+    } catch (const std::exception &e) {
+        std::cerr << "Caught exception in main loop: " << e.what() << std::endl;
+        abort();
+    }
+
+    pacer.stop();
+}
+
 void leave() {
     mainloop_active = false;
 }
@@ -155,41 +201,41 @@ int __nanogui_get_image(NVGcontext *ctx, const std::string &name, uint8_t *data,
     return iconID;
 }
 
-std::string formatDecimals(double x, int decDigits, const bool forceDecimals)
+int formatDecimals(char *buffer, size_t size, double x, int decDigits, const bool forceDecimals)
 {
-	std::string res = (x < 0.) ? "-" : "";
+	if (!size) return 0;
+	const char* sign = (x < 0.) ? "-" : "";
 	x = std::abs(x);
 	decDigits = std::max(decDigits, 0);
-	long num = (long)(decDigits ? std::floor(x) : std::round(x));
-	if (decDigits) {
-		long decNum = (long)std::round((x - std::floor(x)) * pow(10., decDigits));
-		if (decNum < (long)pow(10., decDigits)) { // write decimals
-			res += std::to_string(num);
-			std::string dec = std::to_string(decNum);
-			int dec_len = (int)dec.length();
-			if (forceDecimals) {
-				res += ".";
-				for (int i = 0; i < decDigits - dec_len; i++) res += "0";
-				res += dec;
-			}
-			else if (decNum > 0) {
-				res += ".";
-				for (int i = 0; i < decDigits - dec_len; i++) res += "0";
-				for (int i = 0; i < dec_len; i++) {
-					if (dec.at(i) == '0') break;
-					res += dec.at(i);
-				}
-			}
-		}
-		else { // rounded to ceil
-			res += std::to_string(num + 1);
-			if (forceDecimals) {
-				res += ".";
-				for (int i = 0; i < decDigits; i++) res += "0";
-			}
-		}
+	if (!decDigits) return std::snprintf(buffer, size, "%s%ld", sign, (long)std::round(x));
+
+	long num = (long)std::floor(x);
+	long scale = (long)pow(10., decDigits);
+	long decNum = (long)std::round((x - std::floor(x)) * scale);
+	if (decNum >= scale) { // rounded to ceil
+		if (forceDecimals) return std::snprintf(buffer, size, "%s%ld.%0*d", sign, num + 1, decDigits, 0);
+		return std::snprintf(buffer, size, "%s%ld", sign, num + 1);
 	}
-	return res;
+	if (forceDecimals) return std::snprintf(buffer, size, "%s%ld.%0*ld", sign, num, decDigits, decNum);
+	int len = std::min(std::max(std::snprintf(buffer, size, "%s%ld", sign, num), 0), (int)size - 1);
+	if (decNum > 0) {
+		// Leading zeros of the decimals are kept, the rest is written until the first zero
+		char dec[24];
+		int decLen = std::snprintf(dec, sizeof(dec), "%ld", decNum);
+		auto put = [&](char c) { if ((size_t)len + 1 < size) buffer[len++] = c; };
+		put('.');
+		for (int i = 0; i < decDigits - decLen; i++) put('0');
+		for (int i = 0; i < decLen && dec[i] != '0'; i++) put(dec[i]);
+		buffer[len] = '\0';
+	}
+	return len;
+}
+
+std::string formatDecimals(double x, int decDigits, const bool forceDecimals)
+{
+	char buffer[64];
+	formatDecimals(buffer, sizeof(buffer), x, decDigits, forceDecimals);
+	return buffer;
 }
 
 using namespace std::chrono;
@@ -0,0 +1,150 @@
+#include <nanogui/framepacer.h>
+#include <nanogui/opengl.h>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+
+NAMESPACE_BEGIN(nanogui)
+
+static double pacerClock() {
+	using namespace std::chrono;
+	return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+FramePacer::FramePacer(double targetRate, double idleRate) : mRunning(false) {
+	mTargetRate = std::max(targetRate, 1.);
+	mIdleRate = std::min(std::max(idleRate, 0.1), mTargetRate);
+	std::fill(mIntervals, mIntervals + historySize, 0.f);
+	std::fill(mWork, mWork + historySize, 0.f);
+}
+
+FramePacer::~FramePacer() {
+	stop();
+}
+
+void FramePacer::setTargetRate(double fps) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mTargetRate = std::max(fps, 1.);
+	mIdleRate = std::min(mIdleRate, mTargetRate);
+	mCondition.notify_all();
+}
+
+void FramePacer::setIdleRate(double fps) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mIdleRate = std::min(std::max(fps, 0.1), mTargetRate);
+	mCondition.notify_all();
+}
+
+void FramePacer::setIdle(bool idle) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mIdle == idle) return;
+	mIdle = idle;
+	if (!idle) mCondition.notify_all(); // shorten the pending wait
+}
+
+double FramePacer::currentRate() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return 1. / interval();
+}
+
+// Expects mMutex to be held
+double FramePacer::interval() const {
+	bool useIdle = mIdle && (pacerClock() - mLastActivity > mActivityHold);
+	return 1. / (useIdle ? mIdleRate : mTargetRate);
+}
+
+void FramePacer::frameStarted() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	double now = pacerClock();
+	// A frame before the deadline was caused by an input event
+	if (mNextDeadline > 0. && now < mNextDeadline - 0.002) mLastActivity = now;
+	if (mFrameStart > 0.) {
+		mIntervals[mFrameCount % historySize] = (float)(now - mFrameStart);
+	}
+	mLastFrameStart = mFrameStart;
+	mFrameStart = now;
+}
+
+void FramePacer::frameFinished() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mLastFrameStart > 0.) {
+		mWork[mFrameCount % historySize] = (float)(pacerClock() - mFrameStart);
+		mFrameCount++;
+	}
+	mNextDeadline = mFrameStart + interval();
+	mFrameDone = true;
+	mCondition.notify_all();
+}
+
+FramePacer::Statistics FramePacer::statistics() const {
+	Statistics ret;
+	float sorted[historySize];
+	size_t n;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		n = std::min(mFrameCount, historySize);
+		if (!n) return ret;
+		std::copy(mIntervals, mIntervals + n, sorted);
+		ret.last = mIntervals[(mFrameCount - 1) % historySize];
+		for (size_t i = 0; i < n; i++) ret.work += mWork[i];
+	}
+	ret.work /= n;
+	std::sort(sorted, sorted + n);
+	for (size_t i = 0; i < n; i++) ret.average += sorted[i];
+	ret.average /= n;
+	// nearest-rank percentiles
+	auto percentile = [&sorted, n](float p) {
+		size_t rank = (size_t)std::ceil(p * n);
+		return sorted[std::min(std::max(rank, (size_t)1), n) - 1];
+	};
+	ret.p50 = percentile(0.50f);
+	ret.p95 = percentile(0.95f);
+	ret.p99 = percentile(0.99f);
+	return ret;
+}
+
+void FramePacer::start() {
+	if (mRunning) return;
+	mRunning = true;
+	mThread = std::thread([this]() { run(); });
+}
+
+void FramePacer::stop() {
+	if (!mRunning) return;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRunning = false;
+		mCondition.notify_all();
+	}
+	if (mThread.joinable()) mThread.join();
+}
+
+void FramePacer::run() {
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (mRunning) {
+		// Wait until the previous frame has been drawn, so events never pile up
+		mCondition.wait(lock, [this]() { return mFrameDone || !mRunning; });
+		if (!mRunning) break;
+		mFrameDone = false;
+
+		// Sleep until the deadline, which may move if the rate changes meanwhile
+		bool post = true;
+		while (mRunning) {
+			mNextDeadline = mFrameStart + interval();
+			double now = pacerClock();
+			if (now >= mNextDeadline) break;
+			mCondition.wait_for(lock, std::chrono::duration<double>(mNextDeadline - now));
+			if (mFrameDone) { // an input event already triggered a new frame
+				post = false;
+				break;
+			}
+		}
+		if (post && mRunning) {
+			lock.unlock();
+			glfwPostEmptyEvent();
+			lock.lock();
+		}
+	}
+}
+
+NAMESPACE_END(nanogui)
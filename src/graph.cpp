@@ -278,10 +278,10 @@ void Graph::draw(NVGcontext *ctx) {
 				nvgMoveTo(ctx, new_xPos, yPos);
 				nvgLineTo(ctx, new_xPos - direction*currentElement->getMajorTickSize(), yPos);
 				if (currentElement->getTextShown()) {
-					string content = currentElement->getOverridenLimits()[3].length() ? currentElement->getOverridenLimits()[3] : currentElement->formatNumber(limits[3] * currentElement->getLimitMultiplier());
+					const char* content = currentElement->getOverridenLimits()[3].length() ? currentElement->getOverridenLimits()[3].c_str() : currentElement->axisLabel(0, currentElement->getMajorTickNumber() + 1, limits[3] * currentElement->getLimitMultiplier());
 					nvgFontSize(ctx, currentElement->getMainTickFontSize());
 					nvgText(ctx, new_xPos - direction*(currentElement->getMajorTickSize() + 3), yPos,
-						content.c_str(), NULL);
+						content, NULL);
 				}
 				if (currentElement->getYlog()) {
 					for (double i = floor(limLog[2]) + 1; i < ceil(limLog[3]); i++) {
@@ -290,7 +290,9 @@ void Graph::draw(NVGcontext *ctx) {
 						nvgLineTo(ctx, new_xPos - direction*currentElement->getMajorTickSize(), thisY);
 						if (currentElement->getTextShown()) {
 							nvgFontSize(ctx, currentElement->getMajorTickFontSize());
-							nvgText(ctx, new_xPos - direction*(currentElement->getMajorTickSize() + 3), thisY, ("1e" + std::to_string((int)i)).c_str(), NULL);
+							char decade[16];
+							snprintf(decade, sizeof(decade), "1e%d", (int)i);
+							nvgText(ctx, new_xPos - direction*(currentElement->getMajorTickSize() + 3), thisY, decade, NULL);
 						}
 					}
 				}
@@ -304,7 +306,7 @@ void Graph::draw(NVGcontext *ctx) {
 							if (currentElement->getTextShown()) {
 								nvgFontSize(ctx, currentElement->getMajorTickFontSize());
 								nvgText(ctx, new_xPos - direction*(currentElement->getMajorTickSize() + 3), thisY,
-									currentElement->formatNumber((limits[2] + (currentElement->getMajorTickNumber() + 1 - i)*(limits[3] - limits[2]) / (currentElement->getMajorTickNumber() + 1)) * currentElement->getLimitMultiplier()).c_str(), NULL);
+									currentElement->axisLabel(0, i, (limits[2] + (currentElement->getMajorTickNumber() + 1 - i)*(limits[3] - limits[2]) / (currentElement->getMajorTickNumber() + 1)) * currentElement->getLimitMultiplier()), NULL);
 							}
 						}
 					}
@@ -312,10 +314,10 @@ void Graph::draw(NVGcontext *ctx) {
 				nvgMoveTo(ctx, new_xPos, yPos + graphRangeY);
 				nvgLineTo(ctx, new_xPos - direction*currentElement->getMajorTickSize(), yPos + graphRangeY);
 				if (currentElement->getTextShown()) {
-					string content = currentElement->getOverridenLimits()[2].length() ? currentElement->getOverridenLimits()[2] : currentElement->formatNumber(limits[2] * currentElement->getLimitMultiplier());
+					const char* content = currentElement->getOverridenLimits()[2].length() ? currentElement->getOverridenLimits()[2].c_str() : currentElement->axisLabel(0, 0, limits[2] * currentElement->getLimitMultiplier());
 					nvgFontSize(ctx, currentElement->getMainTickFontSize());
 					nvgText(ctx, new_xPos - direction*(currentElement->getMajorTickSize() + 3), yPos + graphRangeY,
-						content.c_str(), NULL);
+						content, NULL);
 				}
 				nvgStroke(ctx);
 
@@ -413,10 +415,10 @@ void Graph::draw(NVGcontext *ctx) {
 				nvgMoveTo(ctx, xPos, new_yPos);
 				nvgLineTo(ctx, xPos, new_yPos + direction*currentElement->getMajorTickSize());
 				if (currentElement->getTextShown()) {
-					string content = currentElement->getOverridenLimits()[0].length() ? currentElement->getOverridenLimits()[0] : currentElement->formatNumber(limits[0] * currentElement->getLimitMultiplier());
+					const char* content = currentElement->getOverridenLimits()[0].length() ? currentElement->getOverridenLimits()[0].c_str() : currentElement->axisLabel(1, 0, limits[0] * currentElement->getLimitMultiplier());
 					nvgFontSize(ctx, currentElement->getMainTickFontSize());
 					nvgText(ctx, xPos, new_yPos + direction*(currentElement->getMajorTickSize() + 3),
-						content.c_str(), NULL);
+						content, NULL);
 				}
 				if (currentElement->getHorizontalMajorTickNumber() != 0) {
 					float tickDiff = graphRangeX / (currentElement->getHorizontalMajorTickNumber() + 1);
@@ -427,17 +429,17 @@ void Graph::draw(NVGcontext *ctx) {
 						if (currentElement->getTextShown()) {
 							nvgFontSize(ctx, currentElement->getMajorTickFontSize());
 							nvgText(ctx, thisX, new_yPos + direction*(currentElement->getMajorTickSize() + 3),
-								currentElement->formatNumber((currentElement->limits()[0] + i*(limits[1] - limits[0]) / (currentElement->getHorizontalMajorTickNumber() + 1)) * currentElement->getLimitHorizontalMultiplier()).c_str(), NULL);
+								currentElement->axisLabel(1, i, (currentElement->limits()[0] + i*(limits[1] - limits[0]) / (currentElement->getHorizontalMajorTickNumber() + 1)) * currentElement->getLimitHorizontalMultiplier()), NULL);
 						}
 					}
 				}
 				nvgMoveTo(ctx, xPos + graphRangeX, new_yPos);
 				nvgLineTo(ctx, xPos + graphRangeX, new_yPos + direction*currentElement->getMajorTickSize());
 				if (currentElement->getTextShown()) {
-					string content = currentElement->getOverridenLimits()[1].length() ? currentElement->getOverridenLimits()[1] : currentElement->formatNumber(limits[1] * currentElement->getLimitHorizontalMultiplier());
+					const char* content = currentElement->getOverridenLimits()[1].length() ? currentElement->getOverridenLimits()[1].c_str() : currentElement->axisLabel(1, currentElement->getHorizontalMajorTickNumber() + 1, limits[1] * currentElement->getLimitHorizontalMultiplier());
 					nvgFontSize(ctx, currentElement->getMainTickFontSize());
 					nvgText(ctx, xPos + graphRangeX, new_yPos + direction*(currentElement->getMajorTickSize() + 3),
-						content.c_str(), NULL);
+						content, NULL);
 				}
 				nvgStroke(ctx);
 